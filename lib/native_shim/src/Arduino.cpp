@@ -0,0 +1,75 @@
+#include "Arduino.h"
+
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+static uint64_t monotonicUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// like on the device both count from startup
+static uint64_t start = monotonicUs();
+
+static uint64_t sinceStart(void)
+{
+    return monotonicUs() - start;
+}
+
+unsigned long millis(void)
+{
+    return (uint32_t)(sinceStart() / 1000);
+}
+
+unsigned long micros(void)
+{
+    return (uint32_t)sinceStart();
+}
+
+void delay(unsigned long ms)
+{
+    struct timespec ts = {(time_t)(ms / 1000), (long)(ms % 1000) * 1000000};
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+        ;
+}
+
+void *ps_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+bool psramFound(void)
+{
+    return false;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    pthread_mutex_t *m = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t));
+    if (m)
+        pthread_mutex_init(m, NULL);
+    return m;
+}
+
+// only ever waits forever or not at all, which is all the modules ask for
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks)
+{
+    pthread_mutex_t *m = (pthread_mutex_t *)mutex;
+    if (ticks == 0)
+        return pthread_mutex_trylock(m) == 0 ? pdTRUE : pdFALSE;
+    return pthread_mutex_lock(m) == 0 ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex)
+{
+    return pthread_mutex_unlock((pthread_mutex_t *)mutex) == 0 ? pdTRUE : pdFALSE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t mutex)
+{
+    pthread_mutex_destroy((pthread_mutex_t *)mutex);
+    free(mutex);
+}
@@ -0,0 +1,43 @@
+#ifndef NATIVE_ARDUINO_H_
+#define NATIVE_ARDUINO_H_
+
+// Just enough of the Arduino core and FreeRTOS for the modules in src to build
+// and run on the host, for `pio test -e native`. A tick is a millisecond and a
+// FreeRTOS mutex is a pthread one.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef void *SemaphoreHandle_t;
+
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define IRAM_ATTR
+#define PROGMEM
+
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+
+// there is no PSRAM on the host, so everything comes from the one heap
+void *ps_malloc(size_t size);
+bool psramFound(void);
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex);
+void vSemaphoreDelete(SemaphoreHandle_t mutex);
+
+#endif //NATIVE_ARDUINO_H_
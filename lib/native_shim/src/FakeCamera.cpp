@@ -0,0 +1,298 @@
+#include "FakeCamera.h"
+
+#include <pthread.h>
+#include <dirent.h>
+#include <time.h>
+
+struct Source
+{
+    uint8_t *buf;
+    size_t len;
+    int width, height;
+    pixformat_t format;
+};
+
+struct Slot
+{
+    camera_fb_t fb;
+    size_t capacity;
+    bool out;
+};
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t returned = PTHREAD_COND_INITIALIZER;
+
+static Source sources[FAKE_CAMERA_FRAMES];
+static int sourceCount;
+static int next; // source of the next frame
+
+static Slot slots[FAKE_CAMERA_BUFFERS];
+static int slotCount;
+static int out;
+
+static int fps;
+static uint32_t due; // micros() of the next frame
+static uint32_t taken;
+static uint32_t starved;
+
+static sensor_t sensor;
+
+static int setFramesize(sensor_t *s, framesize_t framesize)
+{
+    s->status.framesize = framesize;
+    return 0;
+}
+
+static int setQuality(sensor_t *s, int quality)
+{
+    s->status.quality = quality;
+    return 0;
+}
+
+// the frame size from a JPEG's SOF marker
+static bool sofSize(const uint8_t *jpg, size_t len, int &width, int &height)
+{
+    for (size_t i = 2; i + 9 < len && jpg[i] == 0xFF; i += 2 + (jpg[i + 2] << 8 | jpg[i + 3]))
+    {
+        uint8_t marker = jpg[i + 1];
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+        {
+            height = jpg[i + 5] << 8 | jpg[i + 6];
+            width = jpg[i + 7] << 8 | jpg[i + 8];
+            return true;
+        }
+    }
+    return false;
+}
+
+static int byName(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// Add every .jpg in dir, in name order. Returns how many were added
+int FakeCamera::load(const char *dir)
+{
+    DIR *d = opendir(dir);
+    if (d == NULL)
+        return 0;
+
+    char *names[FAKE_CAMERA_FRAMES];
+    int count = 0;
+    struct dirent *e;
+    while (count < FAKE_CAMERA_FRAMES && (e = readdir(d)) != NULL)
+    {
+        const char *dot = strrchr(e->d_name, '.');
+        if (dot && (strcasecmp(dot, ".jpg") == 0 || strcasecmp(dot, ".jpeg") == 0))
+            names[count++] = strdup(e->d_name);
+    }
+    closedir(d);
+    qsort(names, count, sizeof(names[0]), byName);
+
+    int added = 0;
+    for (int i = 0; i < count; i++)
+    {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+        free(names[i]);
+
+        FILE *f = fopen(path, "rb");
+        if (f == NULL)
+            continue;
+        fseek(f, 0, SEEK_END);
+        long len = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        uint8_t *buf = len > 0 ? (uint8_t *)malloc(len) : NULL;
+        int width, height;
+        if (buf && fread(buf, 1, len, f) == (size_t)len && sofSize(buf, len, width, height) &&
+            add(buf, len, width, height))
+            added++;
+        free(buf);
+        fclose(f);
+    }
+    return added;
+}
+
+// add a frame to the ones replayed, copying it
+bool FakeCamera::add(const uint8_t *buf, size_t len, int width, int height, pixformat_t format)
+{
+    pthread_mutex_lock(&mutex);
+    bool ok = sourceCount < FAKE_CAMERA_FRAMES;
+    if (ok)
+    {
+        Source &s = sources[sourceCount];
+        s.buf = (uint8_t *)malloc(len);
+        ok = s.buf != NULL;
+        if (ok)
+        {
+            memcpy(s.buf, buf, len);
+            s.len = len;
+            s.width = width;
+            s.height = height;
+            s.format = format;
+            sourceCount++;
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+    return ok;
+}
+
+// frames a second esp_camera_fb_get() hands out at most, 0 for as fast as asked
+void FakeCamera::setFps(int rate)
+{
+    pthread_mutex_lock(&mutex);
+    fps = rate;
+    due = micros();
+    pthread_mutex_unlock(&mutex);
+}
+
+// Forget all frames and buffers. Only while none is out
+void FakeCamera::reset(void)
+{
+    esp_camera_deinit();
+    pthread_mutex_lock(&mutex);
+    for (int i = 0; i < sourceCount; i++)
+        free(sources[i].buf);
+    sourceCount = 0;
+    next = 0;
+    fps = 0;
+    taken = 0;
+    starved = 0;
+    pthread_mutex_unlock(&mutex);
+}
+
+int FakeCamera::getFrames(void) { return sourceCount; }
+int FakeCamera::getOut(void) { return out; }
+uint32_t FakeCamera::getTaken(void) { return taken; }
+uint32_t FakeCamera::getStarved(void) { return starved; }
+int FakeCamera::getQuality(void) { return sensor.status.quality; }
+framesize_t FakeCamera::getFramesize(void) { return sensor.status.framesize; }
+
+esp_err_t esp_camera_init(const camera_config_t *config)
+{
+    if (config->fb_count < 1 || config->fb_count > FAKE_CAMERA_BUFFERS)
+        return ESP_FAIL;
+
+    pthread_mutex_lock(&mutex);
+    esp_err_t err = slotCount ? ESP_ERR_INVALID_STATE : ESP_OK;
+    if (err == ESP_OK)
+    {
+        memset(slots, 0, sizeof(slots));
+        slotCount = config->fb_count;
+        out = 0;
+        sensor.pixformat = config->pixel_format;
+        sensor.status.framesize = config->frame_size;
+        sensor.status.quality = config->jpeg_quality;
+        sensor.set_framesize = setFramesize;
+        sensor.set_quality = setQuality;
+    }
+    pthread_mutex_unlock(&mutex);
+    return err;
+}
+
+esp_err_t esp_camera_deinit(void)
+{
+    pthread_mutex_lock(&mutex);
+    for (int i = 0; i < slotCount; i++)
+        free(slots[i].fb.buf);
+    slotCount = 0;
+    out = 0;
+    pthread_mutex_unlock(&mutex);
+    return ESP_OK;
+}
+
+// Wait for the next frame to be due and for a free buffer, then fill it with
+// the next source frame. NULL with no frames to replay or if no buffer came
+// back in time
+camera_fb_t *esp_camera_fb_get(void)
+{
+    // the sensor takes its time, whoever asks
+    pthread_mutex_lock(&mutex);
+    int32_t early = 0;
+    if (fps)
+    {
+        uint32_t now = micros();
+        early = (int32_t)(due - now);
+        // a caller that fell behind gets the next frame right away, not a burst of them
+        due = early < -1000000 / fps ? now + 1000000 / fps : due + 1000000 / fps;
+    }
+    pthread_mutex_unlock(&mutex);
+    if (early > 0)
+        delay((early + 999) / 1000);
+
+    pthread_mutex_lock(&mutex);
+    if (slotCount == 0 || sourceCount == 0)
+    {
+        pthread_mutex_unlock(&mutex);
+        return NULL;
+    }
+
+    if (out == slotCount)
+    {
+        starved++;
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += FAKE_CAMERA_TIMEOUT / 1000;
+        until.tv_nsec += FAKE_CAMERA_TIMEOUT % 1000 * 1000000L;
+        if (until.tv_nsec >= 1000000000L)
+        {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+        while (out == slotCount)
+            if (pthread_cond_timedwait(&returned, &mutex, &until) != 0)
+            {
+                pthread_mutex_unlock(&mutex);
+                return NULL;
+            }
+    }
+
+    Slot *slot = slots;
+    while (slot->out)
+        slot++;
+    const Source &s = sources[next];
+    next = (next + 1) % sourceCount;
+    if (slot->capacity < s.len)
+    {
+        free(slot->fb.buf);
+        slot->fb.buf = (uint8_t *)malloc(s.len);
+        slot->capacity = slot->fb.buf ? s.len : 0;
+    }
+    camera_fb_t *fb = NULL;
+    if (slot->fb.buf)
+    {
+        // what the DMA does on the device
+        memcpy(slot->fb.buf, s.buf, s.len);
+        fb = &slot->fb;
+        fb->len = s.len;
+        fb->width = s.width;
+        fb->height = s.height;
+        fb->format = s.format;
+        uint32_t now = micros();
+        fb->timestamp.tv_sec = now / 1000000;
+        fb->timestamp.tv_usec = now % 1000000;
+        slot->out = true;
+        out++;
+        taken++;
+    }
+    pthread_mutex_unlock(&mutex);
+    return fb;
+}
+
+void esp_camera_fb_return(camera_fb_t *fb)
+{
+    pthread_mutex_lock(&mutex);
+    for (int i = 0; i < slotCount; i++)
+        if (&slots[i].fb == fb && slots[i].out)
+        {
+            slots[i].out = false;
+            out--;
+            pthread_cond_signal(&returned);
+        }
+    pthread_mutex_unlock(&mutex);
+}
+
+sensor_t *esp_camera_sensor_get(void)
+{
+    return slotCount ? &sensor : NULL;
+}
@@ -0,0 +1,36 @@
+#ifndef FAKECAMERA_H_
+#define FAKECAMERA_H_
+
+#include <Arduino.h>
+#include "esp_camera.h"
+
+#define FAKE_CAMERA_FRAMES 64    // source frames held, replayed in a loop
+#define FAKE_CAMERA_BUFFERS 4    // fb_count at most
+#define FAKE_CAMERA_TIMEOUT 1000 // ms esp_camera_fb_get() waits for a buffer to come back
+
+// Stands in for the camera driver behind esp_camera_*(). It replays the frames
+// it was given in a loop, JPEGs loaded from a directory or buffers added in
+// memory, at a set rate. Like the driver it fills one of fb_count buffers per
+// frame, blocks while all of them are out and stamps every frame with the
+// micros() it was taken at, so a test can tell how old a frame is when it
+// arrives somewhere.
+//
+// setQuality() and setFramesize() are what the sensor was last told, for
+// tests of whatever drives it.
+class FakeCamera
+{
+public:
+    static int load(const char *dir);
+    static bool add(const uint8_t *buf, size_t len, int width, int height, pixformat_t format = PIXFORMAT_JPEG);
+    static void setFps(int fps);
+    static void reset(void);
+
+    static int getFrames(void);
+    static int getOut(void);
+    static uint32_t getTaken(void);
+    static uint32_t getStarved(void);
+    static int getQuality(void);
+    static framesize_t getFramesize(void);
+};
+
+#endif //FAKECAMERA_H_
@@ -0,0 +1,127 @@
+#include "Preferences.h"
+
+#define PREFS_NAMESPACES 4
+#define PREFS_KEYS 64
+
+struct PrefsEntry
+{
+    char key[NVS_KEY_MAX + 1];
+    int32_t value;
+};
+
+struct PrefsSpace
+{
+    char name[NVS_KEY_MAX + 1];
+    PrefsEntry entries[PREFS_KEYS];
+    int count;
+};
+
+static PrefsSpace spaces[PREFS_NAMESPACES];
+static int spaceCount;
+static uint32_t writes;
+
+static bool validName(const char *name)
+{
+    return name && *name && strlen(name) <= NVS_KEY_MAX;
+}
+
+static PrefsEntry *findKey(PrefsSpace &s, const char *key)
+{
+    for (int i = 0; i < s.count; i++)
+        if (strcmp(s.entries[i].key, key) == 0)
+            return &s.entries[i];
+    return NULL;
+}
+
+bool Preferences::begin(const char *name, bool readOnly)
+{
+    if (!validName(name))
+        return false;
+
+    for (ns = 0; ns < spaceCount; ns++)
+        if (strcmp(spaces[ns].name, name) == 0)
+            break;
+    if (ns == spaceCount)
+    {
+        if (readOnly || spaceCount == PREFS_NAMESPACES)
+        {
+            // NVS can't open a namespace read-only that was never written
+            ns = -1;
+            return false;
+        }
+        strcpy(spaces[spaceCount++].name, name);
+    }
+    this->readOnly = readOnly;
+    return true;
+}
+
+void Preferences::end(void)
+{
+    ns = -1;
+}
+
+int32_t Preferences::getInt(const char *key, int32_t def)
+{
+    if (ns < 0 || !validName(key))
+        return def;
+    PrefsEntry *e = findKey(spaces[ns], key);
+    return e ? e->value : def;
+}
+
+// 0 for a key NVS would refuse, like the real one
+size_t Preferences::putInt(const char *key, int32_t value)
+{
+    if (ns < 0 || readOnly || !validName(key))
+        return 0;
+
+    PrefsSpace &s = spaces[ns];
+    PrefsEntry *e = findKey(s, key);
+    if (e == NULL)
+    {
+        if (s.count == PREFS_KEYS)
+            return 0;
+        e = &s.entries[s.count++];
+        strcpy(e->key, key);
+    }
+    e->value = value;
+    writes++;
+    return sizeof(value);
+}
+
+bool Preferences::isKey(const char *key)
+{
+    return ns >= 0 && validName(key) && findKey(spaces[ns], key) != NULL;
+}
+
+bool Preferences::remove(const char *key)
+{
+    if (ns < 0 || readOnly || !validName(key))
+        return false;
+
+    PrefsSpace &s = spaces[ns];
+    PrefsEntry *e = findKey(s, key);
+    if (e == NULL)
+        return false;
+    *e = s.entries[--s.count];
+    return true;
+}
+
+bool Preferences::clear(void)
+{
+    if (ns < 0 || readOnly)
+        return false;
+    spaces[ns].count = 0;
+    return true;
+}
+
+// forget every namespace, between tests
+void Preferences::reset(void)
+{
+    spaceCount = 0;
+    writes = 0;
+}
+
+uint32_t Preferences::getWrites(void)
+{
+    return writes;
+}
@@ -0,0 +1,37 @@
+#ifndef NATIVE_PREFERENCES_H_
+#define NATIVE_PREFERENCES_H_
+
+#include <Arduino.h>
+
+#define NVS_KEY_MAX 15 // characters in a namespace or key name, as NVS has it
+
+// Integer-only Preferences over an in-memory store shared by all instances,
+// standing in for NVS. Like NVS it turns down namespace and key names longer
+// than NVS_KEY_MAX, so a table that would lose settings on the device fails
+// the same way here. getWrites() counts the values put, for tests.
+class Preferences
+{
+public:
+    Preferences(){
+        ns = -1;
+        readOnly = true;
+    };
+
+    bool begin(const char *name, bool readOnly = false);
+    void end(void);
+
+    int32_t getInt(const char *key, int32_t def = 0);
+    size_t putInt(const char *key, int32_t value);
+    bool isKey(const char *key);
+    bool remove(const char *key);
+    bool clear(void);
+
+    static void reset(void);
+    static uint32_t getWrites(void);
+
+private:
+    int ns; // index of the open namespace, -1 if there is none
+    bool readOnly;
+};
+
+#endif //NATIVE_PREFERENCES_H_
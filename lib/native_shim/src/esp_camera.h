@@ -0,0 +1,87 @@
+#ifndef NATIVE_ESP_CAMERA_H_
+#define NATIVE_ESP_CAMERA_H_
+
+// The parts of the esp32-camera driver's interface the modules in src use,
+// under the same names. The driver itself is FakeCamera.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/time.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_STATE 0x103
+
+typedef enum
+{
+    PIXFORMAT_RGB565,
+    PIXFORMAT_YUV422,
+    PIXFORMAT_GRAYSCALE,
+    PIXFORMAT_JPEG,
+    PIXFORMAT_RGB888,
+    PIXFORMAT_RAW,
+    PIXFORMAT_RGB444,
+    PIXFORMAT_RGB555,
+} pixformat_t;
+
+typedef enum
+{
+    FRAMESIZE_96X96,
+    FRAMESIZE_QQVGA,
+    FRAMESIZE_QCIF,
+    FRAMESIZE_HQVGA,
+    FRAMESIZE_240X240,
+    FRAMESIZE_QVGA,
+    FRAMESIZE_CIF,
+    FRAMESIZE_HVGA,
+    FRAMESIZE_VGA,
+    FRAMESIZE_SVGA,
+    FRAMESIZE_XGA,
+    FRAMESIZE_HD,
+    FRAMESIZE_SXGA,
+    FRAMESIZE_UXGA,
+    FRAMESIZE_INVALID
+} framesize_t;
+
+typedef struct
+{
+    pixformat_t pixel_format;
+    framesize_t frame_size;
+    int jpeg_quality;
+    size_t fb_count;
+} camera_config_t;
+
+typedef struct
+{
+    uint8_t *buf;
+    size_t len;
+    size_t width;
+    size_t height;
+    pixformat_t format;
+    struct timeval timestamp;
+} camera_fb_t;
+
+typedef struct
+{
+    framesize_t framesize;
+    uint8_t quality;
+} camera_status_t;
+
+typedef struct _sensor sensor_t;
+struct _sensor
+{
+    pixformat_t pixformat;
+    camera_status_t status;
+    int (*set_framesize)(sensor_t *sensor, framesize_t framesize);
+    int (*set_quality)(sensor_t *sensor, int quality);
+};
+
+esp_err_t esp_camera_init(const camera_config_t *config);
+esp_err_t esp_camera_deinit(void);
+camera_fb_t *esp_camera_fb_get(void);
+void esp_camera_fb_return(camera_fb_t *fb);
+sensor_t *esp_camera_sensor_get(void);
+
+#endif //NATIVE_ESP_CAMERA_H_
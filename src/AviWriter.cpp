@@ -0,0 +1,269 @@
+#include "AviWriter.h"
+
+#define AVI_JUNK 0x80000000u
+#define AVIF_HASINDEX 0x10
+#define AVIIF_KEYFRAME 0x10
+
+AviWriter::AviWriter()
+{
+    sink = NULL;
+    ctx = NULL;
+    failed = false;
+    width = 0;
+    height = 0;
+    fps = 1;
+    sizes = NULL;
+    maxChunks = 0;
+    chunks = 0;
+    movi = 0;
+    largest = 0;
+}
+
+AviWriter::~AviWriter()
+{
+    free(sizes);
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+    return p + 4;
+}
+
+static uint8_t *put16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static uint8_t *putCC(uint8_t *p, const char *fourcc)
+{
+    memcpy(p, fourcc, 4);
+    return p + 4;
+}
+
+// lay the header out for the given totals
+void AviWriter::build(uint32_t frames, uint32_t movi)
+{
+    uint8_t *p = head;
+    uint32_t file = AVI_HEADER_SIZE + movi + 8 + frames * 16;
+    uint32_t buffer = largest ? chunkSize(largest) : 0; // a player reads a whole chunk at a time
+
+    p = putCC(p, "RIFF");
+    p = put32(p, file - 8);
+    p = putCC(p, "AVI ");
+
+    p = putCC(p, "LIST");
+    p = put32(p, 192);
+    p = putCC(p, "hdrl");
+
+    p = putCC(p, "avih");
+    p = put32(p, 56);
+    p = put32(p, 1000000 / fps);       // dwMicroSecPerFrame
+    p = put32(p, largest * fps);       // dwMaxBytesPerSec
+    p = put32(p, 0);                   // dwPaddingGranularity
+    p = put32(p, AVIF_HASINDEX);       // dwFlags
+    p = put32(p, frames);              // dwTotalFrames
+    p = put32(p, 0);                   // dwInitialFrames
+    p = put32(p, 1);                   // dwStreams
+    p = put32(p, buffer);              // dwSuggestedBufferSize
+    p = put32(p, width);
+    p = put32(p, height);
+    memset(p, 0, 16);                  // dwReserved
+    p += 16;
+
+    p = putCC(p, "LIST");
+    p = put32(p, 116);
+    p = putCC(p, "strl");
+
+    p = putCC(p, "strh");
+    p = put32(p, 56);
+    p = putCC(p, "vids");
+    p = putCC(p, "MJPG");
+    p = put32(p, 0);                   // dwFlags
+    p = put16(p, 0);                   // wPriority
+    p = put16(p, 0);                   // wLanguage
+    p = put32(p, 0);                   // dwInitialFrames
+    p = put32(p, 1);                   // dwScale
+    p = put32(p, fps);                 // dwRate
+    p = put32(p, 0);                   // dwStart
+    p = put32(p, frames);              // dwLength
+    p = put32(p, buffer);              // dwSuggestedBufferSize
+    p = put32(p, 0xFFFFFFFF);          // dwQuality, default
+    p = put32(p, 0);                   // dwSampleSize
+    p = put16(p, 0);                   // rcFrame
+    p = put16(p, 0);
+    p = put16(p, width);
+    p = put16(p, height);
+
+    p = putCC(p, "strf");
+    p = put32(p, 40);
+    p = put32(p, 40);                  // biSize
+    p = put32(p, width);
+    p = put32(p, height);
+    p = put16(p, 1);                   // biPlanes
+    p = put16(p, 24);                  // biBitCount
+    p = putCC(p, "MJPG");              // biCompression
+    p = put32(p, width * height * 3);  // biSizeImage
+    memset(p, 0, 16);                  // resolution and palette
+    p += 16;
+
+    p = putCC(p, "LIST");
+    p = put32(p, 4 + movi);
+    p = putCC(p, "movi");
+}
+
+// Start a file of up to maxFrames frames and write its header. A sink that
+// can't seek passes how many frames it is going to add or skip, the sum of
+// chunkSize() over all of them and the biggest of them
+bool AviWriter::begin(Sink sink, void *ctx, int width, int height, int fps, uint32_t maxFrames,
+                      uint32_t frames, uint32_t bytes, uint32_t largest)
+{
+    this->sink = sink;
+    this->ctx = ctx;
+    this->width = width;
+    this->height = height;
+    this->fps = fps > 0 ? fps : 1;
+    failed = false;
+    chunks = 0;
+    movi = 0;
+    this->largest = largest;
+
+    free(sizes);
+    sizes = (uint32_t *)(psramFound() ? ps_malloc(maxFrames * 4) : malloc(maxFrames * 4));
+    maxChunks = sizes ? maxFrames : 0;
+    if (sizes == NULL)
+        return false;
+
+    build(frames, bytes);
+    return chunk(NULL, head, AVI_HEADER_SIZE);
+}
+
+// pass bytes on to the sink, with a chunk header in front if fourcc is given
+bool AviWriter::chunk(const char *fourcc, const uint8_t *data, size_t len)
+{
+    if (failed)
+        return false;
+    if (fourcc)
+    {
+        uint8_t hdr[8];
+        putCC(hdr, fourcc);
+        put32(hdr + 4, len);
+        failed = !sink(ctx, hdr, 8);
+    }
+    if (!failed && len)
+        failed = !sink(ctx, data, len);
+    if (!failed && fourcc && (len & 1))
+    {
+        static const uint8_t pad = 0;
+        failed = !sink(ctx, &pad, 1);
+    }
+    return !failed;
+}
+
+bool AviWriter::add(const uint8_t *jpg, size_t len)
+{
+    if (chunks == maxChunks)
+        return false;
+    if (!chunk("00dc", jpg, len))
+        return false;
+    sizes[chunks++] = len;
+    movi += chunkSize(len);
+    if (len > largest)
+        largest = len;
+    return true;
+}
+
+// fill the place of a frame of len bytes that went missing
+bool AviWriter::skip(size_t len)
+{
+    if (chunks == maxChunks || failed)
+        return false;
+
+    static const uint8_t zeros[64] = {0};
+    uint8_t hdr[8];
+    putCC(hdr, "JUNK");
+    put32(hdr + 4, len);
+    failed = !sink(ctx, hdr, 8);
+    for (size_t left = (len + 1) & ~(size_t)1; !failed && left; )
+    {
+        size_t n = left < sizeof(zeros) ? left : sizeof(zeros);
+        failed = !sink(ctx, zeros, n);
+        left -= n;
+    }
+    if (failed)
+        return false;
+    sizes[chunks++] = len | AVI_JUNK;
+    movi += chunkSize(len);
+    return true;
+}
+
+// Write the index. Skipped frames show the frame before them again, or are
+// empty if there was none. The header for what was actually written is in
+// header() afterwards, for sinks that can go back and put it in place
+bool AviWriter::end(void)
+{
+    uint8_t hdr[8];
+    putCC(hdr, "idx1");
+    put32(hdr + 4, chunks * 16);
+    if (failed || !sink(ctx, hdr, 8))
+        return false;
+
+    // offsets count from the "movi" fourcc, the first chunk is right after it
+    uint8_t entries[32 * 16];
+    uint32_t offset = 4;
+    uint32_t shownAt = 4, shownLen = 0; // the last real frame
+    int n = 0;
+    for (uint32_t i = 0; i < chunks; i++)
+    {
+        uint32_t len = sizes[i] & ~AVI_JUNK;
+        if (!(sizes[i] & AVI_JUNK))
+        {
+            shownAt = offset;
+            shownLen = len;
+        }
+
+        uint8_t *p = entries + n * 16;
+        p = putCC(p, "00dc");
+        p = put32(p, AVIIF_KEYFRAME);
+        p = put32(p, shownAt);
+        put32(p, shownLen);
+        if (++n == 32)
+        {
+            if (!sink(ctx, entries, sizeof(entries)))
+                return false;
+            n = 0;
+        }
+        offset += chunkSize(len);
+    }
+    if (n && !sink(ctx, entries, n * 16))
+        return false;
+
+    build(chunks, movi);
+    return true;
+}
+
+// the frame size from a JPEG's SOF marker
+bool AviWriter::jpegSize(const uint8_t *jpg, size_t len, int &width, int &height)
+{
+    size_t i = 2;
+    while (i + 9 < len)
+    {
+        if (jpg[i] != 0xFF)
+            return false;
+        uint8_t marker = jpg[i + 1];
+        size_t seg = jpg[i + 2] << 8 | jpg[i + 3];
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+        {
+            height = jpg[i + 5] << 8 | jpg[i + 6];
+            width = jpg[i + 7] << 8 | jpg[i + 8];
+            return true;
+        }
+        i += 2 + seg;
+    }
+    return false;
+}
@@ -0,0 +1,59 @@
+#ifndef AVIWRITER_H_
+#define AVIWRITER_H_
+
+#include <Arduino.h>
+
+#define AVI_HEADER_SIZE 224 // RIFF, hdrl and the start of the movi list
+
+// Writes JPEG frames into an AVI file (RIFF, MJPG) in one pass, without
+// decoding or encoding anything. Output goes to a sink callback a piece at a
+// time, so a recording can go straight into a socket or a file.
+//
+// The header comes first but holds totals that are only known at the end.
+// Sinks that can seek, like files, rewrite header() at offset 0 after end().
+// Sinks that can't, like an HTTP response, declare the frames, their bytes and
+// the biggest of them in begin(); a frame that then can't be had any more is
+// replaced by a JUNK chunk of the same size through skip(), so the declared
+// sizes still hold, and the index shows the frame before it again.
+//
+// The idx1 index is kept as one 32-bit size per frame and written out by end().
+class AviWriter
+{
+public:
+    typedef bool (*Sink)(void *ctx, const void *data, size_t len);
+
+    AviWriter();
+    ~AviWriter();
+
+    bool begin(Sink sink, void *ctx, int width, int height, int fps, uint32_t maxFrames,
+               uint32_t frames = 0, uint32_t bytes = 0, uint32_t largest = 0);
+    bool add(const uint8_t *jpg, size_t len);
+    bool skip(size_t len);
+    bool end(void);
+
+    const uint8_t *header(void) { return head; }
+    uint32_t getFrames(void) { return chunks; }
+    uint32_t getSize(void) { return AVI_HEADER_SIZE + movi + 8 + chunks * 16; }
+
+    static size_t chunkSize(size_t len) { return 8 + ((len + 1) & ~(size_t)1); }
+    static bool jpegSize(const uint8_t *jpg, size_t len, int &width, int &height);
+
+private:
+    bool chunk(const char *fourcc, const uint8_t *data, size_t len);
+    void build(uint32_t frames, uint32_t movi);
+
+    Sink sink;
+    void *ctx;
+    bool failed;
+
+    int width, height, fps;
+    uint8_t head[AVI_HEADER_SIZE];
+
+    uint32_t *sizes;    // per chunk in movi: its payload size, the top bit set for JUNK
+    uint32_t maxChunks;
+    uint32_t chunks;    // frames, added or skipped
+    uint32_t movi;      // bytes of chunks in movi so far
+    uint32_t largest;   // frame, declared in begin() or added so far
+};
+
+#endif //AVIWRITER_H_
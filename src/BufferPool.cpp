@@ -0,0 +1,68 @@
+#include "BufferPool.h"
+
+// Allocate count slabs of at least size bytes. Only call once, before any task
+// uses the pool
+bool BufferPool::begin(size_t size, int count)
+{
+    if (count > BUFFER_POOL_MAX)
+        count = BUFFER_POOL_MAX;
+
+    // keep every slab on a cache line boundary: the block only comes back
+    // 4 or 16-byte aligned, so round its start up
+    size = (size + 31) & ~(size_t)31;
+
+    uint8_t *block = (uint8_t *)(psramFound() ? ps_malloc(size * count + 31) : malloc(size * count + 31));
+    if (block == NULL)
+        return false;
+    base = (uint8_t *)(((uintptr_t)block + 31) & ~(uintptr_t)31);
+
+    this->size = size;
+    this->count = count;
+    freeMask.store(count == 32 ? 0xFFFFFFFF : (1u << count) - 1);
+    return true;
+}
+
+// take a free slab, NULL if all are in use
+uint8_t *BufferPool::acquire(void)
+{
+    uint32_t mask = freeMask.load(std::memory_order_relaxed);
+    int slab;
+    do
+    {
+        if (mask == 0)
+        {
+            exhausted.fetch_add(1, std::memory_order_relaxed);
+            return NULL;
+        }
+        slab = __builtin_ctz(mask);
+    } while (!freeMask.compare_exchange_weak(mask, mask & ~(1u << slab), std::memory_order_acquire, std::memory_order_relaxed));
+
+    acquired.fetch_add(1, std::memory_order_relaxed);
+
+    int used = getInUse();
+    int p = peak.load(std::memory_order_relaxed);
+    while (used > p && !peak.compare_exchange_weak(p, used, std::memory_order_relaxed))
+        ;
+
+    return base + slab * size;
+}
+
+void BufferPool::release(uint8_t *buf)
+{
+    if (buf == NULL)
+        return;
+    int slab = (buf - base) / size;
+    freeMask.fetch_or(1u << slab, std::memory_order_release);
+}
+
+int BufferPool::getInUse(void)
+{
+    return count - __builtin_popcount(freeMask.load(std::memory_order_relaxed));
+}
+
+// Roughly the most a frame of this size comes out at: about 4 bits per pixel at
+// the best quality, falling off with lower settings, plus headers and tables
+size_t BufferPool::jpegBudget(int width, int height, int quality)
+{
+    return (size_t)width * height * (quality + 16) / 160 + 2048;
+}
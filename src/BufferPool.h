@@ -0,0 +1,48 @@
+#ifndef BUFFERPOOL_H_
+#define BUFFERPOOL_H_
+
+#include <Arduino.h>
+#include <atomic>
+
+#define BUFFER_POOL_MAX 32 // slabs, one bit each in the free mask
+
+// Fixed-size buffers for frames made on the device. All slabs are allocated in
+// one block (PSRAM if there is any) when the pool is set up and never again, so
+// the heap cannot fragment however the frame sizes vary. Handing a slab out and
+// taking it back is one compare-and-swap on a bit mask: O(1), lock-free and
+// safe from any task. An empty pool returns NULL and the caller drops the frame.
+class BufferPool
+{
+public:
+    BufferPool(){
+        base = NULL;
+        size = 0;
+        count = 0;
+    };
+
+    bool begin(size_t size, int count);
+    uint8_t *acquire(void);
+    void release(uint8_t *buf);
+
+    size_t getSize(void) { return size; }
+    int getCount(void) { return count; }
+    int getInUse(void);
+    int getPeak(void) { return peak.load(std::memory_order_relaxed); }
+    uint32_t getAcquired(void) { return acquired.load(std::memory_order_relaxed); }
+    uint32_t getExhausted(void) { return exhausted.load(std::memory_order_relaxed); }
+
+    // JPEG size to plan for at a resolution and UI quality (higher is better)
+    static size_t jpegBudget(int width, int height, int quality);
+
+private:
+    uint8_t *base;
+    size_t size; // bytes per slab
+    int count;
+
+    std::atomic<uint32_t> freeMask{0}; // bit i set while slab i is free
+    std::atomic<int> peak{0};
+    std::atomic<uint32_t> acquired{0};
+    std::atomic<uint32_t> exhausted{0}; // acquires that found the pool empty
+};
+
+#endif //BUFFERPOOL_H_
@@ -0,0 +1,118 @@
+#include "ClientRegistry.h"
+
+ClientRegistry::ClientRegistry(int slots)
+{
+    slotCount = slots > 0 ? slots : 1;
+    this->slots = new std::atomic<StreamClient *>[slotCount];
+    profiles = new int[slotCount];
+    evict = new std::atomic<bool>[slotCount];
+    stall = new std::atomic<uint32_t>[slotCount];
+    for (int i = 0; i < slotCount; i++)
+    {
+        this->slots[i].store(NULL);
+        profiles[i] = 0;
+        evict[i].store(false);
+        stall[i].store(0);
+    }
+    limit = REGISTRY_DEFAULT_LIMIT < slotCount ? REGISTRY_DEFAULT_LIMIT : slotCount;
+}
+
+// the clients still in it are the streaming task's to delete
+ClientRegistry::~ClientRegistry()
+{
+    delete[] slots;
+    delete[] profiles;
+    delete[] evict;
+    delete[] stall;
+}
+
+void ClientRegistry::setLimit(int limit)
+{
+    if (limit < 1)
+        limit = 1;
+    if (limit > slotCount)
+        limit = slotCount;
+    this->limit = limit;
+}
+
+// Make sure there is room for one more client, evicting the one stalled the
+// longest if the limit is reached. Returns false if the new client has to be
+// turned away
+bool ClientRegistry::admit(void)
+{
+    int active = 0;
+    int free = -1;
+    int victim = -1;
+    uint32_t worst = 0;
+    for (int i = 0; i < slotCount; i++)
+    {
+        if (get(i) == NULL)
+        {
+            free = i;
+            continue;
+        }
+        if (evicting(i))
+            continue;
+        active++;
+
+        uint32_t s = stall[i].load(std::memory_order_relaxed);
+        if (s >= REGISTRY_EVICT_STALL && s > worst)
+        {
+            worst = s;
+            victim = i;
+        }
+    }
+
+    if (free >= 0 && active < limit)
+        return true;
+    if (free < 0 || victim < 0)
+    {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    evict[victim].store(true, std::memory_order_relaxed);
+    evicted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+// put a client into a free slot. Only the web server task adds clients, so a
+// slot admit() has seen free stays free until then
+bool ClientRegistry::add(StreamClient *client, int profile)
+{
+    for (int i = 0; i < slotCount; i++)
+    {
+        if (get(i) != NULL)
+            continue;
+        profiles[i] = profile;
+        evict[i].store(false, std::memory_order_relaxed);
+        stall[i].store(0, std::memory_order_relaxed);
+        slots[i].store(client, std::memory_order_release);
+        return true;
+    }
+    return false;
+}
+
+// free the slot. The caller deletes the client
+void ClientRegistry::remove(int slot)
+{
+    slots[slot].store(NULL, std::memory_order_release);
+}
+
+int ClientRegistry::count(void)
+{
+    int n = 0;
+    for (int i = 0; i < slotCount; i++)
+        if (get(i))
+            n++;
+    return n;
+}
+
+int ClientRegistry::count(int profile)
+{
+    int n = 0;
+    for (int i = 0; i < slotCount; i++)
+        if (get(i) && profiles[i] == profile)
+            n++;
+    return n;
+}
@@ -0,0 +1,65 @@
+#ifndef CLIENTREGISTRY_H_
+#define CLIENTREGISTRY_H_
+
+#include <Arduino.h>
+#include <atomic>
+#include "StreamClient.h"
+
+#define REGISTRY_DEFAULT_LIMIT 10  // viewers, as many as the stream has always taken
+#define REGISTRY_EVICT_STALL 5000  // ms a client has to be stalled to give its place to a new one
+#define REGISTRY_DROP_STALL 30000  // ms after which a stalled client is dropped in any case
+
+// All stream clients in one slot array, sized when the registry is made: the
+// owner knows how many sockets it can spare for viewers, and the limit can be
+// set anywhere up to that. The web server task is the only one to
+// put clients in and the streaming task the only one to take them out, so a slot
+// is a single atomic pointer and neither ever waits on the other. The streaming
+// task walks the slots in place instead of popping and pushing every client
+// through a queue.
+//
+// When the limit is reached a client that has been stalled for a while makes
+// room for the new one; if none has, the new one is turned away. The server task
+// never touches a client itself: it marks one for eviction and the streaming
+// task deletes it. Per slot the registry also keeps the profile and how long the
+// client has been stalled, so it can answer those without dereferencing a client
+// that may be going away.
+class ClientRegistry
+{
+public:
+    ClientRegistry(int slots = REGISTRY_DEFAULT_LIMIT);
+    ~ClientRegistry();
+
+    void setLimit(int limit);
+    int getLimit(void) { return limit; }
+    int getSlots(void) { return slotCount; }
+
+    // web server task
+    bool admit(void);
+    bool add(StreamClient *client, int profile);
+
+    // streaming task
+    StreamClient *get(int slot) { return slots[slot].load(std::memory_order_acquire); }
+    int getProfile(int slot) { return profiles[slot]; }
+    bool evicting(int slot) { return evict[slot].load(std::memory_order_relaxed); }
+    void setStall(int slot, uint32_t ms) { stall[slot].store(ms, std::memory_order_relaxed); }
+    void remove(int slot);
+
+    // anyone
+    int count(void);
+    int count(int profile);
+    uint32_t getEvicted(void) { return evicted.load(std::memory_order_relaxed); }
+    uint32_t getRejected(void) { return rejected.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<StreamClient *> *slots;
+    int *profiles;
+    std::atomic<bool> *evict;
+    std::atomic<uint32_t> *stall; // ms, as last seen by the streaming task
+    int slotCount;
+
+    int limit;
+    std::atomic<uint32_t> evicted{0};
+    std::atomic<uint32_t> rejected{0};
+};
+
+#endif //CLIENTREGISTRY_H_
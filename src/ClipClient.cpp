@@ -0,0 +1,199 @@
+#include "ClipClient.h"
+
+static const char BOUNDARY[] = "\r\n--123456789000000000000987654321\r\n";
+
+static void *alloc(size_t size)
+{
+    return psramFound() ? ps_malloc(size) : malloc(size);
+}
+
+ClipClient::ClipClient(FrameRing &ring, bool avi) : ring(ring)
+{
+    this->avi = avi;
+    sock = -1;
+    first = 0;
+    next = 0;
+    last = 0;
+    sizes = NULL;
+    bytes = 0;
+    width = 0;
+    height = 0;
+    fps = 1;
+    largest = 0;
+    out = NULL;
+    capacity = 0;
+    len = 0;
+    sent = 0;
+    phase = CLIP_HEAD;
+    frames = 0;
+    skipped = 0;
+}
+
+ClipClient::~ClipClient()
+{
+    free(sizes);
+    free(out);
+    if (sock >= 0)
+        close(sock);
+}
+
+// Plan the clip of frames first to last and get the buffers for it. Returns
+// the HTTP status to answer with: 200 if there is a clip to send, 404 if no
+// frame of it is left and 503 if there is not enough memory
+int ClipClient::prepare(uint32_t first, uint32_t last)
+{
+    this->first = first;
+    next = first;
+    this->last = last;
+    largest = ring.largest();
+    if (first == last || largest == 0)
+        return 404;
+
+    // a frame with its chunk or part header around it, or the whole AVI index
+    uint32_t count = last - first;
+    capacity = largest + 256;
+    if (avi && count * 16 + 8 > capacity)
+        capacity = count * 16 + 8;
+    out = (uint8_t *)alloc(capacity);
+    if (out == NULL)
+        return 503;
+    if (!avi)
+        return 200;
+
+    // The AVI header holds the totals and goes out first, so the clip is
+    // planned from the ring's index before anything is sent
+    sizes = (uint32_t *)alloc(count * sizeof(uint32_t));
+    if (sizes == NULL)
+        return 503;
+    uint32_t startMs = 0, endMs = 0, ms;
+    largest = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        sizes[i] = ring.length(first + i, ms);
+        bytes += AviWriter::chunkSize(sizes[i]);
+        if (sizes[i] > largest)
+            largest = sizes[i];
+        if (sizes[i] == 0)
+            continue;
+        if (startMs == 0)
+            startMs = ms;
+        endMs = ms;
+
+        // the file is as big as the first frame still there
+        if (width == 0 && ring.copy(first + i, out, capacity, ms))
+            AviWriter::jpegSize(out, sizes[i], width, height);
+    }
+    if (width == 0)
+        return 404;
+
+    // AVI plays at a constant rate: the average over the clip
+    if (count > 1 && endMs > startMs)
+        fps = ((count - 1) * 1000 + (endMs - startMs) / 2) / (endMs - startMs);
+    return 200;
+}
+
+// AviWriter output goes into the piece being put together. A frame is there
+// already, copied in behind the room for its chunk header
+bool ClipClient::put(void *ctx, const void *data, size_t n)
+{
+    ClipClient *c = (ClipClient *)ctx;
+    if (c->len + n > c->capacity)
+        return false;
+    if (data != c->out + c->len)
+        memcpy(c->out + c->len, data, n);
+    c->len += n;
+    return true;
+}
+
+// put the next piece together, false once there is none
+bool ClipClient::fill(void)
+{
+    len = 0;
+    sent = 0;
+    switch (phase)
+    {
+    case CLIP_HEAD:
+    {
+        phase = CLIP_FRAMES;
+        if (!avi)
+        {
+            static const char head[] = "HTTP/1.1 200 OK\r\n"
+                                       "Content-Type: multipart/x-mixed-replace; boundary=123456789000000000000987654321\r\n"
+                                       "Content-disposition: attachment; filename=clip.mjpeg\r\n"
+                                       "Connection: close\r\n"
+                                       "\r\n--123456789000000000000987654321\r\n";
+            return put(this, head, sizeof(head) - 1);
+        }
+
+        uint32_t count = last - next;
+        len = snprintf((char *)out, capacity,
+                       "HTTP/1.1 200 OK\r\n"
+                       "Content-Type: video/x-msvideo\r\n"
+                       "Content-Length: %u\r\n"
+                       "Content-disposition: attachment; filename=clip.avi\r\n"
+                       "Connection: close\r\n\r\n",
+                       (unsigned)(AVI_HEADER_SIZE + bytes + 8 + count * 16));
+        return writer.begin(put, this, width, height, fps, count, count, bytes, largest);
+    }
+
+    case CLIP_FRAMES:
+        while (next != last)
+        {
+            uint32_t id = next++;
+            uint32_t ms;
+            size_t n = ring.length(id, ms);
+
+            // Frames are copied out of the ring straight to where they go in
+            // the piece, after their chunk or part header
+            size_t at = 8;
+            if (!avi && n)
+                len = snprintf((char *)out, capacity,
+                               "Content-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %u\r\n\r\n",
+                               (unsigned)n, (unsigned)ms);
+            if (!avi)
+                at = len;
+            if (n)
+                n = ring.copy(id, out + at, capacity - at, ms);
+            if (n == 0)
+            {
+                skipped++;
+                len = 0;
+                if (avi)
+                    return writer.skip(sizes[id - first]);
+                continue;
+            }
+
+            frames++;
+            if (avi)
+                return writer.add(out + at, n);
+            len += n;
+            return put(this, BOUNDARY, sizeof(BOUNDARY) - 1);
+        }
+        if (!avi)
+            return false;
+        phase = CLIP_INDEX;
+        // fall through
+
+    case CLIP_INDEX:
+        phase = CLIP_DONE;
+        return writer.end();
+
+    default:
+        return false;
+    }
+}
+
+// Send what the socket takes of the current piece, and put the next one
+// together once it is out. Returns false once the clip is done or the viewer
+// has gone, when the client can be deleted
+bool ClipClient::pump(void)
+{
+    if (sent == len && !fill())
+        return false;
+
+    int n = send(sock, out + sent, len - sent, MSG_DONTWAIT);
+    if (n < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    sent += n;
+    return sent < len || phase != CLIP_DONE;
+}
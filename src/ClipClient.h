@@ -0,0 +1,71 @@
+#ifndef CLIPCLIENT_H_
+#define CLIPCLIENT_H_
+
+#include <Arduino.h>
+#ifdef ARDUINO
+#include <lwip/sockets.h>
+#else
+#include <sys/socket.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+#include "FrameRing.h"
+#include "AviWriter.h"
+
+// A download of the last seconds out of the clip ring, as MJPEG or as an AVI
+// file. The web server hands the connection over and pumps the client whenever
+// its socket takes data, so a download over a slow link holds up neither the
+// server nor recording: each pump puts the next piece together - the headers,
+// one frame or the index - and sends as much of it as goes without blocking.
+//
+// Frames are copied out of the ring one at a time as their turn comes. For
+// MJPEG whatever got evicted meanwhile is left out; for AVI, whose header
+// declares the sizes up front, it is replaced by filler of the same size.
+class ClipClient
+{
+public:
+    ClipClient(FrameRing &ring, bool avi);
+    ~ClipClient();
+
+    int prepare(uint32_t first, uint32_t last);
+    void begin(int sock) { this->sock = sock; }
+    bool pump(void);
+
+    uint32_t getFrames(void) { return frames; }
+    uint32_t getSkipped(void) { return skipped; }
+
+private:
+    enum clip_phase_t
+    {
+        CLIP_HEAD,   // the HTTP response header, and the AVI header
+        CLIP_FRAMES, // one frame at a time
+        CLIP_INDEX,  // the AVI index
+        CLIP_DONE
+    };
+
+    bool fill(void);
+    static bool put(void *ctx, const void *data, size_t len);
+
+    FrameRing &ring;
+    bool avi;
+    int sock; // taken over from the web server, closed with the client
+
+    uint32_t first, next, last; // ring numbers of the clip's first frame, the next one and one past the end
+    uint32_t *sizes;     // AVI: each frame's size as planned, 0 if it was gone already
+    uint32_t bytes;      // AVI: the sum of chunkSize() over them
+    int width, height, fps;
+
+    AviWriter writer;
+    size_t largest; // of the clip's frames
+
+    uint8_t *out; // the piece being sent
+    size_t capacity;
+    size_t len;
+    size_t sent;
+
+    clip_phase_t phase;
+    uint32_t frames;  // sent
+    uint32_t skipped; // evicted before their turn
+};
+
+#endif //CLIPCLIENT_H_
@@ -0,0 +1,93 @@
+#include "EventStream.h"
+
+static const char EVENTS_HEADER[] = "HTTP/1.1 200 OK\r\n"
+                                    "Content-Type: text/event-stream\r\n"
+                                    "Cache-Control: no-cache\r\n"
+                                    "Access-Control-Allow-Origin: *\r\n"
+                                    "\r\n"
+                                    "retry: 2000\n\n";
+
+EventStream::EventStream()
+{
+    for (int i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++)
+        socks[i] = -1;
+    mutex = xSemaphoreCreateMutex();
+    missed = 0;
+    dropped = 0;
+}
+
+// write a whole event or nothing. False if the subscriber has to go
+bool EventStream::send(int sock, const char *buf, size_t len)
+{
+    int n = ::send(sock, buf, len, MSG_DONTWAIT);
+    if (n == (int)len)
+        return true;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        missed++;
+        return true;
+    }
+    return false;
+}
+
+// Take a socket over from the web server. Closes it and returns false if
+// all places are taken
+bool EventStream::subscribe(int sock)
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    int slot = -1;
+    for (int i = 0; i < EVENTS_MAX_SUBSCRIBERS && slot < 0; i++)
+        if (socks[i] < 0)
+            slot = i;
+    if (slot >= 0 && send(sock, EVENTS_HEADER, sizeof(EVENTS_HEADER) - 1))
+        socks[slot] = sock;
+    else
+    {
+        close(sock);
+        slot = -1;
+    }
+    xSemaphoreGive(mutex);
+    return slot >= 0;
+}
+
+// Send an event to every subscriber. False if it had to be dropped
+bool EventStream::publish(const char *event, const char *data)
+{
+    char stack[256];
+    char *buf = stack;
+    int len = snprintf(buf, sizeof(stack), "event: %s\ndata: %s\n\n", event, data);
+    if (len < 0)
+        return false;
+    if (len >= (int)sizeof(stack))
+    {
+        buf = (char *)malloc(len + 1);
+        if (buf == NULL)
+        {
+            dropped++;
+            return false;
+        }
+        snprintf(buf, len + 1, "event: %s\ndata: %s\n\n", event, data);
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (int i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++)
+    {
+        if (socks[i] < 0 || send(socks[i], buf, len))
+            continue;
+        close(socks[i]);
+        socks[i] = -1;
+    }
+    xSemaphoreGive(mutex);
+    if (buf != stack)
+        free(buf);
+    return true;
+}
+
+int EventStream::count(void)
+{
+    int n = 0;
+    for (int i = 0; i < EVENTS_MAX_SUBSCRIBERS; i++)
+        if (socks[i] >= 0)
+            n++;
+    return n;
+}
@@ -0,0 +1,47 @@
+#ifndef EVENTSTREAM_H_
+#define EVENTSTREAM_H_
+
+#include <Arduino.h>
+#ifdef ARDUINO
+#include <lwip/sockets.h>
+#else
+#include <sys/socket.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#define EVENTS_MAX_SUBSCRIBERS 2 // browsers with the settings page open
+
+// Server-Sent Events for the settings page: setting changes and stats are
+// pushed to every open page instead of the page polling for them. The web
+// server hands a subscriber's socket over and forgets about it, like it does
+// for stream clients.
+//
+// Events are small and infrequent, so publish() writes them straight out
+// without waiting. A subscriber whose socket is full misses the event; one
+// whose socket has failed, or took only part of an event, is dropped. An
+// event too big for the stack, like a whole /set worth of settings, is put
+// together on the heap, and only dropped if there is no room there. Safe
+// from any task.
+class EventStream
+{
+public:
+    EventStream();
+
+    bool subscribe(int sock);
+    bool publish(const char *event, const char *data);
+
+    int count(void);
+    uint32_t getMissed(void) { return missed; }
+    uint32_t getDropped(void) { return dropped; }
+
+private:
+    bool send(int sock, const char *buf, size_t len);
+
+    int socks[EVENTS_MAX_SUBSCRIBERS];
+    SemaphoreHandle_t mutex;
+    uint32_t missed;  // events subscribers missed for a full socket
+    uint32_t dropped; // events nobody got for want of memory
+};
+
+#endif //EVENTSTREAM_H_
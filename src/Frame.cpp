@@ -0,0 +1,112 @@
+#include "Frame.h"
+
+// Frames are never freed, only recycled, so a handle stays valid memory even
+// after it has been released.
+static Frame framePool[FRAME_POOL_SIZE];
+
+Frame *Frame::wrap(camera_fb_t *fb, void (*done)(camera_fb_t *))
+{
+    if (!fb)
+        return NULL;
+
+    for (int i = 0; i < FRAME_POOL_SIZE; i++)
+    {
+        int expected = 0;
+        if (framePool[i].refs.compare_exchange_strong(expected, 1))
+        {
+            framePool[i].fb = fb;
+            framePool[i].done = done;
+            return &framePool[i];
+        }
+    }
+
+    // every slot is taken: give the buffer straight back and drop this frame
+    done(fb);
+    return NULL;
+}
+
+void Frame::retain(void)
+{
+    refs.fetch_add(1);
+}
+
+// take a reference unless the frame has already been released for good
+bool Frame::tryRetain(void)
+{
+    int n = refs.load();
+    while (n > 0)
+    {
+        if (refs.compare_exchange_weak(n, n + 1))
+            return true;
+    }
+    return false;
+}
+
+void Frame::release(void)
+{
+    // read the buffer while we still hold a reference; once the count drops to
+    // zero the slot may be claimed by the capture task at any moment
+    camera_fb_t *b = fb;
+    void (*d)(camera_fb_t *) = done;
+    if (refs.fetch_sub(1) == 1)
+        d(b);
+}
+
+// A fast hash of the JPEG payload, to tell a frame that is byte for byte the
+// same as the one before. Reads a word at a time, which matters with the
+// frame in PSRAM
+uint32_t Frame::hash(void)
+{
+    const uint8_t *p = fb->buf;
+    size_t n = fb->len;
+    uint32_t h = 2166136261u ^ n;
+
+    for (; n >= 4; n -= 4, p += 4)
+    {
+        uint32_t w;
+        memcpy(&w, p, 4);
+        h = (h ^ w) * 16777619u;
+        h ^= h >> 15;
+    }
+    while (n--)
+        h = (h ^ *p++) * 16777619u;
+    return h;
+}
+
+// producer side: make f the newest frame, taking over the caller's reference
+void FrameExchange::publish(Frame *f)
+{
+    f->seq = ++seq;
+    f->partLen = snprintf(f->part, sizeof(f->part),
+                          "Content-Type: image/jpeg\r\n"
+                          "Content-Length: %u\r\n"
+                          "X-Timestamp: %ld.%06ld\r\n"
+                          "X-Frame: %u\r\n\r\n",
+                          (unsigned)f->fb->len, (long)f->fb->timestamp.tv_sec, (long)f->fb->timestamp.tv_usec, (unsigned)f->seq);
+
+    Frame *old = latest.exchange(f);
+    if (old)
+        old->release();
+}
+
+// consumer side: reference the newest frame, NULL if nothing was published yet
+Frame *FrameExchange::acquire(void)
+{
+    for (;;)
+    {
+        Frame *f = latest.load();
+        if (!f)
+            return NULL;
+
+        // The producer may replace and release f at any moment, and its pool slot
+        // may even be recycled for a newer frame. Frames are never freed, so it is
+        // safe to try: if we got a reference and f is still the one published, it
+        // can't go away under us. Otherwise drop it and look again.
+        if (f->tryRetain())
+        {
+            if (latest.load() == f)
+                return f;
+            f->release();
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef FRAME_H_
+#define FRAME_H_
+
+#include <Arduino.h>
+#include <atomic>
+#include "esp_camera.h"
+
+// Number of frames that can be in flight at once: the camera's fb_count plus
+// whatever thumbnails and, in raw mode, encoded frames are being sent
+#define FRAME_POOL_SIZE 12
+
+// A reference-counted handle on a camera driver buffer. The capture task wraps
+// every buffer it gets from the driver and all clients send straight out of it;
+// the buffer goes back to the driver when the last reference is released.
+// Frames made on the device, like thumbnails, pass their own done callback.
+class Frame
+{
+public:
+    Frame(){
+        fb = NULL;
+    };
+
+    static Frame *wrap(camera_fb_t *fb, void (*done)(camera_fb_t *) = esp_camera_fb_return);
+    void retain(void);
+    bool tryRetain(void);
+    void release(void);
+
+    uint8_t *getBuf(void) { return fb->buf; }
+    size_t getSize(void) { return fb->len; }
+    int getWidth(void) { return fb->width; }
+    int getHeight(void) { return fb->height; }
+    pixformat_t getFormat(void) { return fb->format; }
+    uint32_t getSeq(void) { return seq; }
+    const struct timeval &getTimestamp(void) { return fb->timestamp; }
+    uint32_t hash(void);
+
+    // the multipart header that goes in front of this frame in a stream
+    const char *getPart(void) { return part; }
+    size_t getPartLen(void) { return partLen; }
+
+private:
+    friend class FrameExchange;
+
+    camera_fb_t *fb;
+    void (*done)(camera_fb_t *); // hands fb back once the last reference is gone
+    uint32_t seq; // publication order, set by FrameExchange::publish()
+    std::atomic<int> refs{0};
+
+    // built once on publication, so clients don't each format their own
+    char part[128];
+    size_t partLen;
+
+};
+
+// Lock-free hand-off of the newest frame from the capture task to any number of
+// readers. The capture task never waits on a reader and a reader always gets the
+// newest complete frame: frames are immutable once published and stay alive for
+// as long as somebody holds a reference.
+class FrameExchange
+{
+public:
+    FrameExchange(){
+        seq = 0;
+    };
+
+    void publish(Frame *f);
+    Frame *acquire(void);
+
+private:
+    std::atomic<Frame *> latest{NULL}; // holds one reference of its own
+    uint32_t seq;
+};
+
+#endif //FRAME_H_
@@ -0,0 +1,136 @@
+#include "FrameRing.h"
+
+// Allocate the ring and its index. Only call once, before any task uses it
+bool FrameRing::begin(size_t budget)
+{
+    if (budget == 0)
+        return false;
+    data = (uint8_t *)(psramFound() ? ps_malloc(budget) : malloc(budget));
+    index = (Entry *)(psramFound() ? ps_malloc(RING_INDEX * sizeof(Entry)) : malloc(RING_INDEX * sizeof(Entry)));
+    if (data == NULL || index == NULL)
+    {
+        free(data);
+        free(index);
+        data = NULL;
+        index = NULL;
+        return false;
+    }
+    this->budget = budget;
+    return true;
+}
+
+// drop the oldest frame. Called locked
+void FrameRing::evict(void)
+{
+    used -= index[tail % RING_INDEX].len;
+    tail++;
+    evicted++;
+}
+
+// Copy a frame in, evicting as many of the oldest as it takes. Frames bigger
+// than half the ring would leave nothing else in it and are left out
+bool FrameRing::add(const uint8_t *buf, size_t len, uint32_t ms)
+{
+    if (data == NULL || len == 0 || len > budget / 2)
+        return false;
+
+    lock();
+    size_t at = wr;
+    bool wrap = at + len > budget;
+    if (wrap)
+        at = 0; // the rest of the end stays unused this time around
+
+    // Frames sit in the ring in the order they came in, so the ones in the way
+    // are always the oldest. On a wrap that is first whatever is left between
+    // here and the end, then whatever the new frame overlaps at the start
+    while (tail != head)
+    {
+        Entry &e = index[tail % RING_INDEX];
+        bool inWay = (wrap && e.offset >= wr) || (e.offset < at + len && at < e.offset + e.len);
+        if (!inWay && head - tail < RING_INDEX)
+            break;
+        evict();
+    }
+
+    // Nobody copies a frame that is being written: it only gets its number once it is in
+    unlock();
+    memcpy(data + at, buf, len);
+    lock();
+
+    Entry &e = index[head % RING_INDEX];
+    e.offset = at;
+    e.len = len;
+    e.ms = ms;
+    head++;
+    wr = at + len;
+    used += len;
+    written += len;
+    unlock();
+    return true;
+}
+
+// number of the first frame captured at or after since, end() if there is none
+uint32_t FrameRing::find(uint32_t since)
+{
+    lock();
+    uint32_t id = tail;
+    while (id != head && (int32_t)(index[id % RING_INDEX].ms - since) < 0)
+        id++;
+    unlock();
+    return id;
+}
+
+// Copy frame id out, with its capture time. 0 if it has been evicted meanwhile
+// or doesn't fit
+size_t FrameRing::copy(uint32_t id, uint8_t *out, size_t capacity, uint32_t &ms)
+{
+    size_t len = 0;
+    lock();
+    if (id - tail < head - tail)
+    {
+        Entry &e = index[id % RING_INDEX];
+        if (e.len <= capacity)
+        {
+            memcpy(out, data + e.offset, e.len);
+            len = e.len;
+            ms = e.ms;
+        }
+    }
+    unlock();
+    return len;
+}
+
+// size and capture time of frame id without copying it, 0 if it has been evicted
+size_t FrameRing::length(uint32_t id, uint32_t &ms)
+{
+    size_t len = 0;
+    lock();
+    if (id - tail < head - tail)
+    {
+        len = index[id % RING_INDEX].len;
+        ms = index[id % RING_INDEX].ms;
+    }
+    unlock();
+    return len;
+}
+
+// the biggest frame held, what a reader's buffer has to take
+size_t FrameRing::largest(void)
+{
+    size_t max = 0;
+    lock();
+    for (uint32_t id = tail; id != head; id++)
+        if (index[id % RING_INDEX].len > max)
+            max = index[id % RING_INDEX].len;
+    unlock();
+    return max;
+}
+
+// ms between the oldest and the newest frame held
+uint32_t FrameRing::getSpan(void)
+{
+    lock();
+    uint32_t span = head - tail > 1 ? index[(head - 1) % RING_INDEX].ms - index[tail % RING_INDEX].ms : 0;
+    unlock();
+    return span;
+}
@@ -0,0 +1,77 @@
+#ifndef FRAMERING_H_
+#define FRAMERING_H_
+
+#include <Arduino.h>
+
+#define RING_INDEX 512 // frames the ring can hold at most, a power of two
+
+// The last few seconds of JPEG frames, kept in one PSRAM block so a clip of
+// what happened before an incident can be had afterwards. Frames are copied in
+// back to back and wrap around at the end; a new frame evicts the oldest ones
+// it overlaps, so the ring holds as many seconds as its byte budget allows,
+// whatever the frames come out at.
+//
+// Frames are numbered as they come in and the index is a small circular array
+// of offset, length and timestamp. A number stays valid until its frame is
+// evicted; copy() says when that has happened. One task adds frames, any task
+// can copy them out. Copies are taken under a short lock, so a slow reader
+// never holds up recording.
+class FrameRing
+{
+public:
+    FrameRing(){
+        data = NULL;
+        index = NULL;
+        budget = 0;
+        head = 0;
+        tail = 0;
+        wr = 0;
+        used = 0;
+        written = 0;
+        evicted = 0;
+        mutex = xSemaphoreCreateMutex();
+    };
+
+    bool begin(size_t budget);
+    bool add(const uint8_t *buf, size_t len, uint32_t ms);
+
+    uint32_t find(uint32_t since);
+    uint32_t end(void) { return head; }
+    size_t copy(uint32_t id, uint8_t *out, size_t capacity, uint32_t &ms);
+    size_t length(uint32_t id, uint32_t &ms);
+    size_t largest(void);
+
+    size_t getBudget(void) { return budget; }
+    size_t getUsed(void) { return used; }
+    uint32_t getFrames(void) { return head - tail; }
+    uint32_t getWritten(void) { return written; }
+    uint32_t getEvicted(void) { return evicted; }
+    uint32_t getSpan(void);
+
+private:
+    struct Entry
+    {
+        uint32_t offset;
+        uint32_t len;
+        uint32_t ms; // millis() of the capture
+    };
+
+    void evict(void);
+    void lock(void) { xSemaphoreTake(mutex, portMAX_DELAY); }
+    void unlock(void) { xSemaphoreGive(mutex); }
+
+    uint8_t *data;
+    Entry *index;
+    size_t budget;
+
+    uint32_t head; // number of the next frame
+    uint32_t tail; // number of the oldest frame still held
+    size_t wr;     // where the next frame goes
+    size_t used;   // bytes held
+
+    uint32_t written; // bytes copied in so far
+    uint32_t evicted; // frames dropped to make room
+    SemaphoreHandle_t mutex;
+};
+
+#endif //FRAMERING_H_
@@ -0,0 +1,669 @@
+#include "HttpServer.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <lwip/sockets.h>
+#else
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+#define HTTP_WRITE_TIMEOUT 5 // s a blocking write waits for the socket to drain
+
+static uint32_t nowMs(void)
+{
+#ifdef ARDUINO
+    return millis();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+static const char *statusText(int code)
+{
+    switch (code)
+    {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 413: return "Payload Too Large";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+    }
+}
+
+// decode %xx escapes and '+' in place
+static void urlDecode(char *s)
+{
+    char *d = s;
+    for (; *s; s++)
+    {
+        if (*s == '+')
+            *d++ = ' ';
+        else if (*s == '%' && isxdigit((unsigned char)s[1]) && isxdigit((unsigned char)s[2]))
+        {
+            char hex[3] = {s[1], s[2], 0};
+            *d++ = (char)strtol(hex, NULL, 16);
+            s += 2;
+        }
+        else
+            *d++ = *s;
+    }
+    *d = 0;
+}
+
+// offset just past the blank line ending the header, 0 while it is incomplete
+static size_t headerEnd(const char *buf, size_t len)
+{
+    for (size_t i = 3; i < len; i++)
+        if (buf[i] == '\n' && buf[i - 1] == '\r' && buf[i - 2] == '\n' && buf[i - 3] == '\r')
+            return i + 1;
+    return 0;
+}
+
+// value of the Content-Length header without touching the buffer, which may
+// still be waiting for the rest of the body
+static size_t scanContentLength(const char *buf, size_t end)
+{
+    static const char name[] = "\ncontent-length:";
+    const size_t n = sizeof(name) - 1;
+    for (size_t i = 0; i + n < end; i++)
+        if (strncasecmp(buf + i, name, n) == 0)
+            return strtoul(buf + i + n, NULL, 10);
+    return 0;
+}
+
+// write all of it, waiting for the socket to drain if it has to
+static bool writeAll(int sock, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    while (len)
+    {
+        int n = ::send(sock, p, len, MSG_DONTWAIT);
+        if (n < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return false;
+
+            fd_set wr;
+            FD_ZERO(&wr);
+            FD_SET(sock, &wr);
+            struct timeval tv = {HTTP_WRITE_TIMEOUT, 0};
+            if (::select(sock + 1, NULL, &wr, NULL, &tv) <= 0)
+                return false;
+            continue;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+HttpServer::HttpServer(int port)
+{
+    this->port = port;
+    listener = -1;
+    routeCount = 0;
+    notFound = NULL;
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+    {
+        conns[i].sock = -1;
+        conns[i].len = 0;
+    }
+    for (int i = 0; i < HTTP_MAX_PUMPS; i++)
+        pumps[i].sock = -1;
+    waited = 0;
+    current = NULL;
+    verb = HTTP_METHOD_OTHER;
+    path = NULL;
+    argCount = 0;
+    headerCount = 0;
+    content = NULL;
+    contentLength = 0;
+    keepAlive = false;
+    responded = false;
+    chunked = false;
+    chunks = 0;
+    detached = false;
+    extraLen = 0;
+}
+
+void HttpServer::on(const char *uri, http_method_t method, Handler handler)
+{
+    if (routeCount >= HTTP_MAX_HANDLERS)
+        return;
+    routes[routeCount].uri = uri;
+    routes[routeCount].method = method;
+    routes[routeCount].handler = handler;
+    routeCount++;
+}
+
+void HttpServer::onNotFound(Handler handler)
+{
+    notFound = handler;
+}
+
+bool HttpServer::begin(void)
+{
+    listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listener < 0)
+        return false;
+
+    int one = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (::bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(listener, 5) < 0)
+    {
+        ::close(listener);
+        listener = -1;
+        return false;
+    }
+    ::fcntl(listener, F_SETFL, ::fcntl(listener, F_GETFL, 0) | O_NONBLOCK);
+
+    // port 0 lets the stack pick one, find out which
+    socklen_t len = sizeof(addr);
+    if (::getsockname(listener, (struct sockaddr *)&addr, &len) == 0)
+        port = ntohs(addr.sin_port);
+    return true;
+}
+
+// Sleep until a connection comes in, one of the open ones has something to
+// say or a pumped response's socket takes more, then serve whatever has
+// arrived and pump whatever can go. Without open connections or pumped
+// responses this blocks for as long as it takes; with some it wakes up once a
+// second to drop the ones that have gone quiet.
+void HttpServer::handleClient(void)
+{
+    if (listener < 0)
+        return;
+
+    fd_set rd, wr;
+    FD_ZERO(&rd);
+    FD_ZERO(&wr);
+    FD_SET(listener, &rd);
+    int maxfd = listener;
+    bool open = false;
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+    {
+        if (conns[i].sock < 0)
+            continue;
+        FD_SET(conns[i].sock, &rd);
+        if (conns[i].sock > maxfd)
+            maxfd = conns[i].sock;
+        open = true;
+    }
+    for (int i = 0; i < HTTP_MAX_PUMPS; i++)
+    {
+        if (pumps[i].sock < 0)
+            continue;
+        FD_SET(pumps[i].sock, &wr);
+        if (pumps[i].sock > maxfd)
+            maxfd = pumps[i].sock;
+        open = true;
+    }
+
+    struct timeval tv = {1, 0};
+    uint32_t start = nowMs();
+    int ready = ::select(maxfd + 1, &rd, &wr, NULL, open ? &tv : NULL);
+    waited += nowMs() - start;
+    if (ready < 0)
+        return;
+
+    if (FD_ISSET(listener, &rd))
+        accept();
+
+    // one piece per pumped response and pass, so a fast download doesn't
+    // keep the requests below waiting. A viewer that stopped reading never
+    // lets its socket take more, and is given up on like a quiet connection
+    uint32_t now = nowMs();
+    for (int i = 0; i < HTTP_MAX_PUMPS; i++)
+    {
+        Pumped &p = pumps[i];
+        if (p.sock < 0)
+            continue;
+        if (FD_ISSET(p.sock, &wr))
+        {
+            p.active = now;
+            if (!p.pump(p.ctx, false))
+                p.sock = -1;
+        }
+        else if (now - p.active > HTTP_IDLE_TIMEOUT)
+        {
+            p.pump(p.ctx, true);
+            p.sock = -1;
+        }
+    }
+
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+    {
+        Connection &c = conns[i];
+        if (c.sock < 0)
+            continue;
+        if (FD_ISSET(c.sock, &rd))
+            receive(c);
+        else if (now - c.active > HTTP_IDLE_TIMEOUT)
+            drop(c);
+    }
+}
+
+// take every pending connection. When all slots are busy the one quiet for the
+// longest makes room
+void HttpServer::accept(void)
+{
+    for (;;)
+    {
+        int sock = ::accept(listener, NULL, NULL);
+        if (sock < 0)
+            return;
+
+        Connection *slot = NULL;
+        for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+        {
+            Connection &c = conns[i];
+            if (c.sock < 0)
+            {
+                slot = &c;
+                break;
+            }
+            if (slot == NULL || (int32_t)(c.active - slot->active) < 0)
+                slot = &c;
+        }
+        if (slot->sock >= 0)
+            drop(*slot);
+
+        ::fcntl(sock, F_SETFL, ::fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+        int one = 1;
+        ::setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        slot->sock = sock;
+        slot->len = 0;
+        slot->active = nowMs();
+    }
+}
+
+// read what has arrived and serve every complete request in it
+void HttpServer::receive(Connection &c)
+{
+    int n = ::recv(c.sock, c.buf + c.len, HTTP_REQUEST_SIZE - c.len, MSG_DONTWAIT);
+    if (n <= 0)
+    {
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+            drop(c);
+        return;
+    }
+    c.len += n;
+    c.active = nowMs();
+
+    while (c.sock >= 0)
+    {
+        size_t used = parse(c);
+        if (used == 0)
+        {
+            // a request that can never fit
+            if (c.len == HTTP_REQUEST_SIZE)
+            {
+                current = &c;
+                verb = HTTP_METHOD_OTHER;
+                keepAlive = false;
+                responded = false;
+                extraLen = 0;
+                send(413, "text/plain", "Request too large");
+                drop(c);
+            }
+            return;
+        }
+
+        // the body is terminated for the handler, borrowing the first byte of
+        // whatever follows it
+        char saved = c.buf[used];
+        c.buf[used] = 0;
+        dispatch(c);
+        if (c.sock < 0)
+            return;
+        c.buf[used] = saved;
+
+        memmove(c.buf, c.buf + used, c.len - used);
+        c.len -= used;
+    }
+}
+
+// split a complete request up in place. Returns its length including the body,
+// 0 if it has not all arrived yet
+size_t HttpServer::parse(Connection &c)
+{
+    size_t end = headerEnd(c.buf, c.len);
+    if (end == 0)
+        return 0;
+    size_t bodyLen = scanContentLength(c.buf, end);
+    if (bodyLen > HTTP_REQUEST_SIZE - end)
+        bodyLen = HTTP_REQUEST_SIZE; // can never fit, left to the caller to refuse
+    if (end + bodyLen > c.len)
+        return 0;
+
+    c.buf[end - 2] = 0;
+    char *line = c.buf;
+    char *next = strstr(line, "\r\n");
+    if (next)
+        *next = 0;
+
+    // request line
+    char *target = strchr(line, ' ');
+    char *version = target ? strchr(target + 1, ' ') : NULL;
+    if (target)
+        *target++ = 0;
+    if (version)
+        *version++ = 0;
+
+    if (strcmp(line, "GET") == 0)
+        verb = HTTP_METHOD_GET;
+    else if (strcmp(line, "POST") == 0)
+        verb = HTTP_METHOD_POST;
+    else if (strcmp(line, "HEAD") == 0)
+        verb = HTTP_METHOD_HEAD;
+    else
+        verb = HTTP_METHOD_OTHER;
+    keepAlive = version && strcmp(version, "HTTP/1.0") != 0;
+
+    path = target ? target : (char *)"";
+    argCount = 0;
+    char *query = strchr(path, '?');
+    if (query)
+    {
+        *query++ = 0;
+        while (query && *query && argCount < HTTP_MAX_ARGS)
+        {
+            char *amp = strchr(query, '&');
+            if (amp)
+                *amp++ = 0;
+            char *eq = strchr(query, '=');
+            if (eq)
+                *eq++ = 0;
+            urlDecode(query);
+            argNames[argCount] = query;
+            argValues[argCount] = eq ? eq : (char *)"";
+            if (eq)
+                urlDecode(eq);
+            argCount++;
+            query = amp;
+        }
+    }
+    urlDecode(path);
+
+    // headers
+    headerCount = 0;
+    while (next && headerCount < HTTP_MAX_HEADERS)
+    {
+        line = next + 2;
+        next = strstr(line, "\r\n");
+        if (next)
+            *next = 0;
+        char *colon = strchr(line, ':');
+        if (colon == NULL)
+            continue;
+        *colon++ = 0;
+        while (*colon == ' ')
+            colon++;
+        headerNames[headerCount] = line;
+        headerValues[headerCount] = colon;
+        headerCount++;
+
+        if (strcasecmp(line, "Connection") == 0)
+        {
+            if (strcasecmp(colon, "close") == 0)
+                keepAlive = false;
+            else if (strcasecmp(colon, "keep-alive") == 0)
+                keepAlive = true;
+        }
+    }
+
+    content = c.buf + end;
+    contentLength = bodyLen;
+    return end + bodyLen;
+}
+
+// run the handler for the request parse() has just split up and settle what
+// happens to the connection afterwards
+void HttpServer::dispatch(Connection &c)
+{
+    current = &c;
+    responded = false;
+    chunked = false;
+    detached = false;
+    extraLen = 0;
+
+    Handler handler = notFound;
+    for (int i = 0; i < routeCount; i++)
+    {
+        Route &r = routes[i];
+        if (strcmp(r.uri, path) == 0 && (r.method == HTTP_METHOD_ANY || r.method == verb))
+        {
+            handler = r.handler;
+            break;
+        }
+    }
+    if (handler)
+        handler();
+    else
+        send(404, "text/plain", "Not found");
+    if (chunked)
+        endChunked();
+
+    if (detached)
+    {
+        // the handler owns the socket now
+        c.sock = -1;
+        c.len = 0;
+    }
+    else if (!responded || !keepAlive)
+    {
+        // the handler wrote a response of unknown length, so closing the
+        // connection is what ends it
+        drop(c);
+    }
+    current = NULL;
+}
+
+void HttpServer::drop(Connection &c)
+{
+    ::close(c.sock);
+    c.sock = -1;
+    c.len = 0;
+}
+
+const char *HttpServer::arg(const char *name)
+{
+    for (int i = 0; i < argCount; i++)
+        if (strcmp(argNames[i], name) == 0)
+            return argValues[i];
+    return "";
+}
+
+bool HttpServer::hasArg(const char *name)
+{
+    for (int i = 0; i < argCount; i++)
+        if (strcmp(argNames[i], name) == 0)
+            return true;
+    return false;
+}
+
+const char *HttpServer::header(const char *name)
+{
+    for (int i = 0; i < headerCount; i++)
+        if (strcasecmp(headerNames[i], name) == 0)
+            return headerValues[i];
+    return NULL;
+}
+
+// add a header line to the next response
+void HttpServer::sendHeader(const char *name, const char *value)
+{
+    int n = snprintf(extra + extraLen, sizeof(extra) - extraLen, "%s: %s\r\n", name, value);
+    if (n > 0 && extraLen + n < sizeof(extra))
+        extraLen += n;
+    else
+        extra[extraLen] = 0;
+}
+
+void HttpServer::send(int code, const char *type, const char *content)
+{
+    send(code, type, (const uint8_t *)content, strlen(content));
+}
+
+void HttpServer::send(int code, const char *type, const uint8_t *data, size_t len)
+{
+    if (current == NULL || responded)
+        return;
+    responded = true;
+
+    // 204 and 304 never have a body, nor a type or length for one
+    char entity[128] = "";
+    if (code != 204 && code != 304)
+        snprintf(entity, sizeof(entity), "Content-Type: %s\r\nContent-Length: %u\r\n", type, (unsigned)len);
+    else
+        len = 0;
+
+    if (!head(code, entity) || (verb != HTTP_METHOD_HEAD && len && !writeAll(current->sock, data, len)))
+        keepAlive = false;
+}
+
+// status line and headers of a response, the entity headers given
+bool HttpServer::head(int code, const char *entity)
+{
+    char buf[512];
+    int n = snprintf(buf, sizeof(buf),
+                     "HTTP/1.1 %d %s\r\n"
+                     "%s"
+                     "%.*s"
+                     "Connection: %s\r\n\r\n",
+                     code, statusText(code), entity,
+                     (int)extraLen, extra, keepAlive ? "keep-alive" : "close");
+    extraLen = 0;
+    return writeAll(current->sock, buf, n);
+}
+
+// Start a response whose length isn't known up front. The body follows in any
+// number of sendChunk() calls and endChunked() marks its end, so unlike with
+// write() the connection can be kept. The server ends it if the handler doesn't
+bool HttpServer::beginChunked(int code, const char *type)
+{
+    if (current == NULL || responded)
+        return false;
+    responded = true;
+
+    char entity[128];
+    snprintf(entity, sizeof(entity), "Content-Type: %s\r\nTransfer-Encoding: chunked\r\n", type);
+    if (!head(code, entity))
+    {
+        keepAlive = false;
+        return false;
+    }
+    chunked = verb != HTTP_METHOD_HEAD;
+    chunks = 0;
+    return true;
+}
+
+// One piece of the body. The line ending the piece before goes out together
+// with the size line of this one, so a piece takes two writes
+bool HttpServer::sendChunk(const void *data, size_t len)
+{
+    if (!chunked)
+        return verb == HTTP_METHOD_HEAD && responded;
+    if (len == 0)
+        return true;
+
+    char size[16];
+    int n = snprintf(size, sizeof(size), "%s%x\r\n", chunks ? "\r\n" : "", (unsigned)len);
+    if (!writeAll(current->sock, size, n) || !writeAll(current->sock, data, len))
+    {
+        chunked = false;
+        keepAlive = false;
+        return false;
+    }
+    chunks++;
+    return true;
+}
+
+bool HttpServer::endChunked(void)
+{
+    if (!chunked)
+        return verb == HTTP_METHOD_HEAD && responded;
+    chunked = false;
+
+    const char *last = chunks ? "\r\n0\r\n\r\n" : "0\r\n\r\n";
+    if (!writeAll(current->sock, last, strlen(last)))
+    {
+        keepAlive = false;
+        return false;
+    }
+    return true;
+}
+
+// raw bytes for handlers that build their own response. The connection is
+// closed after the handler returns
+bool HttpServer::write(const void *data, size_t len)
+{
+    if (current == NULL)
+        return false;
+    return writeAll(current->sock, data, len);
+}
+
+// hand the connection over to the handler, which has to close it when done.
+// The server forgets about it once the handler returns
+int HttpServer::detach(void)
+{
+    if (current == NULL)
+        return -1;
+    detached = true;
+    return current->sock;
+}
+
+// Like detach(), but the server keeps calling pump with ctx whenever the
+// socket can take more, until it returns false. The callback writes without
+// blocking and closes the socket when done, or when told the viewer stalled. Returns the socket, or -1 if as
+// many responses as there can be are being pumped already
+int HttpServer::pump(Pump pump, void *ctx)
+{
+    if (current == NULL)
+        return -1;
+    for (int i = 0; i < HTTP_MAX_PUMPS; i++)
+        if (pumps[i].sock < 0)
+        {
+            pumps[i].sock = current->sock;
+            pumps[i].pump = pump;
+            pumps[i].ctx = ctx;
+            pumps[i].active = nowMs();
+            detached = true;
+            return current->sock;
+        }
+    return -1;
+}
+
+int HttpServer::pumping(void)
+{
+    int n = 0;
+    for (int i = 0; i < HTTP_MAX_PUMPS; i++)
+        if (pumps[i].sock >= 0)
+            n++;
+    return n;
+}
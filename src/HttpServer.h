@@ -0,0 +1,136 @@
+#ifndef HTTPSERVER_H_
+#define HTTPSERVER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define HTTP_MAX_CONNECTIONS 2    // keep-alive connections served at once, the quietest makes room for a new one
+#define HTTP_MAX_HANDLERS 24
+#define HTTP_MAX_ARGS 16
+#define HTTP_MAX_HEADERS 16
+#define HTTP_REQUEST_SIZE 1536    // request line, headers and body together
+#define HTTP_IDLE_TIMEOUT 5000    // ms before an idle keep-alive connection is closed
+#define HTTP_MAX_PUMPS 1          // long responses written a piece at a time, like a clip download
+
+enum http_method_t
+{
+    HTTP_METHOD_ANY,
+    HTTP_METHOD_GET,
+    HTTP_METHOD_POST,
+    HTTP_METHOD_HEAD,
+    HTTP_METHOD_OTHER
+};
+
+// A small HTTP/1.1 server on plain BSD sockets, so it runs the same on lwIP
+// and on Linux. Instead of being polled it sleeps in select() on the listening
+// socket and all open connections and handles a request the moment it has
+// arrived. Connections are kept alive between requests.
+//
+// Handlers are registered and written the same way as for the Arduino
+// WebServer: a plain function that asks the server for uri(), arg() and
+// friends and answers with send(). A handler that wants to keep the socket for
+// itself, like a stream, takes it over with detach(). One with more to send
+// than it should block the server for hands it to pump() instead: the server
+// then calls back whenever the socket takes more, in between requests, and
+// once more to give up if the socket takes nothing for HTTP_IDLE_TIMEOUT.
+class HttpServer
+{
+public:
+    typedef void (*Handler)(void);
+    typedef bool (*Pump)(void *ctx, bool stalled); // false once done or stalled, having cleaned up ctx
+
+    HttpServer(int port);
+
+    void on(const char *uri, http_method_t method, Handler handler);
+    void onNotFound(Handler handler);
+    bool begin(void);
+    void handleClient(void);
+    int getPort(void) { return port; }
+    uint32_t getWaitMs(void) { return waited; }
+
+    // the request being handled
+    const char *uri(void) { return path; }
+    http_method_t method(void) { return verb; }
+    int args(void) { return argCount; }
+    const char *argName(int i) { return argNames[i]; }
+    const char *arg(int i) { return argValues[i]; }
+    const char *arg(const char *name);
+    bool hasArg(const char *name);
+    const char *header(const char *name);
+    const char *body(void) { return content; }
+    size_t bodyLength(void) { return contentLength; }
+
+    // answering it
+    void sendHeader(const char *name, const char *value);
+    void send(int code, const char *type, const char *content);
+    void send(int code, const char *type, const uint8_t *data, size_t len);
+    bool beginChunked(int code, const char *type);
+    bool sendChunk(const void *data, size_t len);
+    bool endChunked(void);
+    bool write(const void *data, size_t len);
+    int detach(void);
+    int pump(Pump pump, void *ctx);
+    int pumping(void);
+
+private:
+    struct Route
+    {
+        const char *uri;
+        http_method_t method;
+        Handler handler;
+    };
+
+    struct Pumped
+    {
+        int sock;
+        Pump pump;
+        void *ctx;
+        uint32_t active; // ms the socket last took more
+    };
+
+    struct Connection
+    {
+        int sock;
+        uint32_t active; // ms of the last activity
+        size_t len;
+        char buf[HTTP_REQUEST_SIZE + 1]; // room to terminate a body that fills it
+    };
+
+    void accept(void);
+    void receive(Connection &c);
+    size_t parse(Connection &c);
+    void dispatch(Connection &c);
+    void drop(Connection &c);
+    bool head(int code, const char *entity);
+
+    int port;
+    int listener;
+    uint32_t waited; // ms spent in select() so far
+    Route routes[HTTP_MAX_HANDLERS];
+    int routeCount;
+    Handler notFound;
+    Connection conns[HTTP_MAX_CONNECTIONS];
+    Pumped pumps[HTTP_MAX_PUMPS];
+
+    // state of the request being handled
+    Connection *current;
+    http_method_t verb;
+    char *path;
+    int argCount;
+    char *argNames[HTTP_MAX_ARGS];
+    char *argValues[HTTP_MAX_ARGS];
+    int headerCount;
+    char *headerNames[HTTP_MAX_HEADERS];
+    char *headerValues[HTTP_MAX_HEADERS];
+    char *content;
+    size_t contentLength;
+    bool keepAlive;
+    bool responded;
+    bool chunked;    // a chunked body is being sent
+    uint32_t chunks; // pieces of it so far
+    bool detached;
+    char extra[256]; // headers added with sendHeader() for the next response
+    size_t extraLen;
+};
+
+#endif //HTTPSERVER_H_
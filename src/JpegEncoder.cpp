@@ -0,0 +1,490 @@
+#include "JpegEncoder.h"
+
+const uint8_t jpegNaturalOrder[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10,
+    17, 24, 32, 25, 18, 11, 4, 5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63};
+
+// ITU T.81 Annex K tables, quantisation in natural order
+static const uint8_t stdLumaQuant[64] = {
+    16, 11, 10, 16, 24, 40, 51, 61,
+    12, 12, 14, 19, 26, 58, 60, 55,
+    14, 13, 16, 24, 40, 57, 69, 56,
+    14, 17, 22, 29, 51, 87, 80, 62,
+    18, 22, 37, 56, 68, 109, 103, 77,
+    24, 35, 55, 64, 81, 104, 113, 92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103, 99};
+
+static const uint8_t stdChromaQuant[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99};
+
+static const uint8_t dcLumaBits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t dcChromaBits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+static const uint8_t dcVals[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const uint8_t acLumaBits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+static const uint8_t acLumaVals[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa};
+
+static const uint8_t acChromaBits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+static const uint8_t acChromaVals[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa};
+
+// code and length for every symbol, built once from the tables above
+struct HuffCodes
+{
+    uint16_t code[256];
+    uint8_t size[256];
+};
+
+static HuffCodes dcLuma, dcChroma, acLuma, acChroma;
+static bool codesBuilt = false;
+
+static void buildCodes(HuffCodes &h, const uint8_t *bits, const uint8_t *vals)
+{
+    uint16_t code = 0;
+    int k = 0;
+    for (int len = 1; len <= 16; len++)
+    {
+        for (int i = 0; i < bits[len - 1]; i++)
+        {
+            h.code[vals[k]] = code++;
+            h.size[vals[k]] = len;
+            k++;
+        }
+        code <<= 1;
+    }
+}
+
+// ==== bit output with 0xFF byte stuffing ====
+struct BitWriter
+{
+    uint8_t *out;
+    size_t pos;
+    size_t capacity;
+    uint32_t acc;
+    int bits;
+
+    void byte(uint8_t b)
+    {
+        if (pos < capacity)
+            out[pos] = b;
+        pos++;
+    }
+
+    void put(uint32_t code, int size)
+    {
+        acc = (acc << size) | (code & ((1u << size) - 1));
+        bits += size;
+        while (bits >= 8)
+        {
+            uint8_t b = acc >> (bits - 8);
+            byte(b);
+            if (b == 0xFF)
+                byte(0);
+            bits -= 8;
+        }
+    }
+
+    void flush(void)
+    {
+        if (bits > 0)
+            put(0x7F, 8 - bits); // pad with ones
+    }
+
+    void marker(uint8_t m)
+    {
+        byte(0xFF);
+        byte(m);
+    }
+
+    void word(uint16_t w)
+    {
+        byte(w >> 8);
+        byte(w & 0xFF);
+    }
+};
+
+// ==== forward DCT, the slow but accurate integer version from the IJG ====
+// Output is scaled up by 8 compared to a true DCT, which quantisation undoes.
+#define CONST_BITS 13
+#define PASS1_BITS 2
+#define DESCALE(x, n) (((x) + (1 << ((n)-1))) >> (n))
+
+#define FIX_0_298631336 2446
+#define FIX_0_390180644 3196
+#define FIX_0_541196100 4433
+#define FIX_0_765366865 6270
+#define FIX_0_899976223 7373
+#define FIX_1_175875602 9633
+#define FIX_1_501321110 12299
+#define FIX_1_847759065 15137
+#define FIX_1_961570560 16069
+#define FIX_2_053119869 16819
+#define FIX_2_562915447 20995
+#define FIX_3_072711026 25172
+
+static void fdct(int32_t *d)
+{
+    int32_t tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+    int32_t tmp10, tmp11, tmp12, tmp13;
+    int32_t z1, z2, z3, z4, z5;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        // rows first, then columns
+        int step = pass ? 8 : 1;
+        int next = pass ? 1 : 8;
+        int shift = pass ? CONST_BITS + PASS1_BITS : CONST_BITS - PASS1_BITS;
+
+        for (int i = 0; i < 8; i++)
+        {
+            int32_t *p = d + i * next;
+
+            tmp0 = p[0] + p[7 * step];
+            tmp7 = p[0] - p[7 * step];
+            tmp1 = p[step] + p[6 * step];
+            tmp6 = p[step] - p[6 * step];
+            tmp2 = p[2 * step] + p[5 * step];
+            tmp5 = p[2 * step] - p[5 * step];
+            tmp3 = p[3 * step] + p[4 * step];
+            tmp4 = p[3 * step] - p[4 * step];
+
+            tmp10 = tmp0 + tmp3;
+            tmp13 = tmp0 - tmp3;
+            tmp11 = tmp1 + tmp2;
+            tmp12 = tmp1 - tmp2;
+
+            if (pass)
+            {
+                p[0] = DESCALE(tmp10 + tmp11, PASS1_BITS);
+                p[4 * step] = DESCALE(tmp10 - tmp11, PASS1_BITS);
+            }
+            else
+            {
+                p[0] = (tmp10 + tmp11) << PASS1_BITS;
+                p[4 * step] = (tmp10 - tmp11) << PASS1_BITS;
+            }
+
+            z1 = (tmp12 + tmp13) * FIX_0_541196100;
+            p[2 * step] = DESCALE(z1 + tmp13 * FIX_0_765366865, shift);
+            p[6 * step] = DESCALE(z1 - tmp12 * FIX_1_847759065, shift);
+
+            z1 = tmp4 + tmp7;
+            z2 = tmp5 + tmp6;
+            z3 = tmp4 + tmp6;
+            z4 = tmp5 + tmp7;
+            z5 = (z3 + z4) * FIX_1_175875602;
+
+            tmp4 *= FIX_0_298631336;
+            tmp5 *= FIX_2_053119869;
+            tmp6 *= FIX_3_072711026;
+            tmp7 *= FIX_1_501321110;
+            z1 *= -FIX_0_899976223;
+            z2 *= -FIX_2_562915447;
+            z3 *= -FIX_1_961570560;
+            z4 *= -FIX_0_390180644;
+
+            z3 += z5;
+            z4 += z5;
+
+            p[7 * step] = DESCALE(tmp4 + z1 + z3, shift);
+            p[5 * step] = DESCALE(tmp5 + z2 + z4, shift);
+            p[3 * step] = DESCALE(tmp6 + z2 + z3, shift);
+            p[step] = DESCALE(tmp7 + z1 + z4, shift);
+        }
+    }
+}
+
+JpegEncoder::JpegEncoder()
+{
+    if (!codesBuilt)
+    {
+        buildCodes(dcLuma, dcLumaBits, dcVals);
+        buildCodes(dcChroma, dcChromaBits, dcVals);
+        buildCodes(acLuma, acLumaBits, acLumaVals);
+        buildCodes(acChroma, acChromaBits, acChromaVals);
+        codesBuilt = true;
+    }
+    setQuality(80);
+}
+
+// scale the standard tables the way libjpeg does, quality 1..100
+void JpegEncoder::setQuality(int quality)
+{
+    if (quality < 1)
+        quality = 1;
+    if (quality > 100)
+        quality = 100;
+    int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+
+    uint16_t q[2][64];
+    for (int i = 0; i < 64; i++)
+    {
+        q[0][i] = (stdLumaQuant[i] * scale + 50) / 100;
+        q[1][i] = (stdChromaQuant[i] * scale + 50) / 100;
+    }
+    setQuantTable(0, q[0]);
+    setQuantTable(1, q[1]);
+}
+
+// The quality setting, 0..63 with higher better, on the encoder's scale. Its
+// top goes no further than JPEG_QUALITY_CEILING: 100 makes SVGA frames twice
+// the size of 85 and more than the encoded frame buffers hold
+int JpegEncoder::qualityFor(int setting)
+{
+    if (setting < 0)
+        setting = 0;
+    if (setting > 63)
+        setting = 63;
+    return 1 + setting * (JPEG_QUALITY_CEILING - 1) / 63;
+}
+
+// take a quantisation table in natural order, 0 for luma and 1 for chroma
+void JpegEncoder::setQuantTable(int table, const uint16_t *q)
+{
+    for (int i = 0; i < 64; i++)
+    {
+        uint32_t v = q[i];
+        if (v < 1)
+            v = 1;
+        if (v > 255)
+            v = 255;
+        quant[table][i] = v;
+        recip[table][i] = (1u << 20) / (v * 8);
+    }
+}
+
+static void writeHuffTable(BitWriter &w, uint8_t cls, const uint8_t *bits, const uint8_t *vals, int count)
+{
+    w.byte(cls);
+    for (int i = 0; i < 16; i++)
+        w.byte(bits[i]);
+    for (int i = 0; i < count; i++)
+        w.byte(vals[i]);
+}
+
+static inline int bitLength(uint32_t v)
+{
+    return v ? 32 - __builtin_clz(v) : 0;
+}
+
+static void encodeBlock(BitWriter &w, int32_t *blk, const uint32_t *recip, int &lastDc, const HuffCodes &dc, const HuffCodes &ac)
+{
+    int32_t zz[64];
+    for (int i = 0; i < 64; i++)
+    {
+        int n = jpegNaturalOrder[i];
+        int32_t x = blk[n];
+        uint32_t a = ((uint32_t)(x < 0 ? -x : x) * recip[n] + (1u << 19)) >> 20;
+        zz[i] = x < 0 ? -(int32_t)a : a;
+    }
+
+    int diff = zz[0] - lastDc;
+    lastDc = zz[0];
+    int size = bitLength(diff < 0 ? -diff : diff);
+    w.put(dc.code[size], dc.size[size]);
+    if (size)
+        w.put(diff < 0 ? diff - 1 : diff, size);
+
+    int run = 0;
+    for (int i = 1; i < 64; i++)
+    {
+        int32_t v = zz[i];
+        if (v == 0)
+        {
+            run++;
+            continue;
+        }
+        while (run > 15)
+        {
+            w.put(ac.code[0xF0], ac.size[0xF0]);
+            run -= 16;
+        }
+        size = bitLength(v < 0 ? -v : v);
+        int sym = (run << 4) | size;
+        w.put(ac.code[sym], ac.size[sym]);
+        w.put(v < 0 ? v - 1 : v, size);
+        run = 0;
+    }
+    if (run)
+        w.put(ac.code[0x00], ac.size[0x00]); // end of block
+}
+
+// read one 8x8 block out of a plane, repeating the edge past its borders
+static void fetchBlock(const JpegPlane &p, int bx, int by, int32_t *blk)
+{
+    int step = p.step;
+    if (bx * 8 + 8 <= p.width && by * 8 + 8 <= p.height)
+    {
+        // all of it inside, as nearly every block is
+        const uint8_t *row = p.data + by * 8 * p.stride + bx * 8 * step;
+        for (int y = 0; y < 8; y++, row += p.stride, blk += 8)
+            for (int x = 0; x < 8; x++)
+                blk[x] = (int32_t)row[x * step] - 128;
+        return;
+    }
+
+    for (int y = 0; y < 8; y++)
+    {
+        int sy = by * 8 + y;
+        if (sy >= p.height)
+            sy = p.height - 1;
+        const uint8_t *row = p.data + sy * p.stride;
+        for (int x = 0; x < 8; x++)
+        {
+            int sx = bx * 8 + x;
+            if (sx >= p.width)
+                sx = p.width - 1;
+            blk[y * 8 + x] = (int32_t)row[sx * step] - 128;
+        }
+    }
+}
+
+// encode up to 3 planes, the first one being luma. Returns the size of the
+// JPEG written to out, 0 if it didn't fit into capacity
+size_t JpegEncoder::encode(const JpegPlane *planes, int count, int width, int height, uint8_t *out, size_t capacity)
+{
+    BitWriter w = {out, 0, capacity, 0, 0};
+
+    int hmax = 1, vmax = 1;
+    for (int c = 0; c < count; c++)
+    {
+        if (planes[c].h > hmax)
+            hmax = planes[c].h;
+        if (planes[c].v > vmax)
+            vmax = planes[c].v;
+    }
+
+    w.marker(0xD8); // SOI
+
+    for (int t = 0; t < (count > 1 ? 2 : 1); t++)
+    {
+        w.marker(0xDB); // DQT
+        w.word(67);
+        w.byte(t);
+        for (int i = 0; i < 64; i++)
+            w.byte(quant[t][jpegNaturalOrder[i]]);
+    }
+
+    w.marker(0xC0); // SOF0
+    w.word(8 + 3 * count);
+    w.byte(8);
+    w.word(height);
+    w.word(width);
+    w.byte(count);
+    for (int c = 0; c < count; c++)
+    {
+        w.byte(c + 1);
+        w.byte((planes[c].h << 4) | planes[c].v);
+        w.byte(c ? 1 : 0);
+    }
+
+    w.marker(0xC4); // DHT
+    w.word(2 + (count > 1 ? 2 : 1) * (2 * 17 + 12 + 162));
+    writeHuffTable(w, 0x00, dcLumaBits, dcVals, 12);
+    writeHuffTable(w, 0x10, acLumaBits, acLumaVals, 162);
+    if (count > 1)
+    {
+        writeHuffTable(w, 0x01, dcChromaBits, dcVals, 12);
+        writeHuffTable(w, 0x11, acChromaBits, acChromaVals, 162);
+    }
+
+    w.marker(0xDA); // SOS
+    w.word(6 + 2 * count);
+    w.byte(count);
+    for (int c = 0; c < count; c++)
+    {
+        w.byte(c + 1);
+        w.byte(c ? 0x11 : 0x00);
+    }
+    w.byte(0);
+    w.byte(63);
+    w.byte(0);
+
+    int32_t blk[64];
+    int lastDc[3] = {0, 0, 0};
+    int mcusX = (width + 8 * hmax - 1) / (8 * hmax);
+    int mcusY = (height + 8 * vmax - 1) / (8 * vmax);
+
+    for (int my = 0; my < mcusY; my++)
+    {
+        for (int mx = 0; mx < mcusX; mx++)
+        {
+            for (int c = 0; c < count; c++)
+            {
+                const JpegPlane &p = planes[c];
+                for (int v = 0; v < p.v; v++)
+                {
+                    for (int h = 0; h < p.h; h++)
+                    {
+                        fetchBlock(p, mx * p.h + h, my * p.v + v, blk);
+                        fdct(blk);
+                        if (c)
+                            encodeBlock(w, blk, recip[1], lastDc[c], dcChroma, acChroma);
+                        else
+                            encodeBlock(w, blk, recip[0], lastDc[c], dcLuma, acLuma);
+                    }
+                }
+            }
+            if (w.pos > capacity)
+                return 0;
+        }
+    }
+
+    w.flush();
+    w.marker(0xD9); // EOI
+
+    return w.pos > capacity ? 0 : w.pos;
+}
+
+// encode a frame the camera delivered as YUV422: Y0 U Y1 V for every two
+// pixels. The chroma is already halved horizontally, which is JPEG's 4:2:2
+size_t JpegEncoder::encodeYuv422(const uint8_t *yuyv, int width, int height, uint8_t *out, size_t capacity)
+{
+    JpegPlane planes[3] = {
+        {yuyv, width, height, width * 2, 2, 1, 2},
+        {yuyv + 1, width / 2, height, width * 2, 1, 1, 4},
+        {yuyv + 3, width / 2, height, width * 2, 1, 1, 4},
+    };
+    return encode(planes, 3, width, height, out, capacity);
+}
+
+size_t JpegEncoder::encodeGray(const uint8_t *gray, int width, int height, uint8_t *out, size_t capacity)
+{
+    JpegPlane plane = {gray, width, height, width, 1, 1, 1};
+    return encode(&plane, 1, width, height, out, capacity);
+}
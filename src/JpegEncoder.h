@@ -0,0 +1,49 @@
+#ifndef JPEGENCODER_H_
+#define JPEGENCODER_H_
+
+#include <Arduino.h>
+
+#define JPEG_QUALITY_CEILING 85 // past this frames grow fast for hardly any visible gain
+
+// One colour component of the image to encode, 8 bits per sample. h and v are
+// its JPEG sampling factors: a plane with h = 2 has twice the horizontal
+// resolution of one with h = 1. step is the distance between two samples of a
+// row, so components interleaved in one buffer, like the camera's YUYV, can be
+// encoded where they are.
+struct JpegPlane
+{
+    const uint8_t *data;
+    int width;
+    int height;
+    int stride;
+    int h;
+    int v;
+    int step;
+};
+
+// Baseline JPEG encoder: integer DCT, standard Huffman tables, output into a
+// caller supplied buffer. Quantisation tables either come from a quality
+// setting or are taken over from another JPEG so a re-encode keeps its quality.
+class JpegEncoder
+{
+public:
+    JpegEncoder();
+
+    void setQuality(int quality);
+    void setQuantTable(int table, const uint16_t *q);
+
+    static int qualityFor(int setting);
+
+    size_t encode(const JpegPlane *planes, int count, int width, int height, uint8_t *out, size_t capacity);
+    size_t encodeYuv422(const uint8_t *yuyv, int width, int height, uint8_t *out, size_t capacity);
+    size_t encodeGray(const uint8_t *gray, int width, int height, uint8_t *out, size_t capacity);
+
+private:
+    uint8_t quant[2][64];  // natural order, 0 for luma and 1 for chroma
+    uint32_t recip[2][64]; // 2^20 / (8 * quant), quantising by multiplication
+};
+
+// natural (row major) position of the i-th coefficient in zigzag order
+extern const uint8_t jpegNaturalOrder[64];
+
+#endif //JPEGENCODER_H_
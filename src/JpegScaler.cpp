@@ -0,0 +1,473 @@
+#include "JpegScaler.h"
+#include <math.h>
+
+#define FAST_BITS 9
+
+// reduced inverse DCTs for 2x2 and 4x4 corners, [x][u] = C(u) / 2 * cos((2x + 1) u pi / 2k) in 4.12
+static int32_t idct2[2][2];
+static int32_t idct4[4][4];
+static bool idctBuilt = false;
+
+static void buildIdct(int32_t *t, int k)
+{
+    for (int x = 0; x < k; x++)
+        for (int u = 0; u < k; u++)
+        {
+            double c = u ? 1.0 : 1.0 / sqrt(2.0);
+            t[x * k + u] = lround(4096.0 * c / 2.0 * cos((2 * x + 1) * u * M_PI / (2 * k)));
+        }
+}
+
+static inline uint8_t clamp(int32_t v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+// ==== entropy coded data, MSB first, with stuffing and markers handled ====
+struct BitReader
+{
+    const uint8_t *p;
+    const uint8_t *end;
+    uint32_t acc;
+    int bits;
+    bool marker; // hit a marker, only zeros from here on
+
+    void fill(void)
+    {
+        while (bits <= 24)
+        {
+            uint32_t b = 0;
+            if (!marker && p < end)
+            {
+                b = *p++;
+                if (b == 0xFF)
+                {
+                    if (p < end && *p == 0)
+                        p++;
+                    else
+                    {
+                        // leave the marker for whoever handles it
+                        marker = true;
+                        p--;
+                        b = 0;
+                    }
+                }
+            }
+            acc |= b << (24 - bits);
+            bits += 8;
+        }
+    }
+
+    int get(int n)
+    {
+        if (!n)
+            return 0;
+        fill();
+        int v = acc >> (32 - n);
+        acc <<= n;
+        bits -= n;
+        return v;
+    }
+
+    // skip past the next RSTn marker and start afresh
+    void restart(void)
+    {
+        while (p + 1 < end && !(p[0] == 0xFF && p[1] >= 0xD0 && p[1] <= 0xD7))
+            p++;
+        p += 2;
+        acc = 0;
+        bits = 0;
+        marker = false;
+    }
+};
+
+static inline int extend(int v, int n)
+{
+    return v < (1 << (n - 1)) ? v - (1 << n) + 1 : v;
+}
+
+JpegScaler::JpegScaler()
+{
+    if (!idctBuilt)
+    {
+        buildIdct(&idct2[0][0], 2);
+        buildIdct(&idct4[0][0], 4);
+        idctBuilt = true;
+    }
+    for (int c = 0; c < JPEG_MAX_COMPONENTS; c++)
+    {
+        comp[c].plane = NULL;
+        comp[c].planeSize = 0;
+    }
+    ncomp = 0;
+    width = height = 0;
+    outWidth = outHeight = 0;
+}
+
+JpegScaler::~JpegScaler()
+{
+    for (int c = 0; c < JPEG_MAX_COMPONENTS; c++)
+        free(comp[c].plane);
+}
+
+void JpegScaler::buildHuffman(Huffman &h, const uint8_t *bits, const uint8_t *vals)
+{
+    memset(h.fast, 0, sizeof(h.fast));
+    memcpy(h.vals, vals, 256);
+
+    uint32_t code = 0;
+    int k = 0;
+    for (int len = 1; len <= 16; len++)
+    {
+        h.valptr[len] = k;
+        h.mincode[len] = code;
+        for (int i = 0; i < bits[len - 1]; i++, k++, code++)
+        {
+            if (len <= FAST_BITS)
+            {
+                int shift = FAST_BITS - len;
+                for (int j = 0; j < (1 << shift); j++)
+                    h.fast[(code << shift) | j] = (len << 8) | vals[k];
+            }
+        }
+        h.maxcode[len] = bits[len - 1] ? (int32_t)code - 1 : -1;
+        code <<= 1;
+    }
+    h.maxcode[17] = 0x7FFFFFFF;
+}
+
+static int decodeSymbol(BitReader &br, const uint16_t *fast, const int32_t *maxcode, const int32_t *valptr, const uint16_t *mincode, const uint8_t *vals)
+{
+    br.fill();
+    uint16_t e = fast[br.acc >> (32 - FAST_BITS)];
+    if (e)
+    {
+        int len = e >> 8;
+        br.acc <<= len;
+        br.bits -= len;
+        return e & 0xFF;
+    }
+    for (int len = FAST_BITS + 1; len <= 16; len++)
+    {
+        int32_t code = br.acc >> (32 - len);
+        if (code <= maxcode[len])
+        {
+            br.acc <<= len;
+            br.bits -= len;
+            return vals[valptr[len] + code - mincode[len]];
+        }
+    }
+    return -1; // corrupt data
+}
+
+// walk the markers up to the start of the scan
+bool JpegScaler::parse(const uint8_t *jpg, size_t len)
+{
+    const uint8_t *p = jpg;
+    end = jpg + len;
+    restart = 0;
+    ncomp = 0;
+    width = height = 0;
+
+    if (len < 4 || p[0] != 0xFF || p[1] != 0xD8)
+        return false;
+    p += 2;
+
+    while (p + 4 <= end)
+    {
+        if (p[0] != 0xFF || p[1] == 0xFF)
+        {
+            p++; // fill bytes
+            continue;
+        }
+        uint8_t m = p[1];
+        p += 2;
+        if (m == 0xD9)
+            return false;
+
+        const uint8_t *s = p + 2;
+        const uint8_t *se = p + ((p[0] << 8) | p[1]);
+        if (se > end || se < s)
+            return false;
+
+        switch (m)
+        {
+        case 0xDB: // DQT
+            while (s < se)
+            {
+                int pq = s[0] >> 4;
+                uint16_t *q = quant[s[0] & 3];
+                s++;
+                if (s + (pq ? 128 : 64) > se)
+                    return false;
+                for (int i = 0; i < 64; i++)
+                    q[jpegNaturalOrder[i]] = pq ? (s[2 * i] << 8) | s[2 * i + 1] : s[i];
+                s += pq ? 128 : 64;
+            }
+            break;
+
+        case 0xC0: // baseline
+        case 0xC1: // extended sequential, Huffman
+            if (s[0] != 8)
+                return false;
+            height = (s[1] << 8) | s[2];
+            width = (s[3] << 8) | s[4];
+            ncomp = s[5];
+            if (ncomp < 1 || ncomp > JPEG_MAX_COMPONENTS || s + 6 + 3 * ncomp > se)
+                return false;
+            for (int c = 0; c < ncomp; c++)
+            {
+                comp[c].id = s[6 + 3 * c];
+                comp[c].h = s[7 + 3 * c] >> 4;
+                comp[c].v = s[7 + 3 * c] & 15;
+                comp[c].tq = s[8 + 3 * c] & 3;
+                if (comp[c].h < 1 || comp[c].h > 2 || comp[c].v < 1 || comp[c].v > 2)
+                    return false;
+            }
+            break;
+
+        case 0xC2: // progressive, lossless, arithmetic coding...
+        case 0xC3:
+        case 0xC5:
+        case 0xC6:
+        case 0xC7:
+        case 0xC9:
+        case 0xCA:
+        case 0xCB:
+        case 0xCD:
+        case 0xCE:
+        case 0xCF:
+            return false;
+
+        case 0xC4: // DHT
+            while (s + 17 <= se)
+            {
+                int tc = s[0] >> 4;
+                int th = s[0] & 3;
+                int total = 0;
+                for (int i = 0; i < 16; i++)
+                    total += s[1 + i];
+                if (total > 256 || s + 17 + total > se)
+                    return false;
+                uint8_t vals[256] = {0};
+                memcpy(vals, s + 17, total);
+                buildHuffman(tc ? ac[th] : dc[th], s + 1, vals);
+                s += 17 + total;
+            }
+            break;
+
+        case 0xDD: // DRI
+            restart = (s[0] << 8) | s[1];
+            break;
+
+        case 0xDA: // SOS
+            // only single scans holding every component, which is what sensors produce
+            if (!ncomp || s[0] != ncomp || s + 1 + 2 * ncomp > se)
+                return false;
+            for (int i = 0; i < ncomp; i++)
+            {
+                int c = 0;
+                while (c < ncomp && comp[c].id != s[1 + 2 * i])
+                    c++;
+                if (c == ncomp)
+                    return false;
+                comp[c].td = s[2 + 2 * i] >> 4 & 3;
+                comp[c].ta = s[2 + 2 * i] & 3;
+            }
+            scan = se;
+            return width && height;
+        }
+        p = se;
+    }
+    return false;
+}
+
+// entropy decode the scan, keeping only the k x k low frequency corner of each
+// block, and inverse transform that corner into the planes
+bool JpegScaler::decode(int k)
+{
+    if (ncomp == 1)
+        comp[0].h = comp[0].v = 1; // a single component is never interleaved
+
+    int hmax = 1, vmax = 1;
+    for (int c = 0; c < ncomp; c++)
+    {
+        if (comp[c].h > hmax)
+            hmax = comp[c].h;
+        if (comp[c].v > vmax)
+            vmax = comp[c].v;
+    }
+    int mcusX = (width + 8 * hmax - 1) / (8 * hmax);
+    int mcusY = (height + 8 * vmax - 1) / (8 * vmax);
+
+    for (int c = 0; c < ncomp; c++)
+    {
+        Component &cp = comp[c];
+        cp.stride = mcusX * cp.h * k;
+        size_t need = cp.stride * mcusY * cp.v * k;
+        if (need > cp.planeSize)
+        {
+            free(cp.plane);
+            cp.plane = (uint8_t *)(psramFound() ? ps_malloc(need) : malloc(need));
+            cp.planeSize = cp.plane ? need : 0;
+            if (!cp.plane)
+                return false;
+        }
+        cp.pred = 0;
+    }
+
+    BitReader br = {scan, end, 0, 0, false};
+    int32_t coef[64];
+    int32_t rows[16];
+    int left = restart;
+
+    for (int my = 0; my < mcusY; my++)
+    {
+        for (int mx = 0; mx < mcusX; mx++)
+        {
+            if (restart)
+            {
+                if (left == 0)
+                {
+                    br.restart();
+                    for (int c = 0; c < ncomp; c++)
+                        comp[c].pred = 0;
+                    left = restart;
+                }
+                left--;
+            }
+
+            for (int c = 0; c < ncomp; c++)
+            {
+                Component &cp = comp[c];
+                const Huffman &hd = dc[cp.td];
+                const Huffman &ha = ac[cp.ta];
+                const uint16_t *q = quant[cp.tq];
+
+                for (int v = 0; v < cp.v; v++)
+                {
+                    for (int h = 0; h < cp.h; h++)
+                    {
+                        int s = decodeSymbol(br, hd.fast, hd.maxcode, hd.valptr, hd.mincode, hd.vals);
+                        if (s < 0 || s > 11)
+                            return false;
+                        cp.pred += s ? extend(br.get(s), s) : 0;
+                        coef[0] = cp.pred * q[0];
+                        for (int i = 1; i < k * 8; i++)
+                            coef[i] = 0;
+
+                        for (int i = 1; i < 64;)
+                        {
+                            int rs = decodeSymbol(br, ha.fast, ha.maxcode, ha.valptr, ha.mincode, ha.vals);
+                            if (rs < 0)
+                                return false;
+                            int r = rs >> 4;
+                            s = rs & 15;
+                            if (!s)
+                            {
+                                if (r != 15)
+                                    break; // end of block
+                                i += 16;
+                                continue;
+                            }
+                            i += r;
+                            if (i > 63)
+                                return false;
+                            // all coefficients have to be read, only the corner is kept
+                            int val = extend(br.get(s), s);
+                            int n = jpegNaturalOrder[i];
+                            if ((n & 7) < k && (n >> 3) < k)
+                                coef[n] = val * q[n];
+                            i++;
+                        }
+
+                        uint8_t *out = cp.plane + (my * cp.v + v) * k * cp.stride + (mx * cp.h + h) * k;
+                        if (k == 1)
+                        {
+                            out[0] = clamp(((coef[0] + 4) >> 3) + 128);
+                            continue;
+                        }
+
+                        const int32_t *t = k == 2 ? &idct2[0][0] : &idct4[0][0];
+                        for (int fv = 0; fv < k; fv++)
+                            for (int x = 0; x < k; x++)
+                            {
+                                int32_t sum = 0;
+                                for (int fu = 0; fu < k; fu++)
+                                {
+                                    int32_t f = coef[fv * 8 + fu];
+                                    f = f > 32767 ? 32767 : f < -32768 ? -32768 : f;
+                                    sum += t[x * k + fu] * f;
+                                }
+                                rows[fv * k + x] = (sum + 2048) >> 12;
+                            }
+                        for (int y = 0; y < k; y++)
+                            for (int x = 0; x < k; x++)
+                            {
+                                int32_t sum = 0;
+                                for (int fv = 0; fv < k; fv++)
+                                    sum += t[y * k + fv] * rows[fv * k + x];
+                                out[y * cp.stride + x] = clamp(((sum + 2048) >> 12) + 128);
+                            }
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// shrink jpg by factor 2, 4 or 8 into out. Returns the size of the new JPEG,
+// 0 if the source can't be handled or the result doesn't fit into capacity
+size_t JpegScaler::scale(const uint8_t *jpg, size_t len, int factor, uint8_t *out, size_t capacity)
+{
+    if (factor != 2 && factor != 4 && factor != 8)
+        return 0;
+    int k = 8 / factor;
+
+    if (!parse(jpg, len) || !decode(k))
+        return 0;
+
+    outWidth = (width * k + 7) / 8;
+    outHeight = (height * k + 7) / 8;
+
+    int hmax = 1, vmax = 1;
+    for (int c = 0; c < ncomp; c++)
+    {
+        if (comp[c].h > hmax)
+            hmax = comp[c].h;
+        if (comp[c].v > vmax)
+            vmax = comp[c].v;
+    }
+
+    JpegPlane planes[JPEG_MAX_COMPONENTS];
+    for (int c = 0; c < ncomp; c++)
+    {
+        planes[c].data = comp[c].plane;
+        planes[c].width = (outWidth * comp[c].h + hmax - 1) / hmax;
+        planes[c].height = (outHeight * comp[c].v + vmax - 1) / vmax;
+        planes[c].stride = comp[c].stride;
+        planes[c].h = comp[c].h;
+        planes[c].v = comp[c].v;
+        planes[c].step = 1;
+    }
+
+    encoder.setQuantTable(0, quant[comp[0].tq]);
+    if (ncomp > 1)
+        encoder.setQuantTable(1, quant[comp[1].tq]);
+
+    return encoder.encode(planes, ncomp, outWidth, outHeight, out, capacity);
+}
+
+// Decode only the DC coefficients and stop there: the luma plane at 1/8 size,
+// getStride() bytes per row, for looking at a frame rather than sending it.
+// NULL if the frame could not be decoded
+const uint8_t *JpegScaler::preview(const uint8_t *jpg, size_t len)
+{
+    if (!parse(jpg, len) || !decode(1))
+        return NULL;
+
+    outWidth = (width + 7) / 8;
+    outHeight = (height + 7) / 8;
+    return comp[0].plane;
+}
@@ -0,0 +1,75 @@
+#ifndef JPEGSCALER_H_
+#define JPEGSCALER_H_
+
+#include <Arduino.h>
+#include "JpegEncoder.h"
+
+#define JPEG_MAX_COMPONENTS 3
+
+// Shrinks a baseline JPEG by 2, 4 or 8 without ever decoding it to full size.
+// Only the low frequency k x k corner (k = 8 / scale) of every block is
+// dequantised and inverse transformed, straight into a k x k patch of the
+// smaller image - at 1/8 that is just the DC coefficient. The result is then
+// encoded again with the source's own quantisation tables.
+//
+// Plane buffers are kept between frames and only grow, so a scaler running on
+// the same stream allocates once.
+class JpegScaler
+{
+public:
+    JpegScaler();
+    ~JpegScaler();
+
+    size_t scale(const uint8_t *jpg, size_t len, int factor, uint8_t *out, size_t capacity);
+    const uint8_t *preview(const uint8_t *jpg, size_t len);
+
+    int getWidth(void) { return outWidth; }
+    int getHeight(void) { return outHeight; }
+    int getFrameWidth(void) { return width; }
+    int getFrameHeight(void) { return height; }
+    int getStride(void) { return comp[0].stride; }
+    // luma as the last scale() or preview() decoded it, before any re-encoding
+    const uint8_t *getPlane(void) { return comp[0].plane; }
+
+private:
+    struct Huffman
+    {
+        uint16_t fast[512]; // 9 bit lookahead: length << 8 | symbol, 0 if longer
+        int32_t maxcode[18];
+        int32_t valptr[17];
+        uint16_t mincode[17];
+        uint8_t vals[256];
+    };
+
+    struct Component
+    {
+        uint8_t id;
+        uint8_t h, v;
+        uint8_t tq, td, ta;
+        int pred;
+
+        uint8_t *plane;
+        size_t planeSize;
+        int stride;
+    };
+
+    bool parse(const uint8_t *jpg, size_t len);
+    bool decode(int k);
+    void buildHuffman(Huffman &h, const uint8_t *bits, const uint8_t *vals);
+
+    uint16_t quant[4][64]; // natural order
+    Huffman dc[4];
+    Huffman ac[4];
+    Component comp[JPEG_MAX_COMPONENTS];
+    int ncomp;
+    int width, height;
+    int restart;
+
+    const uint8_t *scan;
+    const uint8_t *end;
+
+    int outWidth, outHeight;
+    JpegEncoder encoder;
+};
+
+#endif //JPEGSCALER_H_
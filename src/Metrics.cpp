@@ -0,0 +1,109 @@
+#include "Metrics.h"
+#include <stdarg.h>
+
+static const uint32_t bounds[METRICS_BUCKETS] = {5, 10, 20, 40, 80, 160, 320, 640};
+
+void Histogram::observe(uint32_t ms)
+{
+    int i = 0;
+    while (i < METRICS_BUCKETS && ms > bounds[i])
+        i++;
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(ms, std::memory_order_relaxed);
+}
+
+MetricsWriter::MetricsWriter(char *buf, size_t capacity, Sink sink, void *ctx)
+{
+    this->buf = buf;
+    this->capacity = capacity;
+    this->sink = sink;
+    this->ctx = ctx;
+    len = 0;
+    full = capacity == 0;
+    if (capacity)
+        buf[0] = 0;
+}
+
+// hand what is in the buffer to the sink and start over, false if there is
+// no sink or it failed
+bool MetricsWriter::flush(void)
+{
+    if (full || sink == NULL)
+        return false;
+    if (len && !sink(ctx, buf, len))
+    {
+        full = true;
+        return false;
+    }
+    len = 0;
+    buf[0] = 0;
+    return true;
+}
+
+void MetricsWriter::print(const char *fmt, ...)
+{
+    if (full)
+        return;
+
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf + len, capacity - len, fmt, args);
+        va_end(args);
+
+        if (n >= 0 && len + n < capacity)
+        {
+            len += n;
+            return;
+        }
+        // drop the partial line, and try again in an empty buffer unless it
+        // already was one
+        buf[len] = 0;
+        if (n < 0 || len == 0 || !flush())
+            break;
+    }
+    full = true;
+}
+
+void MetricsWriter::header(const char *name, const char *type, const char *help)
+{
+    print("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void MetricsWriter::sample(const char *name, const char *labels, uint32_t value)
+{
+    if (labels)
+        print("%s{%s} %u\n", name, labels, (unsigned)value);
+    else
+        print("%s %u\n", name, (unsigned)value);
+}
+
+void MetricsWriter::counter(const char *name, const char *help, Counter &c)
+{
+    header(name, "counter", help);
+    sample(name, NULL, c.get());
+}
+
+void MetricsWriter::gauge(const char *name, const char *help, uint32_t value)
+{
+    header(name, "gauge", help);
+    sample(name, NULL, value);
+}
+
+void MetricsWriter::histogram(const char *name, const char *help, Histogram &h)
+{
+    header(name, "histogram", help);
+
+    uint32_t total = 0;
+    for (int i = 0; i <= METRICS_BUCKETS; i++)
+    {
+        total += h.buckets[i].load(std::memory_order_relaxed);
+        if (i < METRICS_BUCKETS)
+            print("%s_bucket{le=\"%u\"} %u\n", name, (unsigned)bounds[i], (unsigned)total);
+        else
+            print("%s_bucket{le=\"+Inf\"} %u\n", name, (unsigned)total);
+    }
+    // count taken from the buckets so a scrape racing an observe stays consistent
+    print("%s_sum %u\n%s_count %u\n", name, (unsigned)h.sum.load(std::memory_order_relaxed), name, (unsigned)total);
+}
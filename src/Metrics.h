@@ -0,0 +1,104 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <Arduino.h>
+#include <atomic>
+
+#define METRICS_BUCKETS 8 // finite histogram buckets, +Inf comes on top
+
+// Instrumentation for the hot paths. Every update is a single relaxed atomic
+// add or store: no locks, no ordering, nothing a task could block on. The
+// counters are 32 bits wide because that is what the ESP32 does atomically;
+// byte counters wrap after 4 GB, which Prometheus' rate() reads as a reset.
+
+// Monotonic count of events or of an amount (bytes, milliseconds)
+class Counter
+{
+public:
+    void add(uint32_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    uint32_t get(void) { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> value{0};
+};
+
+// Value that goes up and down, set by the one task that knows it
+class Gauge
+{
+public:
+    void set(uint32_t v) { value.store(v, std::memory_order_relaxed); }
+    uint32_t get(void) { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> value{0};
+};
+
+// Time a task spends working, measured in microseconds and counted in
+// milliseconds so it wraps after seven weeks rather than seventy minutes. Only
+// the task itself adds to it
+class BusyTime
+{
+public:
+    void add(uint32_t us)
+    {
+        us += carry;
+        ms.add(us / 1000);
+        carry = us % 1000;
+    }
+    uint32_t get(void) { return ms.get(); }
+
+private:
+    Counter ms;
+    uint32_t carry = 0;
+};
+
+// Millisecond durations in power of two buckets from 5 ms to 640 ms
+class Histogram
+{
+public:
+    void observe(uint32_t ms);
+
+private:
+    friend class MetricsWriter;
+
+    std::atomic<uint32_t> buckets[METRICS_BUCKETS + 1] = {}; // not cumulative, the writer adds them up
+    std::atomic<uint32_t> sum{0};
+};
+
+// Formats metrics in the Prometheus text format into a caller supplied buffer.
+// With a sink the buffer is handed to it whenever the next line would not fit,
+// and once more by flush(), so the output can be any length. Without one, or
+// when the sink fails, output is cut off at the last complete line and
+// isTruncated() says so.
+class MetricsWriter
+{
+public:
+    typedef bool (*Sink)(void *ctx, const void *data, size_t len);
+
+    MetricsWriter(char *buf, size_t capacity, Sink sink = NULL, void *ctx = NULL);
+
+    void header(const char *name, const char *type, const char *help);
+    void sample(const char *name, const char *labels, uint32_t value);
+
+    void counter(const char *name, const char *help, Counter &c);
+    void gauge(const char *name, const char *help, uint32_t value);
+    void histogram(const char *name, const char *help, Histogram &h);
+
+    bool flush(void);
+
+    const char *c_str(void) { return buf; }
+    size_t length(void) { return len; }
+    bool isTruncated(void) { return full; }
+
+private:
+    void print(const char *fmt, ...);
+
+    char *buf;
+    size_t capacity;
+    size_t len;
+    bool full;
+    Sink sink;
+    void *ctx;
+};
+
+#endif //METRICS_H_
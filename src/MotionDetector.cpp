@@ -0,0 +1,160 @@
+#include "MotionDetector.h"
+
+MotionDetector::MotionDetector()
+{
+    threshold = MOTION_DEFAULT_THRESHOLD;
+    primed = false;
+    width = 0;
+    height = 0;
+    rows = 0;
+    memset((void *)mask, 0, sizeof(mask));
+    cells = 0;
+    active = false;
+    lastMotion = 0;
+    total = 0;
+    frames = 0;
+}
+
+// the i-th newest event, 0 being the newest
+MotionEvent MotionDetector::event(int i)
+{
+    return log[(total - 1 - i) % MOTION_EVENTS];
+}
+
+// Look at one JPEG frame. Returns whether there is an event going on
+bool MotionDetector::analyze(const uint8_t *jpg, size_t len, uint32_t now)
+{
+    const uint8_t *luma = scaler.preview(jpg, len);
+    if (luma == NULL)
+        return active;
+    return analyze(luma, scaler.getWidth(), scaler.getHeight(), scaler.getStride(), 1,
+                   scaler.getFrameWidth(), scaler.getFrameHeight(), now);
+}
+
+// Look at a raw frame's luma, step bytes from one sample to the next. Returns
+// whether there is an event going on
+bool MotionDetector::analyze(const uint8_t *luma, int width, int height, int stride, int step, uint32_t now)
+{
+    return analyze(luma, width, height, stride, step, width, height, now);
+}
+
+// the work for both, on a w x h luma plane of a frameWidth x frameHeight frame.
+// For JPEG that is one sample per block, (frameHeight + 7) / 8 rows of them
+bool MotionDetector::analyze(const uint8_t *luma, int w, int h, int stride, int step, int frameWidth, int frameHeight, uint32_t now)
+{
+    frames++;
+    if (w < MOTION_GRID_X || h < MOTION_GRID_Y)
+        return active;
+
+    // a new frame size makes the background useless
+    if (frameWidth != width || frameHeight != height)
+        primed = false;
+    width = frameWidth;
+    height = frameHeight;
+    rows = h;
+
+    // average the plane over the grid
+    uint32_t sum[MOTION_GRID_Y][MOTION_GRID_X];
+    memset(sum, 0, sizeof(sum));
+    for (int y = 0; y < h; y++)
+    {
+        const uint8_t *row = luma + y * stride;
+        uint32_t *cell = sum[y * MOTION_GRID_Y / h];
+        for (int cx = 0, x = 0; cx < MOTION_GRID_X; cx++)
+        {
+            uint32_t acc = 0;
+            for (int end = (cx + 1) * w / MOTION_GRID_X; x < end; x++)
+                acc += row[x * step];
+            cell[cx] += acc;
+        }
+    }
+
+    // cell averages with 4 bits of fraction, and their overall mean
+    int32_t mean[MOTION_GRID_Y][MOTION_GRID_X];
+    int32_t frameMean = 0, backMean = 0;
+    for (int cy = 0; cy < MOTION_GRID_Y; cy++)
+    {
+        int rows = (cy + 1) * h / MOTION_GRID_Y - cy * h / MOTION_GRID_Y;
+        for (int cx = 0; cx < MOTION_GRID_X; cx++)
+        {
+            int cols = (cx + 1) * w / MOTION_GRID_X - cx * w / MOTION_GRID_X;
+            mean[cy][cx] = (sum[cy][cx] << 4) / (rows * cols);
+            frameMean += mean[cy][cx];
+            backMean += background[cy][cx];
+        }
+    }
+    frameMean /= MOTION_GRID_X * MOTION_GRID_Y;
+    backMean /= MOTION_GRID_X * MOTION_GRID_Y;
+
+    if (!primed)
+    {
+        for (int cy = 0; cy < MOTION_GRID_Y; cy++)
+            for (int cx = 0; cx < MOTION_GRID_X; cx++)
+                background[cy][cx] = mean[cy][cx];
+        primed = true;
+        return active;
+    }
+
+    // compare every cell to its background, less what the whole picture did
+    int32_t limit = threshold << 4;
+    int changed = 0;
+    int x0 = MOTION_GRID_X, y0 = MOTION_GRID_Y, x1 = -1, y1 = -1;
+    for (int cy = 0; cy < MOTION_GRID_Y; cy++)
+    {
+        uint16_t bits = 0;
+        for (int cx = 0; cx < MOTION_GRID_X; cx++)
+        {
+            int32_t diff = (mean[cy][cx] - background[cy][cx]) - (frameMean - backMean);
+            bool moved = diff > limit || diff < -limit;
+
+            // cells with motion in them adapt much slower, so whatever moved doesn't
+            // become background right away, but something that stays put eventually does
+            int32_t b = background[cy][cx];
+            background[cy][cx] = b + (mean[cy][cx] - b) / (moved ? 64 : 8);
+
+            if (!moved)
+                continue;
+            bits |= 1 << cx;
+            changed++;
+            if (cx < x0) x0 = cx;
+            if (cx > x1) x1 = cx;
+            if (cy < y0) y0 = cy;
+            if (cy > y1) y1 = cy;
+        }
+        mask[cy] = bits;
+    }
+    cells = changed;
+
+    if (changed >= MOTION_MIN_CELLS)
+    {
+        lastMotion = now;
+        if (!active)
+        {
+            // a new event
+            MotionEvent &e = log[total % MOTION_EVENTS];
+            e.start = now;
+            e.end = 0;
+            e.peak = 0;
+            e.x0 = x0;
+            e.y0 = y0;
+            e.x1 = x1;
+            e.y1 = y1;
+            total++;
+            active = true;
+        }
+
+        MotionEvent &e = log[(total - 1) % MOTION_EVENTS];
+        if (changed > e.peak) e.peak = changed;
+        if (x0 < e.x0) e.x0 = x0;
+        if (y0 < e.y0) e.y0 = y0;
+        if (x1 > e.x1) e.x1 = x1;
+        if (y1 > e.y1) e.y1 = y1;
+    }
+    else if (active && now - lastMotion > MOTION_HOLD)
+    {
+        log[(total - 1) % MOTION_EVENTS].end = lastMotion;
+        active = false;
+    }
+
+    return active;
+}
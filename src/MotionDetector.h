@@ -0,0 +1,79 @@
+#ifndef MOTIONDETECTOR_H_
+#define MOTIONDETECTOR_H_
+
+#include <Arduino.h>
+#include "JpegScaler.h"
+
+#define MOTION_GRID_X 16             // cells across, one bit each in a mask row
+#define MOTION_GRID_Y 12             // cells down
+#define MOTION_EVENTS 16             // events remembered, oldest dropped first
+#define MOTION_HOLD 3000             // ms without motion before an event is over
+#define MOTION_DEFAULT_THRESHOLD 12  // luma change of a cell, out of 255, that counts as motion
+#define MOTION_MIN_CELLS 2           // cells that have to change for a frame to count as motion
+
+// One stretch of motion. Regions are in grid cells, inclusive
+struct MotionEvent
+{
+    uint32_t start; // millis() of the first frame with motion
+    uint32_t end;   // millis() of the last one, 0 while the event goes on
+    uint16_t peak;  // most cells changed in one frame
+    uint8_t x0, y0, x1, y1;
+};
+
+// Looks for motion in JPEG frames without decoding them: only the DC
+// coefficient of every luma block is kept, which is the frame at 1/8 size and
+// a fraction of the work of a full decode. Raw frames have their luma read
+// as it is. The picture is averaged over a coarse grid and every cell
+// compared to a slowly adapting background. Changes
+// of the whole picture, like the sensor adjusting exposure, are taken out
+// before comparing, so only cells that change against the rest count.
+//
+// Frames with enough changed cells start an event, and the event ends once
+// nothing has moved for MOTION_HOLD ms. The last MOTION_EVENTS events and the
+// cells that changed in the last frame can be read from any task; analyze()
+// is only ever called from one.
+class MotionDetector
+{
+public:
+    MotionDetector();
+
+    void setThreshold(int t) { threshold = t; }
+    int getThreshold(void) { return threshold; }
+
+    bool analyze(const uint8_t *jpg, size_t len, uint32_t now);
+    bool analyze(const uint8_t *luma, int width, int height, int stride, int step, uint32_t now);
+
+    bool isActive(void) { return active; }
+    int getCells(void) { return cells; }
+    uint16_t getMask(int row) { return mask[row]; }
+    int getWidth(void) { return width; }
+    int getHeight(void) { return height; }
+    int getRows(void) { return rows; }
+    uint32_t getFrames(void) { return frames; }
+    uint32_t getEventCount(void) { return total; }
+
+    int events(void) { return total < MOTION_EVENTS ? total : MOTION_EVENTS; }
+    MotionEvent event(int i);
+
+private:
+    bool analyze(const uint8_t *luma, int w, int h, int stride, int step, int frameWidth, int frameHeight, uint32_t now);
+
+    JpegScaler scaler;
+
+    volatile int threshold;
+    uint16_t background[MOTION_GRID_Y][MOTION_GRID_X]; // cell averages, 4 bits of fraction
+    bool primed;
+    int width, height; // of the frames
+    int rows;          // of the luma plane the grid is laid over
+
+    volatile uint16_t mask[MOTION_GRID_Y]; // cells that changed in the last frame, bit x for column x
+    volatile int cells;
+    volatile bool active;
+    uint32_t lastMotion;
+
+    MotionEvent log[MOTION_EVENTS];
+    volatile uint32_t total; // events so far, the newest is at (total - 1) % MOTION_EVENTS
+    volatile uint32_t frames;
+};
+
+#endif //MOTIONDETECTOR_H_
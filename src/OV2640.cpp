@@ -145,6 +145,16 @@ uint8_t *OV2640::getfb(void)
     return fb->buf;
 }
 
+// hand the current driver buffer over to the caller, who becomes responsible
+// for giving it back with esp_camera_fb_return()
+camera_fb_t *OV2640::detach(void)
+{
+    runIfNeeded();
+    camera_fb_t *f = fb;
+    fb = NULL;
+    return f;
+}
+
 framesize_t OV2640::getFrameSize(void)
 {
     return _cam_config.frame_size;
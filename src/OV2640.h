@@ -22,6 +22,7 @@ public:
     void run(void);
     size_t getSize(void);
     uint8_t *getfb(void);
+    camera_fb_t *detach(void);
     int getWidth(void);
     int getHeight(void);
     framesize_t getFrameSize(void);
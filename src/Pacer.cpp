@@ -0,0 +1,78 @@
+#include "Pacer.h"
+
+// exponential moving average with a weight of 1/8 for the new sample
+static uint32_t average(uint32_t avg, uint32_t sample)
+{
+    if (avg == 0)
+        return sample;
+    return avg - avg / 8 + sample / 8;
+}
+
+void Pacer::setTargetFps(int fps)
+{
+    if (fps < 1)
+        fps = 1;
+    if (fps > 60)
+        fps = 60;
+    targetFps = fps;
+}
+
+void Pacer::setMaxLatency(int ms)
+{
+    if (ms < 50)
+        ms = 50;
+    maxLatency = ms;
+}
+
+// called by the capture task after every frame
+void Pacer::onCapture(uint32_t ms, size_t bytes)
+{
+    captureMs = average(captureMs, ms);
+    frameBytes = average(frameBytes, bytes);
+}
+
+// called by the streaming task after every pass with the shortest and longest
+// period of all connected clients and the slowest drain rate of those getting
+// full size frames, 0 when there are none
+void Pacer::onClients(uint32_t fastest, uint32_t slowest, uint32_t rate)
+{
+    fastestMs = fastest;
+    slowestMs = slowest;
+    drainRate = rate;
+}
+
+// how long the capture task waits between frames, in ms
+uint32_t Pacer::captureInterval(void)
+{
+    uint32_t interval = framePeriod();
+
+    if (interval < captureMs)
+        interval = captureMs;
+
+    uint32_t consumer = fastestMs;
+    if (consumer > (uint32_t)maxLatency)
+        consumer = maxLatency;
+    if (interval < consumer)
+        interval = consumer;
+
+    return interval;
+}
+
+// how long a client draining drainRate bytes/s should wait between the starts
+// of two frames, in ms. Clients that can't keep up with the target frame rate
+// get frames only as fast as they drain them, so nothing piles up in the socket.
+// fps caps the rate further for clients of a slower stream profile, and bytes
+// is how big that profile's frames come out, the captured frames' size if 0
+uint32_t Pacer::clientPeriod(uint32_t drainRate, int fps, uint32_t bytes)
+{
+    uint32_t period = framePeriod();
+    if (fps > 0 && (uint32_t)(1000 / fps) > period)
+        period = 1000 / fps;
+    if (idle && period < 1000 / PACER_IDLE_FPS)
+        period = 1000 / PACER_IDLE_FPS;
+    if (drainRate == 0)
+        return period;
+
+    uint32_t drain = (uint64_t)(bytes ? bytes : frameBytes) * 1000 / drainRate;
+    return drain > period ? drain : period;
+}
@@ -0,0 +1,69 @@
+#ifndef PACER_H_
+#define PACER_H_
+
+#include <Arduino.h>
+
+#define PACER_DEFAULT_FPS 14
+#define PACER_DEFAULT_LATENCY 500 // ms
+#define PACER_IDLE_FPS 1          // what clients get while the pacer is idling
+
+// Works out how often to capture and how often to send to each client from
+// what the pipeline actually measures: how long a capture takes, how big the
+// frames come out and how fast each client drains them. The target frame rate
+// and the latency ceiling can be changed at any time.
+//
+// The capture interval follows the target frame rate but never runs faster
+// than the camera or than the fastest client can take frames. The latency
+// ceiling caps that last bit, so frames never sit around longer than the
+// ceiling waiting for somebody to pick them up.
+//
+// While idling (nothing moving in front of the camera) clients are held to
+// PACER_IDLE_FPS. Capture keeps its own pace, so whoever decides when to idle
+// still sees every frame.
+class Pacer
+{
+public:
+    Pacer(){
+        targetFps = PACER_DEFAULT_FPS;
+        maxLatency = PACER_DEFAULT_LATENCY;
+        captureMs = 0;
+        frameBytes = 0;
+        fastestMs = 0;
+        slowestMs = 0;
+        drainRate = 0;
+        idle = false;
+    };
+
+    void setTargetFps(int fps);
+    int getTargetFps(void) { return targetFps; }
+    void setMaxLatency(int ms);
+    int getMaxLatency(void) { return maxLatency; }
+    void setIdle(bool on) { idle = on; }
+    bool isIdle(void) { return idle; }
+
+    void onCapture(uint32_t ms, size_t bytes);
+    void onClients(uint32_t fastest, uint32_t slowest, uint32_t rate);
+
+    uint32_t framePeriod(void) { return 1000 / targetFps; }
+    uint32_t captureInterval(void);
+    uint32_t clientPeriod(uint32_t drainRate, int fps = 0, uint32_t bytes = 0);
+    bool overLatency(void) { return slowestMs > (uint32_t)maxLatency; }
+
+    uint32_t getCaptureMs(void) { return captureMs; }
+    uint32_t getFrameBytes(void) { return frameBytes; }
+    uint32_t getDrainRate(void) { return drainRate; }
+
+private:
+    volatile int targetFps;
+    volatile int maxLatency;
+    volatile bool idle;
+
+    // running averages, updated by the capture and streaming tasks
+    uint32_t captureMs;
+    uint32_t frameBytes;
+    uint32_t fastestMs; // shortest client period seen on the last streaming pass
+    uint32_t slowestMs; // longest one
+    uint32_t drainRate; // slowest full size client's drain rate on the last pass, bytes/s
+};
+
+#endif //PACER_H_
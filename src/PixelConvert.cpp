@@ -0,0 +1,205 @@
+#include "PixelConvert.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define PIXEL_WORDS 1
+#else
+#define PIXEL_WORDS 0
+#endif
+
+// Only ever called on 4-byte aligned pointers. Saying so lets the compiler
+// make these single loads and stores, which the ESP32 can't do unaligned
+static inline uint32_t load32(const uint8_t *p)
+{
+    uint32_t w;
+    memcpy(&w, __builtin_assume_aligned(p, 4), 4);
+    return w;
+}
+
+static inline void store32(uint8_t *p, uint32_t w)
+{
+    memcpy(__builtin_assume_aligned(p, 4), &w, 4);
+}
+
+static inline bool aligned(const void *p)
+{
+    return ((uintptr_t)p & 3) == 0;
+}
+
+// bytes 0 and 2 of a word, next to each other in the low half
+static inline uint32_t packEven(uint32_t w)
+{
+    w &= 0x00FF00FF;
+    return (w | w >> 8) & 0xFFFF;
+}
+
+// the sums of bytes 0 + 1 and 2 + 3, in 16-bit lanes
+static inline uint32_t pairSums(uint32_t w)
+{
+    return (w & 0x00FF00FF) + ((w >> 8) & 0x00FF00FF);
+}
+
+static inline uint8_t clamp8(int v)
+{
+    // below 0 the sign bit is set and ~(v >> 31) is 0, above 255 it is all ones
+    return (unsigned)v > 255 ? ~(v >> 31) & 255 : v;
+}
+
+// BT.601 full range, as JPEG has it, in 8 fractional bits: the weights add
+// up to 256, so a white pixel stays 255
+static inline uint8_t luma(int r, int g, int b)
+{
+    return (77 * r + 150 * g + 29 * b + 128) >> 8;
+}
+
+void yuv422ToY8(const uint8_t *yuyv, uint8_t *y, size_t pixels)
+{
+    size_t i = 0;
+#if PIXEL_WORDS
+    // four pixels, two words in and one out
+    if (aligned(yuyv) && aligned(y))
+        for (; i + 4 <= pixels; i += 4)
+            store32(y + i, packEven(load32(yuyv + i * 2)) | packEven(load32(yuyv + i * 2 + 4)) << 16);
+#endif
+    for (; i < pixels; i++)
+        y[i] = yuyv[i * 2];
+}
+
+// one YUV422 pair to RGB888: both pixels share their chroma, so it is only
+// worked out once. The second is left out at the odd end of a buffer
+static inline uint8_t *yuvPair(int y0, int u, int y1, int v, uint8_t *rgb, bool both)
+{
+    u -= 128;
+    v -= 128;
+    int dr = (359 * v + 128) >> 8;
+    int dg = (-88 * u - 183 * v + 128) >> 8;
+    int db = (454 * u + 128) >> 8;
+
+    *rgb++ = clamp8(y0 + dr);
+    *rgb++ = clamp8(y0 + dg);
+    *rgb++ = clamp8(y0 + db);
+    if (both)
+    {
+        *rgb++ = clamp8(y1 + dr);
+        *rgb++ = clamp8(y1 + dg);
+        *rgb++ = clamp8(y1 + db);
+    }
+    return rgb;
+}
+
+void yuv422ToRgb888(const uint8_t *yuyv, uint8_t *rgb, size_t pixels)
+{
+    size_t i = 0;
+#if PIXEL_WORDS
+    // a pair, one word
+    if (aligned(yuyv))
+        for (; i + 2 <= pixels; i += 2)
+        {
+            uint32_t w = load32(yuyv + i * 2);
+            rgb = yuvPair(w & 255, (w >> 8) & 255, (w >> 16) & 255, w >> 24, rgb, true);
+        }
+#endif
+    for (; i + 2 <= pixels; i += 2)
+        rgb = yuvPair(yuyv[i * 2], yuyv[i * 2 + 1], yuyv[i * 2 + 2], yuyv[i * 2 + 3], rgb, true);
+    // a lone last pixel has only Y and U in the buffer, and borrows the V of
+    // the pair before it
+    if (i < pixels)
+        yuvPair(yuyv[i * 2], yuyv[i * 2 + 1], 0, i ? yuyv[i * 2 - 1] : 128, rgb, false);
+}
+
+#if PIXEL_WORDS
+// Luma of the two pixels in a word, in bytes 0 and 2. The channels of both are
+// widened to 8 bits in 16-bit lanes and weighted with one multiply each: the
+// weighted sum is at most 255 * 256 + 128, so no lane carries into the next
+static inline uint32_t rgb565Luma2(uint32_t w)
+{
+    uint32_t h = w & 0x00FF00FF;        // RRRRRGGG
+    uint32_t l = (w >> 8) & 0x00FF00FF; // GGGBBBBB
+
+    uint32_t r = (h & 0x00F800F8) | ((h >> 5) & 0x00070007);
+    uint32_t g = ((h & 0x00070007) << 3) | ((l >> 5) & 0x00070007);
+    g = (g << 2) | ((g >> 4) & 0x00030003);
+    uint32_t b = ((l & 0x001F001F) << 3) | ((l >> 2) & 0x00070007);
+
+    return (r * 77 + g * 150 + b * 29 + 0x00800080) >> 8;
+}
+#endif
+
+void rgb565ToY8(const uint8_t *rgb565, uint8_t *y, size_t pixels)
+{
+    size_t i = 0;
+#if PIXEL_WORDS
+    if (aligned(rgb565) && aligned(y))
+        for (; i + 4 <= pixels; i += 4)
+            store32(y + i, packEven(rgb565Luma2(load32(rgb565 + i * 2))) | packEven(rgb565Luma2(load32(rgb565 + i * 2 + 4))) << 16);
+#endif
+    for (; i < pixels; i++)
+    {
+        int hb = rgb565[i * 2];
+        int lb = rgb565[i * 2 + 1];
+        int r = (hb & 0xF8) | (hb >> 5);
+        int g = ((hb & 7) << 3) | (lb >> 5);
+        int b = (lb & 0x1F) << 3 | (lb >> 2 & 7);
+        y[i] = luma(r, (g << 2) | (g >> 4), b);
+    }
+}
+
+void downscale2x(const uint8_t *src, int width, int height, int stride, uint8_t *dst, int dstStride)
+{
+    int w = width / 2;
+    int h = height / 2;
+#if PIXEL_WORDS
+    bool words = aligned(src) && aligned(dst) && (stride & 3) == 0 && (dstStride & 3) == 0;
+#endif
+    for (int y = 0; y < h; y++, dst += dstStride)
+    {
+        const uint8_t *r0 = src + y * 2 * stride;
+        const uint8_t *r1 = r0 + stride;
+        int x = 0;
+#if PIXEL_WORDS
+        // four pixels out of two words from each row
+        if (words)
+            for (; x + 4 <= w; x += 4)
+            {
+                uint32_t lo = pairSums(load32(r0 + x * 2)) + pairSums(load32(r1 + x * 2)) + 0x00020002;
+                uint32_t hi = pairSums(load32(r0 + x * 2 + 4)) + pairSums(load32(r1 + x * 2 + 4)) + 0x00020002;
+                store32(dst + x, packEven(lo >> 2) | packEven(hi >> 2) << 16);
+            }
+#endif
+        for (; x < w; x++)
+            dst[x] = (r0[x * 2] + r0[x * 2 + 1] + r1[x * 2] + r1[x * 2 + 1] + 2) >> 2;
+    }
+}
+
+void downscale4x(const uint8_t *src, int width, int height, int stride, uint8_t *dst, int dstStride)
+{
+    int w = width / 4;
+    int h = height / 4;
+#if PIXEL_WORDS
+    bool words = aligned(src) && (stride & 3) == 0;
+#endif
+    for (int y = 0; y < h; y++, dst += dstStride)
+    {
+        const uint8_t *r = src + y * 4 * stride;
+        int x = 0;
+#if PIXEL_WORDS
+        // one word from each of the four rows, their lanes summed and then folded
+        if (words)
+            for (; x < w; x++)
+            {
+                uint32_t s = pairSums(load32(r + x * 4)) + pairSums(load32(r + stride + x * 4)) +
+                             pairSums(load32(r + 2 * stride + x * 4)) + pairSums(load32(r + 3 * stride + x * 4));
+                dst[x] = (((s & 0xFFFF) + (s >> 16)) + 8) >> 4;
+            }
+#endif
+        for (; x < w; x++)
+        {
+            int sum = 8;
+            for (int j = 0; j < 4; j++)
+            {
+                const uint8_t *p = r + j * stride + x * 4;
+                sum += p[0] + p[1] + p[2] + p[3];
+            }
+            dst[x] = sum >> 4;
+        }
+    }
+}
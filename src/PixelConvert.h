@@ -0,0 +1,26 @@
+#ifndef PIXELCONVERT_H_
+#define PIXELCONVERT_H_
+
+#include <Arduino.h>
+
+// Conversion and downscale kernels for raw camera frames. YUV422 is the
+// camera's Y0 U Y1 V byte order and RGB565 its big-endian one, high byte
+// first; Y8 is one luma byte a pixel and RGB888 three bytes, R G B.
+//
+// On little-endian CPUs, which the ESP32 is, the kernels work a 32-bit word at
+// a time: bytes are split into 16-bit lanes and added, multiplied and shifted
+// two or four at once. Buffers that are not 4-byte aligned, row ends that
+// don't fill a word and big-endian hosts take a plain per-pixel path that
+// gives the same results.
+
+void yuv422ToY8(const uint8_t *yuyv, uint8_t *y, size_t pixels);
+void yuv422ToRgb888(const uint8_t *yuyv, uint8_t *rgb, size_t pixels);
+void rgb565ToY8(const uint8_t *rgb565, uint8_t *y, size_t pixels);
+
+// Average 2x2 or 4x4 boxes of a Y8 plane into one pixel each. dst gets
+// width / factor by height / factor pixels, the odd edge pixels are dropped.
+// dst may be src itself: every output row lies before the rows it comes from
+void downscale2x(const uint8_t *src, int width, int height, int stride, uint8_t *dst, int dstStride);
+void downscale4x(const uint8_t *src, int width, int height, int stride, uint8_t *dst, int dstStride);
+
+#endif //PIXELCONVERT_H_
@@ -0,0 +1,123 @@
+#include "QualityController.h"
+
+// quality steps down by this much for a frame that didn't fit its buffer
+#define QC_OVERFLOW_STEP 4
+
+// decisions in a row over budget at minimum quality before giving up resolution
+#define QC_STARVED_STEPS 3
+
+// smallest frame size the controller will step down to
+#define QC_MIN_FRAMESIZE FRAMESIZE_QVGA
+
+void QualityController::setBounds(int qmin, int qmax)
+{
+    if (qmin < 0)
+        qmin = 0;
+    if (qmax > 63)
+        qmax = 63;
+    if (qmin > qmax)
+        qmin = qmax;
+    qualityMin = qmin;
+    qualityMax = qmax;
+}
+
+// the operator set a quality by hand, carry on from there
+void QualityController::setQuality(int q)
+{
+    quality = q;
+    ceiling = 63;
+}
+
+// the operator set a frame size by hand, this is the one to return to
+void QualityController::setFramesize(framesize_t fs)
+{
+    framesize = fs;
+    preferred = fs;
+    starved = 0;
+    ceiling = 63;
+}
+
+// one decision from the average frame size, the target frame rate and the
+// slowest full size client's drain rate in bytes/s (0 if unknown). Returns true if
+// quality or frame size changed
+bool QualityController::step(uint32_t frameBytes, int fps, uint32_t drainRate)
+{
+    uint32_t rate = drainRate;
+    if (bitrate && (rate == 0 || (uint32_t)bitrate * 125 < rate))
+        rate = bitrate * 125; // kbit/s to bytes/s
+
+    if (rate == 0 || frameBytes == 0 || fps < 1)
+        return false;
+
+    uint32_t budget = rate / fps;
+    int q = quality;
+    framesize_t fs = framesize;
+
+    if (q > qualityMax)
+        q = qualityMax;
+    if (q > ceiling)
+        q = ceiling;
+    if (q < qualityMin)
+        q = qualityMin;
+
+    if (frameBytes > budget + budget / 10)
+    {
+        // over budget: back off in proportion to how far over we are
+        int over = (frameBytes - budget) * 4 / budget + 1;
+        q -= over > 5 ? 5 : over;
+
+        if (q <= qualityMin)
+        {
+            q = qualityMin;
+            if (++starved >= QC_STARVED_STEPS && fs > QC_MIN_FRAMESIZE)
+            {
+                fs = (framesize_t)(fs - 1);
+                starved = 0;
+            }
+        }
+    }
+    else if (frameBytes < budget * 7 / 10)
+    {
+        // plenty of headroom: get resolution back first, then quality
+        starved = 0;
+        if (fs < preferred && frameBytes < budget / 2)
+            fs = (framesize_t)(fs + 1);
+        else if (q < qualityMax && q < ceiling)
+            q++;
+    }
+    else
+        starved = 0;
+
+    bool changed = q != quality || fs != framesize;
+    quality = q;
+    framesize = fs;
+    return changed;
+}
+
+// run a decision if one is due and apply it to the sensor. Called by the
+// capture task after every frame
+void QualityController::update(sensor_t *s, uint32_t frameBytes, int fps, uint32_t drainRate)
+{
+    uint32_t now = millis();
+    if (!enabled || now - last < QC_INTERVAL)
+        return;
+    last = now;
+
+    framesize_t fs = framesize;
+    if (!step(frameBytes, fps, drainRate))
+        return;
+
+    if (fs != framesize && s->pixformat == PIXFORMAT_JPEG)
+        s->set_framesize(s, framesize);
+    s->set_quality(s, 63 - quality);
+}
+
+// A frame came out bigger than its buffer and was dropped: the next one has to
+// be smaller, so step quality down now rather than at the next decision
+void QualityController::overflow(sensor_t *s)
+{
+    int q = quality - QC_OVERFLOW_STEP;
+    quality = q > 0 ? q : 0;
+    ceiling = quality;
+    s->set_quality(s, 63 - quality);
+}
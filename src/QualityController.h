@@ -0,0 +1,72 @@
+#ifndef QUALITYCONTROLLER_H_
+#define QUALITYCONTROLLER_H_
+
+#include <Arduino.h>
+#include "esp_camera.h"
+
+#define QC_INTERVAL 1000 // ms between two decisions
+
+// Closed loop that keeps the JPEG stream within the bandwidth actually
+// available. Once a second it compares the average frame size with the byte
+// budget per frame - the operator's bitrate cap or the rate the slowest client
+// of full size frames drains, whichever is lower, divided by the target frame
+// rate - and nudges the JPEG quality down quickly when frames are too big and
+// back up slowly when there is headroom. Thumbnail clients don't count: their
+// frames are re-encoded at a fraction of the size. When quality is already at
+// its lower bound the frame size is stepped down as a last resort, and back up
+// to the operator's once the link recovers.
+//
+// Frames encoded here rather than by the sensor go into fixed buffers. One
+// that doesn't fit steps quality down at once, controller enabled or not, and
+// the controller stays below that quality until the operator changes it.
+//
+// Quality uses the same scale as /set?var=quality, i.e. higher is better.
+class QualityController
+{
+public:
+    QualityController(){
+        enabled = false;
+        qualityMin = 10;
+        qualityMax = 63;
+        bitrate = 0;
+        quality = 53;
+        ceiling = 63;
+        framesize = FRAMESIZE_SVGA;
+        preferred = FRAMESIZE_SVGA;
+        starved = 0;
+        last = 0;
+    };
+
+    void setEnabled(bool on) { enabled = on; }
+    bool isEnabled(void) { return enabled; }
+    void setBounds(int qmin, int qmax);
+    int getQualityMin(void) { return qualityMin; }
+    int getQualityMax(void) { return qualityMax; }
+    void setBitrate(int kbps) { bitrate = kbps > 0 ? kbps : 0; }
+    int getBitrate(void) { return bitrate; }
+
+    void setQuality(int q);
+    void setFramesize(framesize_t fs);
+    int getQuality(void) { return quality; }
+    framesize_t getFramesize(void) { return framesize; }
+
+    bool step(uint32_t frameBytes, int fps, uint32_t drainRate);
+    void update(sensor_t *s, uint32_t frameBytes, int fps, uint32_t drainRate);
+    void overflow(sensor_t *s);
+    int getCeiling(void) { return ceiling; }
+
+private:
+    volatile bool enabled;
+    volatile int qualityMin;
+    volatile int qualityMax;
+    volatile int bitrate; // kbit/s, 0 for no cap
+
+    int quality;
+    int ceiling;           // highest quality whose frames have fit their buffers, 63 until one didn't
+    framesize_t framesize; // what the sensor runs at right now
+    framesize_t preferred; // what the operator asked for
+    int starved;           // decisions in a row with quality at its floor and still over budget
+    uint32_t last;         // millis() of the last decision
+};
+
+#endif //QUALITYCONTROLLER_H_
@@ -0,0 +1,192 @@
+#include "Settings.h"
+
+Settings::Settings(const char *ns)
+{
+    this->ns = ns;
+    mutex = xSemaphoreCreateMutex();
+    count = 0;
+    pending = false;
+    changed = 0;
+    writes = 0;
+    table = NULL;
+    tableSize = 0;
+    memset(index, -1, sizeof(index));
+    memset(cached, -1, sizeof(cached));
+}
+
+static uint32_t hashName(const char *name)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    while (*name)
+        h = (h ^ (uint8_t)*name++) * 16777619u;
+    return h;
+}
+
+// Take over a table of settings and index it by name. Open addressing with
+// linear probing: with the index kept at most half full a lookup is one or two
+// string compares. A name too long for an NVS key could never be stored, so it
+// is left out and bind() returns false
+bool Settings::bind(const Setting *table, int count)
+{
+    if (count > SETTINGS_MAX)
+        count = SETTINGS_MAX;
+    this->table = table;
+    tableSize = count;
+
+    bool valid = true;
+    memset(index, -1, sizeof(index));
+    for (int i = 0; i < count; i++)
+    {
+        if (strlen(table[i].name) > SETTINGS_KEY_MAX)
+        {
+            valid = false;
+            continue;
+        }
+        uint32_t h = hashName(table[i].name) & (SETTINGS_HASH - 1);
+        while (index[h] >= 0)
+            h = (h + 1) & (SETTINGS_HASH - 1);
+        index[h] = i;
+    }
+    return valid;
+}
+
+const Setting *Settings::lookup(const char *name)
+{
+    uint32_t h = hashName(name) & (SETTINGS_HASH - 1);
+    while (index[h] >= 0)
+    {
+        const Setting *e = &table[index[h]];
+        if (strcmp(e->name, name) == 0)
+            return e;
+        h = (h + 1) & (SETTINGS_HASH - 1);
+    }
+    return NULL;
+}
+
+// clamp, apply and remember one setting. Returns false if there is no such setting
+bool Settings::set(const char *name, int value)
+{
+    const Setting *e = lookup(name);
+    if (e == NULL)
+        return false;
+
+    if (value < e->min)
+        value = e->min;
+    if (value > e->max)
+        value = e->max;
+    e->apply(value);
+    putInt(e->name, value);
+    return true;
+}
+
+// the stored value, or the live one if it was never set
+int Settings::get(const Setting &setting)
+{
+    return getInt(setting.name, setting.current());
+}
+
+// bring every setting to its stored value, at boot
+void Settings::applyAll(void)
+{
+    for (int i = 0; i < tableSize; i++)
+        table[i].apply(get(table[i]));
+}
+
+// the entry for key, a new one if there is room and NULL if not. Called locked
+Settings::Entry *Settings::find(const char *key)
+{
+    uint32_t h = hashName(key) & (SETTINGS_HASH - 1);
+    while (cached[h] >= 0)
+    {
+        Entry *e = &entries[cached[h]];
+        if (e->key == key || strcmp(e->key, key) == 0)
+            return e;
+        h = (h + 1) & (SETTINGS_HASH - 1);
+    }
+    if (count == SETTINGS_MAX)
+        return NULL;
+
+    // first time we see this key: take over what NVS has for it
+    cached[h] = count;
+    Entry *e = &entries[count++];
+    e->key = key;
+    e->dirty = false;
+    prefs.begin(ns, true);
+    e->stored = prefs.isKey(key);
+    e->value = e->stored ? prefs.getInt(key, 0) : 0;
+    prefs.end();
+    return e;
+}
+
+int Settings::getInt(const char *key, int def)
+{
+    lock();
+    Entry *e = find(key);
+    int value = e && e->stored ? e->value : def;
+    unlock();
+    return value;
+}
+
+void Settings::putInt(const char *key, int value)
+{
+    lock();
+    Entry *e = find(key);
+    if (e == NULL)
+    {
+        // no room in RAM, write it through
+        prefs.begin(ns, false);
+        prefs.putInt(key, value);
+        prefs.end();
+        writes++;
+    }
+    else if (!e->stored || e->value != value)
+    {
+        e->value = value;
+        e->stored = true;
+        e->dirty = true;
+        pending = true;
+        changed = millis();
+    }
+    unlock();
+}
+
+// write the changes back once nothing has changed for SETTINGS_DEBOUNCE ms
+void Settings::loop(uint32_t now)
+{
+    if (pending && now - changed >= SETTINGS_DEBOUNCE)
+        flush();
+}
+
+void Settings::flush(void)
+{
+    lock();
+    if (pending)
+    {
+        prefs.begin(ns, false);
+        for (int i = 0; i < count; i++)
+        {
+            if (!entries[i].dirty)
+                continue;
+            prefs.putInt(entries[i].key, entries[i].value);
+            entries[i].dirty = false;
+        }
+        prefs.end();
+        pending = false;
+        writes++;
+    }
+    unlock();
+}
+
+// forget everything, in RAM and in NVS
+void Settings::clear(void)
+{
+    lock();
+    prefs.begin(ns, false);
+    prefs.clear();
+    prefs.end();
+    count = 0;
+    memset(cached, -1, sizeof(cached));
+    pending = false;
+    unlock();
+}
@@ -0,0 +1,82 @@
+#ifndef SETTINGS_H_
+#define SETTINGS_H_
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#define SETTINGS_MAX 48         // distinct keys held in RAM
+#define SETTINGS_DEBOUNCE 2000  // ms without changes before they are written to flash
+#define SETTINGS_HASH 128       // hash slots, a power of two at least twice SETTINGS_MAX
+#define SETTINGS_KEY_MAX 15     // longest key NVS takes
+
+// One setting that can be changed at runtime: its name, which is also its NVS
+// key and so at most SETTINGS_KEY_MAX characters, the range it is clamped to, how to apply a value and how to read the
+// current one back when it was never set
+struct Setting
+{
+    const char *name;
+    int min;
+    int max;
+    void (*apply)(int value);
+    int (*current)(void);
+};
+
+// Write-back cache in front of an NVS namespace. putInt() only changes the copy
+// in RAM, so dragging a slider through dozens of values costs no flash writes;
+// flush() writes whatever changed in one go. loop() does that once things have
+// been quiet for a while, and whoever is about to restart calls flush() itself.
+//
+// Keys are kept by pointer and have to outlive the cache, string literals do.
+// Get and put are safe from any task.
+//
+// A table of Setting entries bound to the cache makes the settings themselves
+// data: set() finds one by name through a hash index, applies it and stores it,
+// and applyAll() restores the whole table at boot.
+class Settings
+{
+public:
+    Settings(const char *ns);
+
+    int getInt(const char *key, int def);
+    void putInt(const char *key, int value);
+
+    bool bind(const Setting *table, int count);
+    const Setting *lookup(const char *name);
+    bool set(const char *name, int value);
+    int get(const Setting &setting);
+    void applyAll(void);
+
+    void loop(uint32_t now);
+    void flush(void);
+    void clear(void);
+
+    uint32_t getWrites(void) { return writes; }
+
+private:
+    struct Entry
+    {
+        const char *key;
+        int value;
+        bool stored; // the value exists, in NVS or put since
+        bool dirty;  // put since the last flush
+    };
+
+    Entry *find(const char *key);
+    void lock(void) { xSemaphoreTake(mutex, portMAX_DELAY); }
+    void unlock(void) { xSemaphoreGive(mutex); }
+
+    const char *ns;
+    Preferences prefs;
+    const Setting *table;
+    int tableSize;
+    int8_t index[SETTINGS_HASH];   // table positions by name hash, -1 for empty slots
+    int8_t cached[SETTINGS_HASH];  // the same for entries
+    SemaphoreHandle_t mutex;
+    Entry entries[SETTINGS_MAX];
+    int count;
+    bool pending;
+    uint32_t changed; // millis() of the last put
+    uint32_t writes;  // NVS commits so far
+};
+
+#endif //SETTINGS_H_
@@ -0,0 +1,161 @@
+#include "StreamClient.h"
+
+const char HEADER[] = "HTTP/1.1 200 OK\r\n" \
+                      "Access-Control-Allow-Origin: *\r\n" \
+                      "Content-Type: multipart/x-mixed-replace; boundary=123456789000000000000987654321\r\n" \
+                      "\r\n--123456789000000000000987654321\r\n";
+const char BOUNDARY[] = "\r\n--123456789000000000000987654321\r\n";
+const size_t hdrLen = strlen(HEADER);
+const size_t bdrLen = strlen(BOUNDARY);
+
+StreamClient::StreamClient(int sock)
+{
+    this->sock = sock;
+    failed = false;
+    frame = NULL;
+    sent = 0;
+    started = 0;
+    due = 0;
+    period = 0;
+    drainRate = 0;
+    phase = STREAM_HTTP;
+    offset = 0;
+    stallStart = 0;
+    drained = 0;
+    stalled = 0;
+}
+
+StreamClient::~StreamClient()
+{
+    if (frame)
+        frame->release();
+    close(sock);
+}
+
+// a viewer never sends anything after its request, so a readable socket that
+// reads nothing means it has hung up
+bool StreamClient::connected(void)
+{
+    if (failed)
+        return false;
+
+    char c;
+    int n = recv(sock, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+        failed = true;
+    return !failed;
+}
+
+// begin sending a new frame and hold off the next one for interval ms.
+// Only valid while idle()
+void StreamClient::start(Frame *f, uint32_t interval)
+{
+    f->retain();
+    frame = f;
+    sent = f->getSeq();
+
+    started = millis();
+    due = started + interval;
+    period = interval;
+
+    phase = STREAM_FRAME;
+    offset = 0;
+}
+
+// write whatever the socket accepts right now without waiting for it
+size_t StreamClient::push(struct iovec *iov, int count)
+{
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+
+    int n = sendmsg(sock, &msg, MSG_DONTWAIT);
+    if (n < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            failed = true;
+        return 0;
+    }
+    return n;
+}
+
+// push as much of the current phase as the socket takes. Returns true if the
+// client still has bytes queued, i.e. it wants to be pumped again soon
+bool StreamClient::pump(void)
+{
+    if (phase == STREAM_IDLE || failed)
+        return false;
+
+    struct iovec iov[3];
+    int count;
+    if (phase == STREAM_HTTP)
+    {
+        iov[0].iov_base = (void *)HEADER;
+        iov[0].iov_len = hdrLen;
+        count = 1;
+    }
+    else
+    {
+        iov[0].iov_base = (void *)frame->getPart();
+        iov[0].iov_len = frame->getPartLen();
+        iov[1].iov_base = frame->getBuf();
+        iov[1].iov_len = frame->getSize();
+        iov[2].iov_base = (void *)BOUNDARY;
+        iov[2].iov_len = bdrLen;
+        count = 3;
+    }
+
+    // skip what has already gone out on earlier pumps
+    size_t total = 0;
+    for (int i = 0; i < count; i++)
+        total += iov[i].iov_len;
+
+    int first = 0;
+    size_t skip = offset;
+    while (skip >= iov[first].iov_len)
+        skip -= iov[first++].iov_len;
+    iov[first].iov_base = (uint8_t *)iov[first].iov_base + skip;
+    iov[first].iov_len -= skip;
+
+    size_t n = push(iov + first, count - first);
+    offset += n;
+    drained += n;
+
+    // a stall lasts from the socket filling up until it takes data again
+    if (stallStart && n)
+    {
+        stalled += millis() - stallStart;
+        stallStart = 0;
+    }
+    if (offset < total)
+    {
+        if (!stallStart)
+            stallStart = millis() | 1;
+        return !failed; // socket is full, come back later
+    }
+
+    if (phase == STREAM_FRAME)
+    {
+        // note how fast this client took the frame, averaged with a 1/4 weight
+        uint32_t elapsed = millis() - started;
+        uint32_t rate = (uint64_t)total * 1000 / (elapsed ? elapsed : 1);
+        drainRate = drainRate ? drainRate - drainRate / 4 + rate / 4 : rate;
+
+        // the frame is out, let the driver have the buffer back
+        frame->release();
+        frame = NULL;
+    }
+    phase = STREAM_IDLE;
+    offset = 0;
+    return false;
+}
+
+// hand over the bytes sent and the time stalled since the last call
+void StreamClient::collect(uint32_t &bytes, uint32_t &stallMs)
+{
+    bytes = drained;
+    stallMs = stalled;
+    drained = 0;
+    stalled = 0;
+}
@@ -0,0 +1,74 @@
+#ifndef STREAMCLIENT_H_
+#define STREAMCLIENT_H_
+
+#include <Arduino.h>
+#ifdef ARDUINO
+#include <lwip/sockets.h>
+#else
+#include <sys/socket.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+#include "Frame.h"
+
+// What a client is in the middle of sending
+enum stream_phase_t
+{
+    STREAM_HTTP,  // the HTTP response header, once per connection
+    STREAM_FRAME, // part header, JPEG and closing boundary of the current frame
+    STREAM_IDLE   // done with the current frame, ready for the next one
+};
+
+// One MJPEG viewer. The streaming task pumps every client once per pass and each
+// pump only pushes as many bytes as the socket takes without blocking, so a slow
+// viewer can no longer hold up the others. A client only moves on to a new frame
+// once it has finished the one it has, so a slow one skips straight to the newest.
+//
+// The client owns its socket outright: the web server hands it over and forgets
+// about it, so the two never touch the same connection.
+//
+// The part header comes ready-made with the frame, and header, JPEG and boundary
+// go out together in one gather write rather than as separate small segments.
+class StreamClient
+{
+public:
+    StreamClient(int sock);
+    ~StreamClient();
+
+    bool connected(void);
+    bool idle(void) { return phase == STREAM_IDLE; }
+    bool ready(uint32_t now) { return idle() && (int32_t)(now - due) >= 0; }
+    int getSocket(void) { return sock; }
+    uint32_t lastSeq(void) { return sent; }
+    uint32_t getDue(void) { return due; }
+    uint32_t getDrainRate(void) { return drainRate; }
+    uint32_t getPeriod(void) { return period; }
+    uint32_t stalledFor(uint32_t now) { return stallStart && (int32_t)(now - stallStart) > 0 ? now - stallStart : 0; }
+
+    void start(Frame *f, uint32_t interval);
+    void hurry(uint32_t now) { due = now; }
+    bool pump(void);
+    void collect(uint32_t &bytes, uint32_t &stallMs);
+
+private:
+    size_t push(struct iovec *iov, int count);
+
+    int sock; // taken over from the web server, closed with the client
+    bool failed;
+
+    Frame *frame; // the frame being sent, referenced until it is done
+    uint32_t sent; // sequence number of the last frame started
+
+    uint32_t started;   // millis() when the current frame was started
+    uint32_t due;       // millis() from which on the next frame may be started
+    uint32_t period;    // time between frame starts the pacer gave this client
+    uint32_t drainRate; // running average of how fast the body drains, bytes/s
+    stream_phase_t phase;
+    size_t offset; // bytes of the current phase already sent
+
+    uint32_t stallStart; // millis() when the socket filled up, 0 while it takes data
+    uint32_t drained;    // bytes sent since the last collect()
+    uint32_t stalled;    // ms spent with a full socket since the last collect()
+};
+
+#endif //STREAMCLIENT_H_
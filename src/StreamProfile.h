@@ -0,0 +1,26 @@
+#ifndef STREAMPROFILE_H_
+#define STREAMPROFILE_H_
+
+#include <Arduino.h>
+#include "Frame.h"
+
+// A stream served at its own URL, rate and size out of the single capture.
+// Downscaled profiles get their frames from the thumbnail task instead of
+// straight from the camera.
+struct StreamProfile
+{
+    const char *name;
+    const char *uri;
+    int fps;        // frame rate cap for this profile, 0 to follow the pacer's target
+    int decimation; // only send every n-th captured frame
+    int scale;      // 1 for full size, 2, 4 or 8 to shrink frames by that much
+
+    FrameExchange *frames; // where this profile's frames are published
+    uint32_t lastScaled;   // millis() of the last thumbnail made for it
+    uint32_t frameBytes;   // running average size of its frames, 0 before the first
+
+    // note the size of a frame published for this profile
+    void onFrame(size_t bytes) { frameBytes = frameBytes ? frameBytes - frameBytes / 8 + bytes / 8 : bytes; }
+};
+
+#endif //STREAMPROFILE_H_
@@ -0,0 +1,17 @@
+#include "Topology.h"
+
+const int rolePriority[ROLE_COUNT] = {4, 3, 2, 1};
+
+const int topologies[TOPOLOGY_COUNT][ROLE_COUNT] = {
+    // capture, stream, http, background
+    {APP_CPU, APP_CPU, APP_CPU, PRO_CPU}, // 0: the whole pipeline on one core, WiFi alone on the other
+    {APP_CPU, APP_CPU, PRO_CPU, PRO_CPU}, // 1: control next to WiFi, capture and sending undisturbed
+    {APP_CPU, PRO_CPU, PRO_CPU, PRO_CPU}, // 2: capture alone, everything that talks to the network next to WiFi
+};
+
+int topologyCore(int topology, task_role_t role)
+{
+    if (topology < 0 || topology >= TOPOLOGY_COUNT)
+        topology = TOPOLOGY_DEFAULT;
+    return topologies[topology][role];
+}
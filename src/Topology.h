@@ -0,0 +1,35 @@
+#ifndef TOPOLOGY_H_
+#define TOPOLOGY_H_
+
+#include <Arduino.h>
+
+#define APP_CPU 1
+#define PRO_CPU 0
+
+#define TOPOLOGY_COUNT 3
+#define TOPOLOGY_DEFAULT 1
+
+// Every task has a role, and the role decides its priority and, through the
+// topology, its core. Capture preempts sending, so frames keep coming however
+// busy the clients are, and sending preempts HTTP control, so a burst of /set
+// requests never starves the streams. Background work gets what is left.
+enum task_role_t
+{
+    ROLE_CAPTURE,
+    ROLE_STREAM,
+    ROLE_HTTP,
+    ROLE_BACKGROUND,
+    ROLE_COUNT
+};
+
+extern const int rolePriority[ROLE_COUNT];
+
+// Cores per role, one row per topology. WiFi and lwIP run on PRO_CPU at a
+// higher priority than any of the roles, so whatever shares that core with
+// them gets what the radio leaves.
+extern const int topologies[TOPOLOGY_COUNT][ROLE_COUNT];
+
+// the core a role runs on, the default topology's for one out of range
+int topologyCore(int topology, task_role_t role);
+
+#endif //TOPOLOGY_H_
@@ -0,0 +1,244 @@
+// Generated by tools/embed_ui.py from ui/index.html - edit that instead
+#ifndef INDEX_HTML_H_
+#define INDEX_HTML_H_
+
+#include <Arduino.h>
+
+// the page's hash: its ETag, and part of the URL it is cached under
+#define INDEX_HTML_HASH "837450671fb8f2cc"
+#define INDEX_HTML_PATH "/control/837450671fb8f2cc"
+
+static const uint8_t PROGMEM INDEX_HTML_GZ[] = {
+	0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xdd, 0x5c, 0xe9, 0x72, 0xdb, 0x46,
+	0x12, 0xfe, 0x6d, 0x3f, 0xc5, 0x18, 0x4e, 0x4c, 0xb0, 0x42, 0x52, 0x24, 0x75, 0x58, 0xe1, 0xe5,
+	0x48, 0x94, 0xe2, 0xec, 0x96, 0x8f, 0x6c, 0xe4, 0xda, 0x6c, 0x92, 0x4a, 0xd9, 0x43, 0x60, 0x40,
+	0x8e, 0x85, 0xcb, 0xc0, 0x80, 0x94, 0xc2, 0xf0, 0x39, 0xf6, 0x81, 0xf6, 0xc5, 0xb6, 0xe7, 0x00,
+	0x38, 0x00, 0x29, 0x0a, 0xb4, 0x49, 0x6d, 0x6a, 0x4b, 0x55, 0xe6, 0x60, 0xd0, 0xdd, 0xd3, 0xfd,
+	0xf5, 0x31, 0x3d, 0x20, 0xe8, 0xde, 0x13, 0x3b, 0xb0, 0xd8, 0x6d, 0x48, 0xd0, 0x84, 0x79, 0xee,
+	0xe0, 0x71, 0x4f, 0x7e, 0x3c, 0x7a, 0xd4, 0x9b, 0x10, 0x6c, 0xf3, 0x01, 0x0c, 0x3d, 0xc2, 0x30,
+	0xb2, 0x26, 0x38, 0x8a, 0x09, 0xeb, 0x1b, 0x09, 0x73, 0xea, 0xa7, 0x86, 0x7e, 0xcb, 0xc7, 0x1e,
+	0xe9, 0x1b, 0x53, 0x4a, 0x66, 0x61, 0x10, 0x31, 0x03, 0x59, 0x81, 0xcf, 0x88, 0x0f, 0xa4, 0x33,
+	0x6a, 0xb3, 0x49, 0xdf, 0x26, 0x53, 0x6a, 0x91, 0xba, 0xb8, 0xa8, 0x51, 0x9f, 0x32, 0x8a, 0xdd,
+	0x7a, 0x6c, 0x61, 0x97, 0xf4, 0x5b, 0xa9, 0x1c, 0x46, 0x99, 0x4b, 0x06, 0x97, 0x57, 0x3f, 0x1e,
+	0xb6, 0xeb, 0xc3, 0xb3, 0xd7, 0xe8, 0x8a, 0x45, 0x04, 0x7b, 0x08, 0xfb, 0x36, 0xba, 0xc2, 0x53,
+	0x82, 0x58, 0x80, 0xae, 0x2e, 0x7a, 0x07, 0x92, 0x4c, 0xb2, 0xc4, 0xec, 0x96, 0x8f, 0x47, 0x81,
+	0x7d, 0x3b, 0x77, 0x60, 0xc5, 0xba, 0x83, 0x3d, 0xea, 0xde, 0x76, 0xce, 0x22, 0x90, 0x5f, 0xfb,
+	0x81, 0xb8, 0x53, 0xc2, 0xa8, 0x85, 0x6b, 0x31, 0xf6, 0xe3, 0x7a, 0x4c, 0x22, 0xea, 0x74, 0x47,
+	0xd8, 0xba, 0x1e, 0x47, 0x41, 0xe2, 0xdb, 0x9d, 0xa7, 0xad, 0x53, 0xfe, 0xd7, 0xb5, 0x02, 0x37,
+	0x88, 0x3a, 0x4f, 0x2f, 0xbf, 0xe7, 0x7f, 0x5d, 0x21, 0x27, 0xa6, 0x7f, 0x90, 0x4e, 0xeb, 0x24,
+	0xbc, 0x59, 0x4c, 0xda, 0x73, 0x6d, 0xe6, 0x14, 0x66, 0x62, 0x62, 0x31, 0x1a, 0xf8, 0x0d, 0x0f,
+	0x53, 0x7f, 0x6e, 0xd3, 0x38, 0x74, 0xf1, 0x6d, 0xc7, 0x71, 0xc9, 0xcd, 0xe2, 0xa9, 0x47, 0xfc,
+	0xa4, 0x96, 0xbb, 0xcf, 0xe7, 0xeb, 0x36, 0x8d, 0xe4, 0x5c, 0x07, 0x96, 0x4a, 0x3c, 0x5f, 0x12,
+	0x66, 0xbc, 0x7e, 0xe0, 0x93, 0xae, 0x20, 0x9c, 0x45, 0x38, 0x84, 0x4b, 0xfe, 0xd1, 0xf5, 0xa8,
+	0x2f, 0xf1, 0xea, 0x1c, 0x1e, 0x35, 0xc3, 0x9b, 0x9c, 0xe2, 0x87, 0x27, 0xfc, 0xaf, 0x1b, 0x62,
+	0xdb, 0xa6, 0xfe, 0xb8, 0x73, 0xca, 0x6f, 0x07, 0x91, 0x4d, 0xa2, 0x7a, 0x84, 0x6d, 0x9a, 0xc4,
+	0x9d, 0x23, 0x98, 0xf1, 0x70, 0x34, 0x06, 0x19, 0x2c, 0x08, 0x3b, 0xf5, 0x56, 0x73, 0x39, 0x11,
+	0xd1, 0xf1, 0x84, 0x75, 0xf8, 0xcc, 0xe2, 0xa9, 0x72, 0x53, 0xce, 0x0c, 0x4d, 0x15, 0xa1, 0x08,
+	0x76, 0xe9, 0xd8, 0xaf, 0x53, 0x46, 0xbc, 0xb8, 0x13, 0x83, 0x4f, 0x98, 0x35, 0x59, 0x38, 0x74,
+	0x9c, 0x44, 0x64, 0x9e, 0x2a, 0xd0, 0x54, 0xb2, 0x61, 0x50, 0x9f, 0x91, 0xd1, 0x35, 0x65, 0x75,
+	0xb5, 0xd8, 0x88, 0x38, 0x41, 0x44, 0x32, 0x82, 0xfa, 0xc8, 0x0d, 0xac, 0xeb, 0x7a, 0xcc, 0x70,
+	0xc4, 0x56, 0x89, 0xb1, 0xc3, 0x48, 0x54, 0xa4, 0x25, 0x60, 0xf0, 0x0a, 0x65, 0x2a, 0x40, 0x5d,
+	0x52, 0xdf, 0xa5, 0x3e, 0xb9, 0x4b, 0xac, 0x94, 0x90, 0x27, 0x15, 0x73, 0xca, 0x0c, 0x44, 0xbd,
+	0x71, 0x86, 0x80, 0x58, 0xb4, 0x2b, 0x81, 0x6f, 0x35, 0x9b, 0x5f, 0x77, 0x27, 0x44, 0xe0, 0x85,
+	0x13, 0x16, 0x6c, 0x06, 0x99, 0xc7, 0xc6, 0x77, 0x1e, 0xb1, 0x29, 0x46, 0xe6, 0xd2, 0x79, 0xe8,
+	0xb4, 0x09, 0x48, 0x57, 0x45, 0x18, 0x9b, 0x41, 0x44, 0x01, 0x6d, 0x2c, 0x42, 0xc1, 0x85, 0x19,
+	0xc8, 0x80, 0x90, 0x54, 0xe7, 0xf7, 0xb9, 0x41, 0x45, 0xc4, 0xdd, 0x8e, 0x58, 0x63, 0x81, 0x87,
+	0x6f, 0xea, 0x9a, 0x15, 0xfc, 0x52, 0x59, 0x02, 0x59, 0x67, 0x99, 0x30, 0x39, 0x9d, 0xa0, 0x3a,
+	0xe2, 0xa1, 0x55, 0x55, 0xe6, 0x0a, 0x13, 0x35, 0x73, 0xff, 0x5f, 0xbc, 0x9c, 0x66, 0xec, 0xd3,
+	0x51, 0xc2, 0x58, 0xe0, 0xc7, 0xf7, 0xc0, 0xfc, 0x31, 0x89, 0x19, 0x75, 0x6e, 0xeb, 0xca, 0x29,
+	0x9d, 0x38, 0xc4, 0x50, 0xba, 0x46, 0x84, 0xcd, 0x08, 0x81, 0xd4, 0xf5, 0xf1, 0x14, 0xdc, 0x3d,
+	0x1e, 0xbb, 0x64, 0x6e, 0x25, 0x51, 0x0c, 0x95, 0x23, 0x0c, 0x28, 0x50, 0x46, 0xdd, 0x9c, 0x03,
+	0x74, 0xc2, 0xba, 0x35, 0x9a, 0x07, 0x09, 0xe3, 0x2a, 0x81, 0x8a, 0x01, 0xc8, 0xa3, 0xec, 0x16,
+	0x46, 0x12, 0xf6, 0x66, 0x8a, 0x79, 0xb3, 0xc0, 0xd3, 0xb1, 0x26, 0xc4, 0xba, 0x26, 0xf6, 0x37,
+	0xf9, 0x72, 0x21, 0x4a, 0x4d, 0x83, 0xfa, 0x61, 0xc2, 0xea, 0xbc, 0x20, 0x84, 0xf7, 0xd8, 0x23,
+	0x90, 0x50, 0x4b, 0xb4, 0xdb, 0x59, 0xcc, 0x76, 0x8e, 0xc3, 0x1b, 0xd4, 0xcc, 0x09, 0x1a, 0xb8,
+	0x78, 0x44, 0xdc, 0x4c, 0x9c, 0x02, 0x51, 0xc6, 0x93, 0x0a, 0x02, 0xad, 0x7a, 0x68, 0x15, 0xea,
+	0xe8, 0xf9, 0xd7, 0x39, 0x41, 0x48, 0x8c, 0x6b, 0xb9, 0xa9, 0x98, 0xb8, 0xe0, 0x06, 0x59, 0x10,
+	0x61, 0x66, 0xd6, 0x69, 0x2d, 0x1a, 0x11, 0xf6, 0xc7, 0x04, 0x1c, 0x78, 0x53, 0x4b, 0x87, 0x5a,
+	0x49, 0x5d, 0xb7, 0x7c, 0xa7, 0x89, 0x40, 0xed, 0x85, 0x74, 0xe4, 0x4a, 0xc4, 0xa7, 0x66, 0x69,
+	0xd4, 0xad, 0x76, 0x56, 0x1b, 0x01, 0xe8, 0x1c, 0x14, 0xbc, 0x6a, 0x16, 0x3c, 0xa8, 0x76, 0x02,
+	0xc7, 0xc9, 0xef, 0x13, 0x8e, 0x73, 0xd8, 0x3c, 0x3c, 0x2a, 0x64, 0x3f, 0x5f, 0x27, 0xbf, 0x57,
+	0x74, 0x33, 0x1f, 0x2b, 0x05, 0x3b, 0x93, 0x60, 0x4a, 0xa2, 0x79, 0x5e, 0xd4, 0xd1, 0xb7, 0x47,
+	0x76, 0x7a, 0x1f, 0x43, 0x5c, 0x4e, 0x49, 0x9e, 0xa0, 0xdd, 0xb2, 0xda, 0x2d, 0x45, 0xd0, 0x00,
+	0x0b, 0xf1, 0xc8, 0x25, 0x76, 0x1a, 0x6a, 0x36, 0x71, 0x70, 0xe2, 0xb2, 0x9c, 0x76, 0xb8, 0xc9,
+	0xff, 0x16, 0x02, 0xeb, 0xdf, 0xf8, 0x3e, 0xde, 0x17, 0x58, 0xfe, 0x3e, 0x4f, 0x13, 0x04, 0x87,
+	0x21, 0xc1, 0x30, 0x67, 0x11, 0xb9, 0xd5, 0xac, 0x16, 0x37, 0x11, 0x16, 0x6b, 0x36, 0x98, 0x02,
+	0x3c, 0x69, 0xfa, 0xaf, 0xae, 0xd5, 0x71, 0x02, 0x2b, 0x89, 0x97, 0x41, 0xbe, 0x86, 0xa2, 0x93,
+	0xaa, 0x13, 0xbb, 0x54, 0xc0, 0x98, 0xf8, 0x3e, 0xb7, 0xad, 0xce, 0x22, 0x58, 0x78, 0xbe, 0x46,
+	0xa9, 0x55, 0xff, 0xe8, 0x2a, 0xaa, 0xed, 0x3a, 0xef, 0x94, 0x66, 0xe6, 0x6b, 0x14, 0x07, 0xb0,
+	0x0e, 0x52, 0x64, 0x25, 0xf4, 0x61, 0x93, 0xc4, 0x1b, 0xcd, 0x15, 0x7b, 0x0b, 0x72, 0x43, 0x0a,
+	0x88, 0xc6, 0x23, 0x6c, 0x36, 0x6b, 0xcd, 0xda, 0x21, 0xfc, 0x53, 0xcd, 0x01, 0x26, 0x55, 0x6e,
+	0xb7, 0x57, 0x76, 0xdf, 0xe3, 0xe2, 0x7e, 0xad, 0x02, 0xa8, 0x60, 0xcd, 0x5d, 0xfe, 0xc9, 0x6d,
+	0xdc, 0xad, 0x06, 0x0f, 0xf8, 0x3b, 0x00, 0xbf, 0x0f, 0xd4, 0x55, 0xbc, 0xd6, 0x02, 0xe1, 0x05,
+	0x7f, 0xd4, 0x65, 0xfe, 0xfd, 0xcf, 0x7c, 0xa1, 0xa9, 0xf0, 0xd0, 0x7e, 0x58, 0xaf, 0x4f, 0xfc,
+	0x99, 0x58, 0x34, 0x51, 0x6a, 0x77, 0x5d, 0x56, 0x13, 0x10, 0xe3, 0xc3, 0x16, 0x12, 0xc1, 0x56,
+	0xd2, 0x5d, 0x99, 0xb9, 0x6b, 0x6d, 0x87, 0xba, 0x6e, 0xdd, 0x0d, 0x66, 0x85, 0xea, 0x91, 0xc3,
+	0xb9, 0x88, 0x6b, 0x11, 0xfe, 0x8d, 0xb2, 0x13, 0x88, 0xb9, 0x3d, 0xc8, 0x7e, 0xf8, 0x24, 0x5a,
+	0x3a, 0x65, 0x43, 0x92, 0xdc, 0x87, 0x68, 0x09, 0xd6, 0x55, 0xc0, 0x64, 0x8d, 0x5c, 0x34, 0xe2,
+	0x19, 0x85, 0x4e, 0xac, 0xb0, 0x19, 0x85, 0x41, 0x4c, 0x45, 0x9b, 0x17, 0x11, 0x17, 0xf3, 0x22,
+	0xbf, 0xba, 0x0d, 0x17, 0x36, 0x0f, 0xed, 0x56, 0x2a, 0x53, 0x6e, 0xa3, 0xe5, 0x5a, 0x87, 0x86,
+	0xac, 0x00, 0x2a, 0x5e, 0x05, 0x78, 0xb9, 0xe2, 0x9e, 0xc3, 0xb6, 0xbd, 0x31, 0x86, 0x55, 0xe0,
+	0x8e, 0x23, 0x72, 0x9b, 0x8a, 0xad, 0xa9, 0xcf, 0x8e, 0xec, 0xf4, 0xd6, 0xef, 0xd1, 0x22, 0xae,
+	0xa5, 0xd5, 0x8d, 0xa3, 0x78, 0x51, 0x60, 0x59, 0x45, 0x24, 0x6d, 0xb0, 0x0c, 0x63, 0xc5, 0xf5,
+	0x59, 0xb2, 0x09, 0x68, 0x54, 0x0e, 0xf2, 0xa1, 0x4b, 0x1c, 0x26, 0x1a, 0x6f, 0x5e, 0x1d, 0x0f,
+	0x73, 0x11, 0x52, 0x5f, 0xee, 0xde, 0xd2, 0x9f, 0x59, 0xff, 0x94, 0x62, 0xb3, 0x8e, 0x96, 0xc7,
+	0xd4, 0x7a, 0xf2, 0x54, 0xf1, 0xb4, 0xc4, 0x0a, 0xf3, 0x60, 0xc6, 0x93, 0x09, 0x0c, 0x46, 0x90,
+	0x7f, 0x99, 0xed, 0x13, 0xde, 0x3f, 0xdf, 0x7d, 0x6b, 0xa1, 0xda, 0x9e, 0x95, 0x94, 0x48, 0xb7,
+	0x58, 0x2d, 0x0a, 0x8e, 0x0a, 0x3e, 0x5b, 0xfa, 0x7d, 0xa5, 0xf3, 0x80, 0x6e, 0xcb, 0xc3, 0x50,
+	0x2c, 0x39, 0x84, 0x70, 0xcc, 0x04, 0xdb, 0x56, 0xe1, 0x5d, 0xb6, 0x67, 0xad, 0x13, 0x7e, 0xd8,
+	0x6b, 0x58, 0x6e, 0x10, 0x6b, 0x7e, 0xc0, 0x23, 0xd0, 0x24, 0x61, 0xa4, 0x2b, 0x5b, 0xba, 0x63,
+	0x05, 0xea, 0xf1, 0xfa, 0xb4, 0xd3, 0x7c, 0xa0, 0xbb, 0x26, 0xaf, 0x59, 0x8b, 0x9f, 0x75, 0xf4,
+	0x2e, 0x8a, 0x91, 0x1b, 0xd8, 0xdf, 0xf8, 0xb9, 0xa5, 0x63, 0x11, 0x11, 0x66, 0x7a, 0x1a, 0xb4,
+	0x56, 0x5b, 0xb0, 0x45, 0x63, 0x42, 0x6d, 0x9b, 0xf8, 0xb9, 0xc3, 0xf1, 0x42, 0x9e, 0xf6, 0x0f,
+	0xd4, 0x71, 0x9f, 0x0f, 0xd3, 0x47, 0x13, 0x3d, 0x7e, 0xf6, 0x1f, 0x20, 0xf5, 0x38, 0x40, 0xf6,
+	0xf9, 0xc8, 0x72, 0x71, 0x1c, 0xf7, 0x0d, 0x7e, 0x00, 0xe7, 0x0f, 0x17, 0x7a, 0x36, 0x9d, 0x22,
+	0x6a, 0xf7, 0x0d, 0x37, 0x18, 0x07, 0xea, 0x69, 0x83, 0xa0, 0x17, 0xed, 0x2e, 0x02, 0xbf, 0xf5,
+	0x8d, 0x5c, 0xe3, 0x6d, 0x08, 0xea, 0xe5, 0x94, 0x31, 0x78, 0xf6, 0xf4, 0xdb, 0xe7, 0xcf, 0x4f,
+	0xba, 0xcf, 0xfc, 0x51, 0x1c, 0xaa, 0x7f, 0xdf, 0x89, 0x5b, 0xd0, 0xd6, 0x32, 0x06, 0xad, 0x66,
+	0xdc, 0x3b, 0x10, 0xd2, 0x52, 0xe9, 0xbd, 0x03, 0x58, 0x34, 0xbb, 0x48, 0x15, 0x50, 0x11, 0xaf,
+	0xeb, 0x90, 0xde, 0x8a, 0x21, 0xe4, 0x46, 0x38, 0xd2, 0x6e, 0xc1, 0x4d, 0x11, 0x97, 0x48, 0x94,
+	0x25, 0x43, 0x44, 0xe7, 0x28, 0xb8, 0x29, 0x2a, 0x27, 0xf4, 0x55, 0xa1, 0xab, 0xa8, 0x88, 0x9d,
+	0x17, 0x03, 0xc4, 0x82, 0x89, 0x1f, 0x23, 0x72, 0x77, 0xd4, 0xfa, 0x0a, 0x2f, 0xad, 0x5b, 0x97,
+	0x8b, 0x38, 0x11, 0xf6, 0x08, 0x8f, 0x4d, 0x35, 0x99, 0x67, 0xcd, 0x03, 0x98, 0xd1, 0x1a, 0x83,
+	0x9f, 0x88, 0x08, 0x2c, 0xf0, 0x44, 0x01, 0x94, 0x8c, 0x4f, 0x26, 0x45, 0x7e, 0x0d, 0x23, 0x55,
+	0x43, 0xf5, 0xb8, 0x75, 0x2c, 0x9c, 0xb9, 0xb2, 0x28, 0xb0, 0x07, 0xa1, 0x70, 0xf3, 0x14, 0xbb,
+	0x09, 0x00, 0xd3, 0x3a, 0x34, 0x06, 0x10, 0xe1, 0xcd, 0x9b, 0x56, 0xbb, 0xd9, 0xec, 0x1d, 0xc8,
+	0x9b, 0xf7, 0x73, 0xb5, 0x81, 0xab, 0x7d, 0x0a, 0x5c, 0xcd, 0xf6, 0x51, 0x79, 0xae, 0x96, 0xe2,
+	0x7a, 0x7e, 0x72, 0x5a, 0x9e, 0xa9, 0x09, 0x4c, 0xb0, 0xca, 0x56, 0x4c, 0xdf, 0x1a, 0x83, 0x53,
+	0xb0, 0xe9, 0x64, 0x0b, 0x93, 0x4e, 0x8d, 0xc1, 0xc9, 0x51, 0xf3, 0xe6, 0xe8, 0x54, 0x63, 0x29,
+	0x22, 0x7f, 0x20, 0xa1, 0x2f, 0x04, 0x81, 0x1e, 0xac, 0x25, 0xe2, 0xe2, 0x53, 0x02, 0x29, 0xcd,
+	0x6e, 0x4b, 0x44, 0x85, 0xa2, 0x34, 0x06, 0xff, 0x90, 0x83, 0xbb, 0x02, 0x42, 0x5b, 0x2d, 0x3b,
+	0x08, 0x72, 0xd0, 0xd6, 0x68, 0x56, 0x48, 0x0b, 0x41, 0x9e, 0x53, 0xcb, 0x40, 0xc0, 0x2c, 0x50,
+	0x47, 0x70, 0xb2, 0xec, 0x1b, 0x27, 0x87, 0x86, 0xe6, 0x89, 0x92, 0x51, 0xb6, 0x46, 0x23, 0x7c,
+	0x03, 0xf8, 0x1e, 0xae, 0xc3, 0x6a, 0x4b, 0xf8, 0x46, 0xa2, 0xe0, 0xfa, 0x24, 0x8e, 0x4b, 0x20,
+	0xb8, 0x24, 0x36, 0x06, 0xe7, 0xd9, 0x78, 0x3b, 0x1c, 0xeb, 0xed, 0xad, 0x70, 0xd4, 0x96, 0x94,
+	0x50, 0xd6, 0xdb, 0x0a, 0xca, 0x76, 0x86, 0xe4, 0x97, 0x02, 0xd9, 0xde, 0x01, 0x8e, 0xbc, 0x9a,
+	0x46, 0x38, 0x66, 0x25, 0x50, 0x4c, 0x49, 0x8d, 0xc1, 0x50, 0x8d, 0xf6, 0x8a, 0x60, 0xb6, 0xdc,
+	0x5f, 0x1a, 0xbf, 0x18, 0xb3, 0x24, 0x12, 0x0f, 0x23, 0x4b, 0x20, 0xb8, 0x24, 0x36, 0x06, 0x57,
+	0xd9, 0x78, 0xaf, 0x28, 0x6a, 0x4b, 0xfe, 0xb5, 0x71, 0x0c, 0x89, 0x45, 0xb1, 0xfb, 0x9e, 0x38,
+	0x0e, 0x94, 0xd6, 0x32, 0x58, 0xe6, 0x18, 0x00, 0x4f, 0x79, 0x8d, 0x2e, 0xc5, 0x75, 0x89, 0x4d,
+	0xb3, 0x20, 0xe0, 0x73, 0x77, 0x4e, 0x00, 0x4f, 0x0a, 0xe5, 0x9d, 0x43, 0x3a, 0x32, 0x06, 0x6f,
+	0x82, 0x4c, 0x93, 0xb2, 0x3b, 0x1c, 0x30, 0x91, 0xb1, 0x68, 0x3b, 0x4b, 0xf3, 0xc0, 0xfe, 0xfb,
+	0x32, 0xc2, 0xb7, 0xe2, 0x4b, 0xa0, 0xd2, 0x4c, 0x87, 0xbc, 0xbb, 0xb0, 0xd1, 0x3b, 0xe8, 0x15,
+	0x4b, 0xf3, 0x1c, 0xf1, 0x85, 0x08, 0xf1, 0xb7, 0xe3, 0x3a, 0x86, 0x72, 0x0b, 0x83, 0xed, 0x98,
+	0x4e, 0xc0, 0x97, 0x24, 0xa4, 0xf8, 0x2e, 0x86, 0xdd, 0x6c, 0xbf, 0x78, 0x36, 0x2a, 0x11, 0x64,
+	0x40, 0x65, 0x0c, 0xce, 0x7e, 0x3e, 0x2f, 0x91, 0xa2, 0xf2, 0xb4, 0xb9, 0x2e, 0x5e, 0x64, 0x66,
+	0xaa, 0x45, 0x8d, 0x95, 0x4e, 0x74, 0x7d, 0xdc, 0x6d, 0xee, 0x46, 0x73, 0x9a, 0xa6, 0x0a, 0x88,
+	0x03, 0x97, 0xa1, 0x29, 0x7e, 0x97, 0xd6, 0x5f, 0x9e, 0xad, 0x20, 0xfe, 0xfd, 0x18, 0x4e, 0x06,
+	0xe5, 0x20, 0x14, 0xa4, 0x02, 0x47, 0xf4, 0x12, 0x46, 0xbb, 0x03, 0x53, 0x0a, 0x7e, 0x30, 0x44,
+	0x95, 0x1d, 0xfb, 0x83, 0x15, 0x96, 0xf0, 0x02, 0xbb, 0xcc, 0x49, 0x41, 0x51, 0x1a, 0x03, 0xc0,
+	0xf4, 0x35, 0x0c, 0x4a, 0xd4, 0xbb, 0x94, 0x65, 0xc7, 0x85, 0xee, 0x2c, 0x61, 0xc1, 0x36, 0x35,
+	0xee, 0x2a, 0xf1, 0xfd, 0xdb, 0x6d, 0x0a, 0xdc, 0xd0, 0x0d, 0x12, 0xfb, 0x76, 0x9b, 0xea, 0xf6,
+	0xd6, 0x71, 0xa8, 0x45, 0xb6, 0xa9, 0x6d, 0x3f, 0x04, 0x1e, 0xd9, 0x73, 0xbd, 0x21, 0x56, 0x99,
+	0x64, 0x21, 0x16, 0x20, 0x7a, 0x39, 0x44, 0x57, 0x97, 0x6f, 0xae, 0xde, 0xfe, 0xb4, 0xab, 0x4c,
+	0x01, 0xa9, 0x0f, 0x94, 0x24, 0x5c, 0xff, 0x3d, 0x96, 0x1d, 0x62, 0xb5, 0xcb, 0xa1, 0xd8, 0x96,
+	0x30, 0x5e, 0x5c, 0xfd, 0xb8, 0x3b, 0x0c, 0xdb, 0x0f, 0x07, 0x62, 0x7b, 0xbf, 0x28, 0xbe, 0x77,
+	0xc9, 0x94, 0xb8, 0xa5, 0x90, 0x94, 0xa4, 0x1c, 0x4d, 0xf4, 0x8a, 0x8f, 0xf6, 0xda, 0xac, 0x66,
+	0xcb, 0xfd, 0xa5, 0x5b, 0x55, 0xf0, 0xcf, 0x7b, 0xa1, 0x4e, 0xb9, 0x50, 0x94, 0xb4, 0xc6, 0xe0,
+	0xf2, 0x26, 0x0c, 0xe2, 0x24, 0x22, 0xdb, 0x21, 0xd8, 0xdc, 0x12, 0xc0, 0x74, 0x39, 0x89, 0x60,
+	0x7a, 0x7c, 0xe7, 0x4f, 0x75, 0x32, 0x0c, 0xdb, 0xcd, 0xa3, 0x2f, 0x44, 0x51, 0x3e, 0x24, 0xfa,
+	0x72, 0x20, 0xc7, 0xa5, 0x6a, 0xe2, 0x98, 0xd7, 0xc4, 0x97, 0xc3, 0x5d, 0x25, 0xf2, 0xf8, 0xc1,
+	0x8a, 0xe1, 0x78, 0x4f, 0xc5, 0x10, 0xc9, 0xc7, 0xbb, 0x19, 0x88, 0xa5, 0x5b, 0x31, 0x45, 0x0a,
+	0xbd, 0x7c, 0xb9, 0x36, 0x4c, 0x7f, 0x8c, 0x74, 0xb3, 0x5d, 0x20, 0xa6, 0x4b, 0xe5, 0xe3, 0xf0,
+	0x70, 0x19, 0x85, 0xc7, 0x5f, 0x18, 0x83, 0x87, 0x6b, 0x35, 0xda, 0x36, 0x04, 0xb9, 0x8e, 0x16,
+	0xa1, 0x2e, 0x7f, 0x2b, 0xe3, 0x7e, 0x00, 0x35, 0x6a, 0x89, 0x21, 0x1a, 0xca, 0xab, 0xed, 0xb0,
+	0x6c, 0x6f, 0x87, 0xa5, 0xbe, 0x6a, 0x1e, 0xce, 0x93, 0x9d, 0xd5, 0xc5, 0x56, 0xfb, 0x74, 0x17,
+	0x70, 0x8e, 0xc2, 0x32, 0x19, 0x0d, 0x54, 0x70, 0x30, 0xfc, 0x71, 0x57, 0x19, 0xcd, 0xc5, 0x95,
+	0xcc, 0xe8, 0xad, 0xf2, 0x57, 0xa8, 0xb9, 0xc7, 0x66, 0xbf, 0x14, 0x56, 0x33, 0xae, 0xc4, 0xcf,
+	0x3b, 0xc3, 0x6a, 0x16, 0x3e, 0x54, 0xf5, 0x9b, 0xed, 0x17, 0xbd, 0x08, 0xcf, 0xde, 0x8f, 0x3d,
+	0x5c, 0x02, 0x41, 0x45, 0x69, 0x0c, 0x7e, 0xc2, 0x33, 0xf4, 0xf2, 0xf5, 0xd9, 0x8e, 0x90, 0x4c,
+	0xc5, 0x3e, 0x0c, 0x9a, 0x99, 0x11, 0xfb, 0x43, 0xd4, 0x25, 0x7e, 0x99, 0x80, 0xe4, 0x64, 0xc6,
+	0xe0, 0x15, 0xf1, 0x63, 0x34, 0x0c, 0x22, 0xf5, 0x4e, 0xee, 0x8e, 0x30, 0x15, 0xb2, 0x1f, 0x06,
+	0x50, 0x69, 0xc6, 0xfe, 0xd0, 0x9c, 0x78, 0x34, 0x8a, 0x82, 0xa8, 0x04, 0xa0, 0x8a, 0x12, 0x0e,
+	0xa1, 0xf5, 0xd7, 0x62, 0xb4, 0x23, 0x30, 0x53, 0xb9, 0x0f, 0x83, 0x67, 0x66, 0xc5, 0xfe, 0x20,
+	0x9d, 0x3a, 0x2e, 0x0d, 0x4b, 0x00, 0x2a, 0xe8, 0x8c, 0xc1, 0x3f, 0xeb, 0xdf, 0xc3, 0xe7, 0x8e,
+	0xc0, 0x94, 0x32, 0x1f, 0x06, 0x4a, 0xa5, 0xff, 0xfe, 0x80, 0xb4, 0xad, 0x59, 0x09, 0x18, 0x81,
+	0xca, 0x18, 0x5c, 0x0c, 0x7f, 0x46, 0xe6, 0x45, 0x30, 0xf3, 0xf9, 0xb7, 0xcb, 0xe8, 0xf2, 0x4d,
+	0x75, 0x47, 0x78, 0x72, 0xe1, 0x0f, 0x83, 0xa6, 0x30, 0x63, 0x7f, 0x58, 0x8a, 0xf7, 0x34, 0x46,
+	0x38, 0x2a, 0xf5, 0xfd, 0x99, 0x24, 0xe5, 0xdf, 0x9f, 0xc1, 0x08, 0x9d, 0xe3, 0x5d, 0xa5, 0x7a,
+	0x26, 0x79, 0x1f, 0x6d, 0xd0, 0x52, 0xed, 0x6d, 0x51, 0xd4, 0x26, 0xd0, 0xe3, 0xc2, 0x63, 0x49,
+	0xf9, 0x92, 0x89, 0x68, 0xdf, 0xe4, 0x0b, 0xe5, 0xab, 0xd0, 0xc9, 0x1b, 0xb2, 0x05, 0x26, 0xac,
+	0x1e, 0x33, 0xea, 0xba, 0xd0, 0x76, 0x13, 0x86, 0xae, 0xf8, 0xb0, 0x77, 0x20, 0x09, 0x36, 0xf1,
+	0xa9, 0xb7, 0x3b, 0x62, 0xf1, 0x2b, 0x18, 0x63, 0x70, 0xc5, 0xdf, 0x7a, 0x57, 0xbf, 0x89, 0xc9,
+	0xd8, 0x73, 0xcc, 0x8f, 0x8b, 0x4f, 0xfe, 0xac, 0xd5, 0x47, 0x82, 0x9b, 0xbf, 0xc7, 0x62, 0x98,
+	0xc5, 0x1c, 0xaa, 0x02, 0x26, 0xbd, 0x03, 0x1f, 0x6b, 0x13, 0x85, 0xfb, 0x3d, 0xf9, 0x2b, 0x81,
+	0x1c, 0x43, 0xf6, 0x52, 0x8b, 0x50, 0x77, 0xf9, 0x96, 0x52, 0xe6, 0xd4, 0xc2, 0xdb, 0x4b, 0xe9,
+	0xa9, 0xf0, 0x6e, 0x65, 0xc5, 0xbb, 0x4b, 0x2a, 0x6c, 0xf9, 0x30, 0xc3, 0xe5, 0x3f, 0xff, 0x5e,
+	0xe7, 0x43, 0xea, 0x8d, 0x35, 0x05, 0x0c, 0x14, 0x47, 0x56, 0xdf, 0xc8, 0xbf, 0x14, 0x53, 0xb0,
+	0xe2, 0x20, 0x6f, 0x86, 0x76, 0x7b, 0x09, 0x65, 0x86, 0x72, 0x2f, 0xb6, 0x22, 0x1a, 0xca, 0xc7,
+	0xaa, 0x76, 0x60, 0x25, 0x1e, 0xf1, 0x59, 0x03, 0xdb, 0xf6, 0xe5, 0x14, 0x06, 0xaf, 0x68, 0xcc,
+	0x08, 0x18, 0x65, 0x56, 0x2e, 0xde, 0xbe, 0x1e, 0xca, 0x37, 0x7e, 0x5e, 0x05, 0xd8, 0x26, 0x76,
+	0xa5, 0x86, 0x9c, 0xc4, 0x97, 0xe1, 0x63, 0x56, 0xd1, 0x5c, 0xae, 0x95, 0x4d, 0x8d, 0xcc, 0xf3,
+	0x6c, 0xf2, 0xd1, 0x23, 0x17, 0x82, 0x65, 0xd8, 0x4d, 0xaf, 0xd4, 0x0b, 0x81, 0xe6, 0x79, 0x83,
+	0xa7, 0x89, 0x46, 0x66, 0xe1, 0x98, 0xa0, 0x4a, 0x9a, 0x35, 0x95, 0xce, 0xd2, 0xc4, 0x21, 0xea,
+	0xa3, 0xf3, 0x86, 0x2a, 0x3c, 0xe8, 0x05, 0x6a, 0xa1, 0x0e, 0x6a, 0x76, 0x97, 0xf7, 0x47, 0x00,
+	0xcd, 0x75, 0x37, 0x2f, 0x47, 0x1c, 0xab, 0x96, 0x42, 0xe4, 0xa4, 0x7c, 0x86, 0x5c, 0x0f, 0x7c,
+	0xb2, 0x2a, 0x5e, 0x9c, 0xe1, 0xee, 0x11, 0x2a, 0x83, 0x75, 0x45, 0x6a, 0x32, 0xf2, 0x28, 0x2b,
+	0x4a, 0xac, 0xb4, 0x2a, 0x77, 0x4a, 0x53, 0x95, 0x40, 0xe3, 0x88, 0x08, 0x4b, 0x22, 0x3f, 0x23,
+	0x58, 0x64, 0x2b, 0x40, 0x52, 0x32, 0x74, 0x01, 0xf2, 0x3e, 0x7c, 0x35, 0xb7, 0x16, 0xe0, 0x40,
+	0xf6, 0x62, 0x8a, 0xa3, 0xfe, 0x57, 0xf3, 0xf3, 0x06, 0xb5, 0x17, 0xcf, 0x40, 0x6b, 0x18, 0x0f,
+	0x17, 0x1f, 0x32, 0x56, 0x87, 0xff, 0x9a, 0xc6, 0xbc, 0xa8, 0x36, 0xd8, 0x84, 0xf8, 0xe6, 0x25,
+	0xea, 0x0f, 0x96, 0x10, 0x4b, 0x79, 0x81, 0x4b, 0x1a, 0x6e, 0x30, 0x36, 0x3f, 0x44, 0xe4, 0x53,
+	0x42, 0x40, 0x3c, 0x0b, 0xd0, 0x57, 0xf3, 0x8b, 0x05, 0x72, 0xa8, 0x4f, 0xe3, 0x09, 0xb1, 0x6b,
+	0x88, 0x27, 0x50, 0x12, 0x77, 0x60, 0xfa, 0xb2, 0x21, 0xc7, 0x8b, 0x0f, 0xd5, 0x4c, 0x39, 0x35,
+	0x52, 0x4a, 0x82, 0x3a, 0xc8, 0x02, 0x05, 0xb3, 0xf0, 0x71, 0x03, 0x4b, 0x7c, 0xd7, 0xdd, 0x08,
+	0x22, 0x3a, 0xa6, 0xa9, 0x51, 0xd2, 0x12, 0xc2, 0xb1, 0x2e, 0xe8, 0x04, 0xae, 0xe5, 0xa9, 0xc1,
+	0xa3, 0x8d, 0x87, 0x9e, 0x59, 0x91, 0x39, 0x54, 0x59, 0x2e, 0x58, 0xcb, 0x8c, 0xbb, 0x87, 0x3d,
+	0x22, 0x5e, 0x30, 0x25, 0x9b, 0x24, 0x8c, 0xcb, 0x28, 0x90, 0xfe, 0x58, 0xa1, 0x52, 0xad, 0x41,
+	0x64, 0xa4, 0x57, 0xc0, 0xf9, 0xa4, 0xb9, 0x2a, 0x71, 0x52, 0x52, 0xa7, 0xbb, 0x85, 0xb6, 0x56,
+	0x85, 0x52, 0x98, 0x37, 0xcf, 0x6b, 0x68, 0x58, 0x43, 0x17, 0xd5, 0x82, 0x70, 0x1e, 0x0d, 0x4f,
+	0x4c, 0x3f, 0x71, 0x5d, 0xf4, 0xa4, 0xcf, 0x6f, 0xff, 0xf9, 0x27, 0xba, 0xd0, 0x62, 0x8d, 0xe7,
+	0xdb, 0xa5, 0x76, 0xbd, 0xcc, 0x29, 0xd4, 0xef, 0xf3, 0x50, 0x17, 0x3f, 0x91, 0x7c, 0x81, 0x78,
+	0x70, 0x2c, 0xf3, 0x0a, 0xd6, 0xe2, 0x72, 0x9f, 0x0c, 0x6b, 0x5a, 0xae, 0xf5, 0xd1, 0xb0, 0x0a,
+	0xc9, 0xa6, 0x28, 0x45, 0x8a, 0xd4, 0xd2, 0x81, 0xb8, 0x09, 0xea, 0xa1, 0x67, 0xcf, 0xd0, 0x25,
+	0x68, 0x02, 0x97, 0x20, 0x54, 0xa4, 0x7e, 0x07, 0x3d, 0x11, 0xd3, 0x66, 0x05, 0x13, 0x2b, 0x5d,
+	0x95, 0xf2, 0xd4, 0xe5, 0x24, 0xc4, 0x9c, 0x72, 0x12, 0x47, 0x7e, 0x54, 0xf0, 0x78, 0x95, 0xc4,
+	0x74, 0x4c, 0x06, 0xb2, 0x89, 0x19, 0x57, 0xc5, 0xfa, 0x44, 0x5c, 0x3a, 0xea, 0xb2, 0x92, 0x7e,
+	0x0d, 0xb8, 0xc2, 0xe7, 0x98, 0x37, 0x9c, 0x80, 0xc8, 0x8f, 0x8a, 0x83, 0x2d, 0xf2, 0x1e, 0x4e,
+	0x47, 0xc1, 0xd8, 0x87, 0xce, 0x49, 0xa3, 0xe6, 0xba, 0x71, 0xfa, 0x89, 0xe9, 0x73, 0xc2, 0x31,
+	0x7c, 0x54, 0x97, 0xc1, 0xa2, 0xb0, 0xcb, 0x02, 0x1a, 0xb2, 0x24, 0xba, 0xbd, 0x12, 0xb5, 0x23,
+	0x88, 0xce, 0x5c, 0xd7, 0xac, 0xc8, 0x37, 0x50, 0x2b, 0xd5, 0x06, 0x6c, 0xce, 0x97, 0x18, 0xf2,
+	0x2d, 0x1f, 0x00, 0xe7, 0x8d, 0xc0, 0xb7, 0x5c, 0x6a, 0x5d, 0x73, 0x2f, 0x16, 0xdd, 0x47, 0xa0,
+	0xf4, 0xc9, 0x77, 0xe6, 0xdf, 0x04, 0x36, 0xa9, 0x16, 0x52, 0x7e, 0xc1, 0xed, 0x14, 0x29, 0x2c,
+	0x13, 0x1e, 0x36, 0xdd, 0x17, 0x16, 0xac, 0x40, 0x46, 0x09, 0x14, 0x63, 0x9e, 0xf8, 0x17, 0x98,
+	0x91, 0x86, 0x1f, 0xcc, 0xcc, 0x2a, 0xe4, 0xa4, 0xcc, 0xf2, 0x65, 0x2d, 0xd6, 0xeb, 0xae, 0xac,
+	0x29, 0x60, 0xf0, 0xc7, 0x38, 0xf0, 0xcd, 0x34, 0x69, 0x37, 0xb2, 0x6c, 0x32, 0x39, 0xdf, 0xbe,
+	0x68, 0xb6, 0x0f, 0x0b, 0x06, 0x52, 0x93, 0xc7, 0xd0, 0x6f, 0x43, 0x00, 0xfa, 0xf7, 0x1a, 0x44,
+	0xb7, 0x56, 0x38, 0x96, 0xbb, 0x00, 0x61, 0xef, 0xa8, 0x47, 0x82, 0x84, 0x65, 0x9a, 0x98, 0xd5,
+	0xf9, 0x27, 0xb3, 0xda, 0x5d, 0xd4, 0x8e, 0x9b, 0xcd, 0x94, 0x30, 0xe3, 0x90, 0xd5, 0xe3, 0x17,
+	0xc0, 0xd3, 0x27, 0x33, 0x24, 0x76, 0xa7, 0xab, 0x20, 0x89, 0x2c, 0xa2, 0x60, 0x22, 0x7c, 0x26,
+	0xfe, 0x50, 0xcd, 0x12, 0xe8, 0x57, 0xbd, 0x22, 0x01, 0x88, 0x97, 0x2e, 0xe1, 0xc3, 0xf3, 0xdb,
+	0xbf, 0x41, 0x7e, 0x8b, 0xfe, 0xa0, 0x92, 0xca, 0xfe, 0x65, 0xcd, 0x86, 0x97, 0xbe, 0x0c, 0x0b,
+	0x1b, 0x5d, 0xde, 0xb5, 0x52, 0x11, 0x9e, 0x2a, 0x7f, 0xbf, 0x7a, 0xfb, 0x86, 0x3b, 0x32, 0xe6,
+	0x0e, 0xb5, 0x31, 0xc3, 0x4b, 0xeb, 0x3e, 0x0b, 0xc6, 0x8b, 0x62, 0x9a, 0xf3, 0x40, 0xe5, 0x4f,
+	0x37, 0x79, 0xb4, 0x52, 0xf3, 0x02, 0x12, 0xf4, 0xb7, 0x8b, 0x35, 0x98, 0x2e, 0xe3, 0x66, 0xad,
+	0x21, 0xc2, 0xd4, 0xcf, 0xb2, 0xe2, 0xd7, 0x06, 0x7f, 0xe9, 0x59, 0xed, 0xfb, 0x72, 0x07, 0x1a,
+	0x36, 0x9c, 0x30, 0x86, 0x8d, 0x22, 0x8c, 0x6b, 0x88, 0x5f, 0x5d, 0x8f, 0xf8, 0xe5, 0xf5, 0x88,
+	0xb2, 0x03, 0x35, 0x03, 0x61, 0xcf, 0x3d, 0xb1, 0x40, 0xfc, 0x17, 0xd4, 0x80, 0x60, 0x0d, 0xa9,
+	0x97, 0x19, 0xc5, 0x5d, 0x35, 0x5e, 0x7c, 0x40, 0xdf, 0x40, 0x02, 0x36, 0xbc, 0x40, 0x84, 0xe0,
+	0x0b, 0x04, 0x0a, 0xca, 0x71, 0x85, 0xa7, 0x6d, 0xa5, 0x2a, 0x6f, 0x53, 0xdb, 0x25, 0xf2, 0x26,
+	0x1f, 0xa9, 0x5b, 0x6b, 0x03, 0xe3, 0xe3, 0x66, 0x6f, 0xf3, 0xd6, 0xa9, 0xb2, 0x8c, 0x8d, 0xeb,
+	0xfb, 0xa9, 0x97, 0x1d, 0x9d, 0xc6, 0xe7, 0x6e, 0xe2, 0xcb, 0xba, 0x63, 0x8d, 0xc1, 0xdb, 0xc4,
+	0x90, 0x6b, 0x8b, 0x35, 0xa6, 0x60, 0x13, 0x93, 0xde, 0x32, 0x6a, 0x3c, 0xe1, 0xba, 0x42, 0x03,
+	0xf0, 0xdb, 0xc1, 0x0c, 0xf6, 0xef, 0x20, 0x34, 0x21, 0x3a, 0xbc, 0x06, 0xf5, 0xc1, 0x9e, 0x1f,
+	0xde, 0xbd, 0x7e, 0xc5, 0xdb, 0x13, 0xbd, 0x0d, 0xaf, 0xac, 0x6e, 0x40, 0x9f, 0xd6, 0x49, 0xfc,
+	0xd8, 0x80, 0xf6, 0x33, 0xeb, 0x45, 0xbc, 0x8f, 0x21, 0x19, 0x1f, 0xb4, 0x3e, 0xf0, 0xc2, 0x7c,
+	0xbd, 0x6e, 0x81, 0x20, 0x5c, 0x91, 0xaf, 0xbc, 0xe6, 0xde, 0x5d, 0x20, 0x85, 0xae, 0xf9, 0x85,
+	0x3e, 0x86, 0xe3, 0x17, 0xef, 0xad, 0x51, 0xa1, 0xf6, 0xc9, 0x65, 0x55, 0x38, 0xd4, 0x50, 0x70,
+	0x8f, 0x48, 0xa2, 0x13, 0x7b, 0x77, 0x13, 0xcb, 0x80, 0x3a, 0x2f, 0x5a, 0x20, 0xf6, 0x0e, 0xcd,
+	0xc2, 0x2c, 0x4b, 0xce, 0x21, 0x42, 0x61, 0x01, 0x08, 0xce, 0x4f, 0xe6, 0x72, 0x81, 0xcf, 0xaa,
+	0x00, 0x6b, 0x36, 0x91, 0x09, 0x6f, 0x63, 0x33, 0x25, 0xf9, 0xe6, 0xba, 0x36, 0xfe, 0xa3, 0x4d,
+	0x31, 0xc3, 0x37, 0xd8, 0x65, 0xa8, 0xc4, 0xf7, 0x90, 0x6a, 0xdf, 0x63, 0x69, 0x5c, 0x6c, 0x63,
+	0xe8, 0x17, 0xbf, 0xbf, 0xc9, 0x4a, 0x6b, 0xb4, 0x6a, 0x43, 0x66, 0xdf, 0xc8, 0x8c, 0xc0, 0x2d,
+	0x91, 0xd6, 0xd7, 0x6f, 0xd8, 0xf5, 0x1f, 0xe7, 0xc2, 0x47, 0x1a, 0x9d, 0x6c, 0xb4, 0x84, 0xe8,
+	0x46, 0x4f, 0xef, 0x21, 0xd5, 0xbf, 0x4a, 0xce, 0x94, 0x4f, 0x36, 0x2a, 0x9f, 0x80, 0x6a, 0x89,
+	0xa6, 0xbc, 0xd6, 0xd5, 0xac, 0x53, 0x76, 0xb6, 0x51, 0x83, 0xb4, 0x9f, 0x59, 0x6a, 0x7c, 0xb3,
+	0x89, 0x3e, 0xf7, 0x8a, 0x52, 0xa6, 0xef, 0x6c, 0xa3, 0xbe, 0x33, 0xd0, 0x77, 0xa6, 0xe9, 0xab,
+	0xb5, 0x4a, 0xeb, 0xf4, 0x3d, 0xdb, 0xb4, 0x7e, 0xf6, 0x53, 0x87, 0x6c, 0xed, 0xb3, 0x8d, 0x6b,
+	0x9f, 0xc1, 0xda, 0xc7, 0xa8, 0x87, 0xce, 0x54, 0xe7, 0xc8, 0xdb, 0x2f, 0x6a, 0xde, 0x8a, 0x8d,
+	0x0c, 0x8a, 0xbb, 0xf9, 0x87, 0x18, 0xe9, 0xc7, 0x0a, 0x19, 0xdf, 0x70, 0x60, 0xcd, 0x8e, 0xa7,
+	0xbd, 0x03, 0xf1, 0x03, 0x99, 0xc7, 0xbd, 0x03, 0xf9, 0xbf, 0x7a, 0xfc, 0x17, 0x8e, 0xee, 0x05,
+	0x70, 0xed, 0x43, 0x00, 0x00,
+};
+
+#endif //INDEX_HTML_H_
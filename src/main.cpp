@@ -1,10 +1,24 @@
-#define APP_CPU 1
-#define PRO_CPU 0
-
 #include "OV2640.h"
+#include "Frame.h"
+#include "StreamClient.h"
+#include "StreamProfile.h"
+#include "ClientRegistry.h"
+#include "Settings.h"
+#include "Pacer.h"
+#include "QualityController.h"
+#include "JpegScaler.h"
+#include "JpegEncoder.h"
+#include "PixelConvert.h"
+#include "HttpServer.h"
+#include "Metrics.h"
+#include "BufferPool.h"
+#include "MotionDetector.h"
+#include "FrameRing.h"
+#include "Topology.h"
+#include "ClipClient.h"
+#include "EventStream.h"
+#include "index_html.h"
 #include <WiFi.h>
-#include <WebServer.h>
-#include <WiFiClient.h>
 
 #include <esp_bt.h>
 #include <esp_wifi.h>
@@ -16,6 +30,10 @@
 
 Preferences preferences;
 
+// Settings changed through /set are kept in RAM and written to flash in one go once
+// they have stopped changing, rather than one flash write per slider step
+Settings settings("CameraSettings");
+
 // Select camera model
 //#define CAMERA_MODEL_WROVER_KIT
 //#define CAMERA_MODEL_ESP_EYE
@@ -29,19 +47,26 @@ Preferences preferences;
 
 OV2640 cam;
 
-WebServer server(80);
+HttpServer server(80);
 
 void handleJPGSstream(void);
 void streamCB(void * pvParameters);
 void camCB(void* pvParameters);
-char* allocateMemory(char* aPtr, size_t aSize);
+void thumbCB(void* pvParameters);
+void motionCB(void* pvParameters);
+void recordCB(void* pvParameters);
 
 void handleJPG(void);
+void metrics_handler(void);
+void motion_handler(void);
+void clip_handler(void);
+void events_handler(void);
 
 void set_handler();
 void get_handler();
 
 void control3_handler();
+void index_handler();
 void restart_handler();
 void activatewebota_handler();
 void reset_handler();
@@ -49,632 +74,1099 @@ void handleNotFound();
 
 unsigned int counter = 0;
 
-//HTML-----------------------------------
-static const char PROGMEM INDEX_HTML[] = R"rawliteral(
-<!doctype html>
-<html>
-		<head>
-				<meta charset="utf-8">
-				<meta name="viewport" content="width=device-width,initial-scale=1">
-				<title>ESP32-CAM Stream and Save to SD</title>
-				<style>
-body{font-family:Arial,Helvetica,sans-serif;background:#181818;color:#EFEFEF;font-size:16px}h2{font-size:18px}section.main{display:flex}#menu,section.main{flex-direction:column}#menu{display:none;flex-wrap:nowrap;min-width:340px;background:#363636;padding:8px;border-radius:4px;margin-top:-10px;margin-right:10px}#content{display:flex;flex-wrap:wrap;align-items:stretch}figure{padding:0;margin:0;-webkit-margin-before:0;margin-block-start:0;-webkit-margin-after:0;margin-block-end:0;-webkit-margin-start:0;margin-inline-start:0;-webkit-margin-end:0;margin-inline-end:0}figure img{display:block;width:100%;height:auto;border-radius:4px;margin-top:8px}@media (min-width: 800px) and (orientation:landscape){#content{display:flex;flex-wrap:nowrap;align-items:stretch}figure img{display:block;max-width:100%;max-height:calc(100vh - 40px);width:auto;height:auto}figure{padding:0;margin:0;-webkit-margin-before:0;margin-block-start:0;-webkit-margin-after:0;margin-block-end:0;-webkit-margin-start:0;margin-inline-start:0;-webkit-margin-end:0;margin-inline-end:0}}section#buttons{display:flex;flex-wrap:nowrap;justify-content:space-between}#nav-toggle{cursor:pointer;display:block}#nav-toggle-cb{outline:0;opacity:0;width:0;height:0}#nav-toggle-cb:checked+#menu{display:flex}.input-group{display:flex;flex-wrap:nowrap;line-height:22px;margin:5px 0}.input-group>label{display:inline-block;padding-right:10px;min-width:47%}.input-group input,.input-group select{flex-grow:1}.range-max,.range-min{display:inline-block;padding:0 5px}button{display:block;margin:5px;padding:0 12px;border:0;line-height:28px;cursor:pointer;color:#fff;background:#ff3034;border-radius:5px;font-size:16px;outline:0}button:hover{background:#ff494d}button:active{background:#f21c21}button.disabled{cursor:default;background:#a0a0a0}input[type=range]{-webkit-appearance:none;width:100%;height:22px;background:#363636;cursor:pointer;margin:0}input[type=range]:focus{outline:0}input[type=range]::-webkit-slider-runnable-track{width:100%;height:2px;cursor:pointer;background:#EFEFEF;border-radius:0;border:0 solid #EFEFEF}input[type=range]::-webkit-slider-thumb{border:1px solid rgba(0,0,30,0);height:22px;width:22px;border-radius:50px;background:#ff3034;cursor:pointer;-webkit-appearance:none;margin-top:-11.5px}input[type=range]:focus::-webkit-slider-runnable-track{background:#EFEFEF}input[type=range]::-moz-range-track{width:100%;height:2px;cursor:pointer;background:#EFEFEF;border-radius:0;border:0 solid #EFEFEF}input[type=range]::-moz-range-thumb{border:1px solid rgba(0,0,30,0);height:22px;width:22px;border-radius:50px;background:#ff3034;cursor:pointer}input[type=range]::-ms-track{width:100%;height:2px;cursor:pointer;background:0 0;border-color:transparent;color:transparent}input[type=range]::-ms-fill-lower{background:#EFEFEF;border:0 solid #EFEFEF;border-radius:0}input[type=range]::-ms-fill-upper{background:#EFEFEF;border:0 solid #EFEFEF;border-radius:0}input[type=range]::-ms-thumb{border:1px solid rgba(0,0,30,0);height:22px;width:22px;border-radius:50px;background:#ff3034;cursor:pointer;height:2px}input[type=range]:focus::-ms-fill-lower{background:#EFEFEF}input[type=range]:focus::-ms-fill-upper{background:#363636}.switch{display:block;position:relative;line-height:22px;font-size:16px;height:22px}.switch input{outline:0;opacity:0;width:0;height:0}.slider{width:50px;height:22px;border-radius:22px;cursor:pointer;background-color:grey}.slider,.slider:before{display:inline-block;transition:.4s}.slider:before{position:relative;content:"";border-radius:50%;height:16px;width:16px;left:4px;top:3px;background-color:#fff}input:checked+.slider{background-color:#ff3034}input:checked+.slider:before{-webkit-transform:translateX(26px);transform:translateX(26px)}select{border:1px solid #363636;font-size:14px;height:22px;outline:0;border-radius:5px}.image-container{position:relative;min-width:160px}.close{position:absolute;right:5px;top:5px;background:#ff3034;width:16px;height:16px;border-radius:100px;color:#fff;text-align:center;line-height:18px;cursor:pointer}.hidden{display:none}
-				</style>
-		</head>
-		<body> 
-				<section class="main">
-	<div id="logo">
-								<label for="nav-toggle-cb" id="nav-toggle">&#9776;&nbsp;&nbsp;Toggle settings</label>
-						</div>
-						<div id="content">
-								<div id="sidebar">
-										<input type="checkbox" id="nav-toggle-cb" checked="checked">
-										<nav id="menu">
-												<div class="input-group" id="framesize-group">
-														<label for="framesize">Resolution</label>
-														<select id="framesize" class="default-action">
-																<option value="13">1600x1200</option>
-																<option value="12">1280x1024</option>
-																<option value="11">1280x768</option>
-																<option value="10">1024x768</option>
-																<option value="9">800x600</option>
-																<option value="8">640x480</option>
-
-														</select>
-												</div>
-												<div class="input-group" id="quality-group">
-														<label for="quality">Quality</label>
-														<div class="range-min">10</div>
-														<input type="range" id="quality" min="10" max="63" value="10" class="default-action">
-														<div class="range-max">63</div>
-												</div>
-												<div class="input-group" id="brightness-group">
-														<label for="brightness">Brightness</label>
-														<div class="range-min">-2</div>
-														<input type="range" id="brightness" min="-2" max="2" value="0" class="default-action">
-														<div class="range-max">2</div>
-												</div>
-												<div class="input-group" id="contrast-group">
-														<label for="contrast">Contrast</label>
-														<div class="range-min">-2</div>
-														<input type="range" id="contrast" min="-2" max="2" value="0" class="default-action">
-														<div class="range-max">2</div>
-												</div>
-												<div class="input-group" id="saturation-group">
-														<label for="saturation">Saturation</label>
-														<div class="range-min">-2</div>
-														<input type="range" id="saturation" min="-2" max="2" value="0" class="default-action">
-														<div class="range-max">2</div>
-												</div>
-												<div class="input-group" id="special_effect-group">
-														<label for="special_effect">Special Effect</label>
-														<select id="special_effect" class="default-action">
-																<option value="0" selected="selected">No Effect</option>
-																<option value="1">Negative</option>
-																<option value="2">Grayscale</option>
-																<option value="3">Red Tint</option>
-																<option value="4">Green Tint</option>
-																<option value="5">Blue Tint</option>
-																<option value="6">Sepia</option>
-														</select>
-												</div>
-												<div class="input-group" id="awb-group">
-														<label for="awb">AWB</label>
-														<div class="switch">
-																<input id="awb" type="checkbox" class="default-action" checked="checked">
-																<label class="slider" for="awb"></label>
-														</div>
-												</div>
-												<div class="input-group" id="awb_gain-group">
-														<label for="awb_gain">AWB Gain</label>
-														<div class="switch">
-																<input id="awb_gain" type="checkbox" class="default-action" checked="checked">
-																<label class="slider" for="awb_gain"></label>
-														</div>
-												</div>
-												<div class="input-group" id="wb_mode-group">
-														<label for="wb_mode">WB Mode</label>
-														<select id="wb_mode" class="default-action">
-																<option value="0" selected="selected">Auto</option>
-																<option value="1">Sunny</option>
-																<option value="2">Cloudy</option>
-																<option value="3">Office</option>
-																<option value="4">Home</option>
-														</select>
-												</div>
-												<div class="input-group" id="aec-group">
-														<label for="aec">AEC SENSOR</label>
-														<div class="switch">
-																<input id="aec" type="checkbox" class="default-action" checked="checked">
-																<label class="slider" for="aec"></label>
-														</div>
-												</div>
-												<div class="input-group" id="aec2-group">
-														<label for="aec2">AEC DSP</label>
-														<div class="switch">
-																<input id="aec2" type="checkbox" class="default-action" checked="checked">
-																<label class="slider" for="aec2"></label>
-														</div>
-												</div>
-												<div class="input-group" id="ae_level-group">
-														<label for="ae_level">AE Level</label>
-														<div class="range-min">-2</div>
-														<input type="range" id="ae_level" min="-2" max="2" value="0" class="default-action">
-														<div class="range-max">2</div>
-												</div>
-												<div class="input-group" id="aec_value-group">
-														<label for="aec_value">Exposure</label>
-														<div class="range-min">0</div>
-														<input type="range" id="aec_value" min="0" max="1200" value="204" class="default-action">
-														<div class="range-max">1200</div>
-												</div>
-												<div class="input-group" id="agc-group">
-														<label for="agc">AGC</label>
-														<div class="switch">
-																<input id="agc" type="checkbox" class="default-action" checked="checked">
-																<label class="slider" for="agc"></label>
-														</div>
-												</div>
-												<div class="input-group hidden" id="agc_gain-group">
-														<label for="agc_gain">Gain</label>
-														<div class="range-min">1x</div>
-														<input type="range" id="agc_gain" min="0" max="30" value="5" class="default-action">
-														<div class="range-max">31x</div>
-												</div>
-												<div class="input-group" id="gainceiling-group">
-														<label for="gainceiling">Gain Ceiling</label>
-														<div class="range-min">2x</div>
-														<input type="range" id="gainceiling" min="0" max="6" value="0" class="default-action">
-														<div class="range-max">128x</div>
-												</div>
-												<div class="input-group" id="bpc-group">
-														<label for="bpc">BPC</label>
-														<div class="switch">
-																<input id="bpc" type="checkbox" class="default-action">
-																<label class="slider" for="bpc"></label>
-														</div>
-												</div>
-												<div class="input-group" id="wpc-group">
-														<label for="wpc">WPC</label>
-														<div class="switch">
-																<input id="wpc" type="checkbox" class="default-action" checked="checked">
-																<label class="slider" for="wpc"></label>
-														</div>
-												</div>
-												<div class="input-group" id="raw_gma-group">
-														<label for="raw_gma">Raw GMA</label>
-														<div class="switch">
-																<input id="raw_gma" type="checkbox" class="default-action" checked="checked">
-																<label class="slider" for="raw_gma"></label>
-														</div>
-												</div>
-												<div class="input-group" id="lenc-group">
-														<label for="lenc">Lens Correction</label>
-														<div class="switch">
-																<input id="lenc" type="checkbox" class="default-action" checked="checked">
-																<label class="slider" for="lenc"></label>
-														</div>
-												</div>
-												<div class="input-group" id="hmirror-group">
-														<label for="hmirror">H-Mirror</label>
-														<div class="switch">
-																<input id="hmirror" type="checkbox" class="default-action" checked="checked">
-																<label class="slider" for="hmirror"></label>
-														</div>
-												</div>
-												<div class="input-group" id="vflip-group">
-														<label for="vflip">V-Flip</label>
-														<div class="switch">
-																<input id="vflip" type="checkbox" class="default-action" checked="checked">
-																<label class="slider" for="vflip"></label>
-														</div>
-												</div>
-												<div class="input-group" id="dcw-group">
-														<label for="dcw">DCW (Downsize EN)</label>
-														<div class="switch">
-																<input id="dcw" type="checkbox" class="default-action" checked="checked">
-																<label class="slider" for="dcw"></label>
-														</div>
-												</div>
-												<div class="input-group" id="colorbar-group">
-														<label for="colorbar">Color Bar</label>
-														<div class="switch">
-																<input id="colorbar" type="checkbox" class="default-action">
-																<label class="slider" for="colorbar"></label>
-														</div>
-												</div>											 
-												<section id="buttons">
-														<button id="get-still">Get Still</button>
-														<button id="toggle-stream">Start Stream</button>													
-												</section>
-										</nav>
-								</div>
-								<figure>
-										<div id="stream-container" class="image-container hidden">
-												<div class="close" id="close-stream">×</div>
-												<img id="stream" src="">
-										</div>
-								</figure>
-						</div>
-				</section>				
-				<script>
-			document.addEventListener('DOMContentLoaded', function () {
-					function b(B) {
-							let C;
-							switch (B.type) {
-							case 'checkbox':
-									C = B.checked ? 1 : 0;
-									break;
-							case 'range':
-							case 'select-one':
-									C = B.value;
-									break;
-							case 'button':
-							case 'submit':
-									C = '1';
-									break;
-							default:
-									return;
-							}
-							const D = `${c}/set?var=${B.id}&val=${C}`;
-							fetch(D).then(E => {
-									console.log(`request to ${D} finished, status: ${E.status}`)
-							})
-					}
-					var c = document.location.origin;
-					const e = B => {
-									B.classList.add('hidden')
-							},
-							f = B => {
-									B.classList.remove('hidden')
-							},
-							g = B => {
-									B.classList.add('disabled'), B.disabled = !0
-							},
-							h = B => {
-									B.classList.remove('disabled'), B.disabled = !1
-							},
-							i = (B, C, D) => {
-									D = !(null != D) || D;
-									let E;
-									'checkbox' === B.type ? (E = B.checked, C = !!C, B.checked = C) : (E = B.value, B.value = C), D && E !== C ? b(B) : !D && ('aec' === B.id ? C ? e(v) : f(v) : 'agc' === B.id ? C ? (f(t), e(s)) : (e(t), f(s)) : 'awb_gain' === B.id ? C ? f(x) : e(x) : 'face_recognize' === B.id && (C ? h(n) : g(n)))
-							};
-					document.querySelectorAll('.close').forEach(B => {
-							B.onclick = () => {
-									e(B.parentNode)
-							}
-					}), fetch('http://192.168.31.61/get?cachebuster=' + Date.now()).then(function (B) {
-							return B.json()
-					}).then(function (B) {
-							document.querySelectorAll('.default-action').forEach(C => {
-									i(C, B[C.id], !1)
-							});
-							setTimeout(function(){q();},500);
-					});
-					const j = document.getElementById('stream'),
-							k = document.getElementById('stream-container'),
-							l = document.getElementById('get-still'),
-							m = document.getElementById('toggle-stream'),
-							o = document.getElementById('close-stream'),
-							p = () => {
-									window.stop(), m.innerHTML = 'Start Stream'
-							},
-							q = () => {
-									j.src = `${c}/mjpeg/1`, f(k), m.innerHTML = 'Stop Stream'
-							};
-					l.onclick = () => {
-							p(), j.src = `${c}/jpg?_cb=${Date.now()}`, f(k)
-					}, o.onclick = () => {
-							p(), e(k)
-					}, m.onclick = () => {
-							const B = 'Stop Stream' === m.innerHTML;
-							B ? p() : q()
-					}, document.querySelectorAll('.default-action').forEach(B => {
-							B.onchange = () => b(B)
-					});
-					const r = document.getElementById('agc'),
-							s = document.getElementById('agc_gain-group'),
-							t = document.getElementById('gainceiling-group');
-					r.onchange = () => {
-							b(r), r.checked ? (f(t), e(s)) : (e(t), f(s))
-					};
-					const u = document.getElementById('aec'),
-							v = document.getElementById('aec_value-group');
-					u.onchange = () => {
-							b(u), u.checked ? e(v) : f(v)
-					};
-					const w = document.getElementById('awb_gain'),
-							x = document.getElementById('wb_mode-group');
-					w.onchange = () => {
-							b(w), w.checked ? f(x) : e(x)
-					};
-					const A = document.getElementById('framesize');
-					A.onchange = () => {
-							b(A), 5 < A.value && (i(y, !1), i(z, !1))
-					}
-			});
-		</script>
-		</body>
-</html>
-)rawliteral";
-//HTML-----------------------------------
-
-
 // ===== rtos task handles =========================
-// Streaming is implemented with 3 tasks:
+// Streaming is implemented with 6 tasks:
 TaskHandle_t tMjpeg;	 // handles client connections to the webserver
 TaskHandle_t tCam;		 // handles getting picture frames from the camera and storing them locally
 TaskHandle_t tStream;	// actually streaming frames to all connected clients
+TaskHandle_t tThumb;	// shrinks frames for the downscaled stream profiles
+TaskHandle_t tMotion;	// looks for motion in the frames
+TaskHandle_t tRecord;	// keeps the last seconds of frames for /clip
+
+// ===== task topology =========================
+// Every task has a role, and the role decides its priority and, through the topology, its core.
+// The topology is settable through /set and takes effect after a restart
+volatile int topology = TOPOLOGY_DEFAULT;
+
+void mjpegCB(void* pvParameters);
+
+struct PipelineTask {
+	const char*		name;
+	TaskFunction_t	fn;
+	uint32_t		stack;
+	task_role_t		role;
+	TaskHandle_t*	handle;
+	BusyTime		busy;		// time spent working rather than waiting, exported at /metrics
+	int				core;
+};
+
+// In the order they are started
+enum { TASK_MJPEG, TASK_CAM, TASK_STREAM, TASK_THUMB, TASK_MOTION, TASK_RECORD, TASK_COUNT };
+PipelineTask tasks[TASK_COUNT] = {
+//	  name		fn			stack		role				handle
+	{ "mjpeg",	mjpegCB,	4 * 1024,	ROLE_HTTP,			&tMjpeg },
+	{ "cam",	camCB,		4 * 1024,	ROLE_CAPTURE,		&tCam },
+	{ "stream",	streamCB,	4 * 1024,	ROLE_STREAM,		&tStream },
+	{ "thumb",	thumbCB,	4 * 1024,	ROLE_BACKGROUND,	&tThumb },
+	{ "motion",	motionCB,	4 * 1024,	ROLE_BACKGROUND,	&tMotion },
+	{ "record",	recordCB,	3 * 1024,	ROLE_BACKGROUND,	&tRecord },
+};
+
+// ==== Start a task on the core and at the priority its role calls for ================
+void startTask(int i) {
+	PipelineTask& t = tasks[i];
+	t.core = topologyCore(topology, t.role);
+	xTaskCreatePinnedToCore(t.fn, t.name, t.stack, NULL, rolePriority[t.role], t.handle, t.core);
+}
 
-// frameSync semaphore is used to prevent streaming buffer as it is replaced with the next frame
-SemaphoreHandle_t frameSync = NULL;
-
-// Queue stores currently connected clients to whom we are streaming
-QueueHandle_t streamingClients;
-
-// We will try to achieve 25 FPS frame rate
-const int FPS = 14;
-
-// We will handle web client requests every 50 ms (20 Hz)
-const int WSINTERVAL = 100;
+// camFrame hands the newest frame from the camera to the streaming clients without any locking
+FrameExchange camFrame;
+
+// thumbFrame does the same for the thumbnails
+FrameExchange thumbFrame;
+
+// Streams on offer, each at its own URL
+StreamProfile profiles[] = {
+//	  name		uri			fps	decimation	scale	frames
+	{ "main",	"/mjpeg/1",	0,	1,			1,		&camFrame },	// full rate, full size
+	{ "thumb",	"/mjpeg/2",	2,	1,			4,		&thumbFrame },	// low rate thumbnails for dashboards
+};
+const int profileCount = sizeof(profiles) / sizeof(profiles[0]);
+
+// All clients we are streaming to, over all profiles. Every one holds a socket, and lwIP has
+// CONFIG_LWIP_MAX_SOCKETS of them (16 in the Arduino core, which comes prebuilt) for everything:
+// the web server's listener, its HTTP_MAX_CONNECTIONS connections and HTTP_MAX_PUMPS clip
+// downloads and the EVENTS_MAX_SUBSCRIBERS settings pages come first. Those are kept few, so
+// the 10 viewers the stream has always taken still fit. The registry gets a slot for every
+// socket left, and its limit is settable through /set as max_clients up to that
+#ifdef CONFIG_LWIP_MAX_SOCKETS
+#define STREAM_SOCKETS (CONFIG_LWIP_MAX_SOCKETS - 1 - HTTP_MAX_CONNECTIONS - HTTP_MAX_PUMPS - EVENTS_MAX_SUBSCRIBERS)
+#else
+#define STREAM_SOCKETS REGISTRY_DEFAULT_LIMIT
+#endif
+#if STREAM_SOCKETS < REGISTRY_DEFAULT_LIMIT
+#error "The web server leaves fewer sockets than REGISTRY_DEFAULT_LIMIT viewers need"
+#endif
+ClientRegistry registry(STREAM_SOCKETS);
+
+// Paces capture and streaming from measured capture times, frame sizes and client speeds.
+// Target frame rate and latency ceiling are settable through /set
+Pacer pacer;
+
+// Trades JPEG quality (and frame size as a last resort) for the bandwidth the clients actually get
+QualityController qualityCtl;
+
+// Pushes setting changes and stats to open settings pages, so they don't have to poll
+EventStream events;
+
+// Motion detection, settable through /set as motion:
+//	0 - off
+//	1 - look for motion and report it at /motion
+//	2 - the same, and streams idle at 1 FPS until something moves
+MotionDetector motion;
+volatile int motionMode = 0;
+
+// Drop frames that are byte for byte the same as the one before (a still scene in low
+// light, a covered lens), so no client spends airtime on them. Settable through /set as dedup
+volatile bool dedup = false;
+
+// The last few seconds of frames, for /clip. Its size in KB is settable through /set as
+// clip_kb and takes effect after a restart; 0, the default, leaves it off. While it is on
+// the camera keeps running with nobody watching, or there would be nothing to look back at
+FrameRing ring;
+volatile int clipKb = 0;
+
+// What the camera hands over, settable through /set as pixformat and taking effect after
+// a restart. Raw frames are encoded here, and the stages that look at the picture read
+// their pixels instead of decoding JPEG:
+//	0 - JPEG from the sensor
+//	1 - YUV422, encoded here
+//	2 - grayscale, encoded here
+//	3 - RGB565, turned into grayscale on arrival and encoded here
+const pixformat_t pixFormats[] = { PIXFORMAT_JPEG, PIXFORMAT_YUV422, PIXFORMAT_GRAYSCALE, PIXFORMAT_RGB565 };
+const int pixFormatCount = sizeof(pixFormats) / sizeof(pixFormats[0]);
+volatile int pixFormat = 0;
+
+// Raw frames take 2 bytes a pixel in the driver's buffers, so raw capture runs at SVGA at most
+const framesize_t RAW_FRAMESIZE = FRAMESIZE_SVGA;
+
+// ===== pipeline metrics, exported at /metrics ======
+// All of them are lock-free; the tasks only ever add to or set them
+Histogram captureMs;		// time spent in esp_camera_fb_get()
+Counter framesCaptured;
+Counter framesDropped;		// the camera returned nothing or no frame slot was free
+Counter framesDuplicate;	// frames identical to the one before, not published
+Counter framesSkipped;		// frames clients moved past without sending them
+Counter streamBytes;
+Counter streamStallMs;		// time client sockets were full
+Counter streamWaitMs;		// time the streaming task slept waiting for frames or due clients
+Counter thumbsDropped;		// thumbnails that could not be decoded or did not fit their buffer
+Histogram encodeMs;			// time spent encoding a raw frame
+Counter encodesDropped;		// raw frames that found no free buffer or did not fit it
+Gauge clientRates[STREAM_SOCKETS];	// drain rate of every connected client, in slot order
+Gauge clientCount;
+
+// ===== runtime settings, changed through /set and kept in NVS ======
+// Sensor settings map straight onto a sensor_t setter and the matching status field
+#define SENSOR_SETTING(name, lo, hi, setter, field, type) \
+	{ name, lo, hi, \
+	  [](int v) { sensor_t* s = esp_camera_sensor_get(); s->setter(s, (type) v); }, \
+	  []() { return (int) esp_camera_sensor_get()->status.field; } }
+
+const Setting settingTable[] = {
+//	  name				min		max				apply / current
+	{ "framesize",		0,		FRAMESIZE_UXGA,
+	  [](int v) {
+		sensor_t* s = esp_camera_sensor_get();
+		//	Raw frames can't outgrow the buffers allocated for them at boot
+		if ( s->pixformat != PIXFORMAT_JPEG && v > RAW_FRAMESIZE ) v = RAW_FRAMESIZE;
+		s->set_framesize(s, (framesize_t) v);
+		qualityCtl.setFramesize((framesize_t) v); },
+	  []() { return (int) esp_camera_sensor_get()->status.framesize; } },
+	{ "quality",		0,		63,		// higher is better, the sensor counts the other way
+	  [](int v) {
+		sensor_t* s = esp_camera_sensor_get();
+		s->set_quality(s, 63 - v);
+		qualityCtl.setQuality(v); },
+	  []() { return 63 - esp_camera_sensor_get()->status.quality; } },
+	SENSOR_SETTING( "contrast",		-2,		2,		set_contrast,		contrast,		int ),
+	SENSOR_SETTING( "brightness",	-2,		2,		set_brightness,		brightness,		int ),
+	SENSOR_SETTING( "saturation",	-2,		2,		set_saturation,		saturation,		int ),
+	SENSOR_SETTING( "gainceiling",	0,		6,		set_gainceiling,	gainceiling,	gainceiling_t ),
+	SENSOR_SETTING( "colorbar",		0,		1,		set_colorbar,		colorbar,		int ),
+	SENSOR_SETTING( "awb",			0,		1,		set_whitebal,		awb,			int ),
+	SENSOR_SETTING( "agc",			0,		1,		set_gain_ctrl,		agc,			int ),
+	SENSOR_SETTING( "aec",			0,		1,		set_exposure_ctrl,	aec,			int ),
+	SENSOR_SETTING( "hmirror",		0,		1,		set_hmirror,		hmirror,		int ),
+	SENSOR_SETTING( "vflip",		0,		1,		set_vflip,			vflip,			int ),
+	SENSOR_SETTING( "awb_gain",		0,		1,		set_awb_gain,		awb_gain,		int ),
+	SENSOR_SETTING( "agc_gain",		0,		30,		set_agc_gain,		agc_gain,		int ),
+	SENSOR_SETTING( "aec_value",	0,		1200,	set_aec_value,		aec_value,		int ),
+	SENSOR_SETTING( "aec2",			0,		1,		set_aec2,			aec2,			int ),
+	SENSOR_SETTING( "dcw",			0,		1,		set_dcw,			dcw,			int ),
+	SENSOR_SETTING( "bpc",			0,		1,		set_bpc,			bpc,			int ),
+	SENSOR_SETTING( "wpc",			0,		1,		set_wpc,			wpc,			int ),
+	SENSOR_SETTING( "raw_gma",		0,		1,		set_raw_gma,		raw_gma,		int ),
+	SENSOR_SETTING( "lenc",			0,		1,		set_lenc,			lenc,			int ),
+	SENSOR_SETTING( "special_effect", 0,	6,		set_special_effect,	special_effect,	int ),
+	SENSOR_SETTING( "wb_mode",		0,		4,		set_wb_mode,		wb_mode,		int ),
+	SENSOR_SETTING( "ae_level",		-2,		2,		set_ae_level,		ae_level,		int ),
+	{ "fps",			1,		60,
+	  [](int v) { pacer.setTargetFps(v); },
+	  []() { return (int) pacer.getTargetFps(); } },
+	{ "max_latency",	50,		10000,
+	  [](int v) { pacer.setMaxLatency(v); },
+	  []() { return (int) pacer.getMaxLatency(); } },
+	{ "auto_quality",	0,		1,
+	  [](int v) { qualityCtl.setEnabled(v); },
+	  []() { return qualityCtl.isEnabled() ? 1 : 0; } },
+	{ "quality_min",	0,		63,
+	  [](int v) { qualityCtl.setBounds(v, qualityCtl.getQualityMax()); },
+	  []() { return qualityCtl.getQualityMin(); } },
+	{ "quality_max",	0,		63,
+	  [](int v) { qualityCtl.setBounds(qualityCtl.getQualityMin(), v); },
+	  []() { return qualityCtl.getQualityMax(); } },
+	{ "bitrate",		0,		100000,	// kbit/s cap, 0 for none
+	  [](int v) { qualityCtl.setBitrate(v); },
+	  []() { return (int) qualityCtl.getBitrate(); } },
+	{ "max_clients",	1,		STREAM_SOCKETS,
+	  [](int v) { registry.setLimit(v); },
+	  []() { return registry.getLimit(); } },
+	{ "motion",			0,		2,
+	  [](int v) {
+		motionMode = v;
+		if ( v < 2 ) pacer.setIdle(false);
+		//	The camera has to keep running to see anything move, viewers or not
+		if ( v && tCam && eTaskGetState( tCam ) == eSuspended ) vTaskResume( tCam ); },
+	  []() { return (int) motionMode; } },
+	{ "motion_thresh",	1,		255,
+	  [](int v) { motion.setThreshold(v); },
+	  []() { return motion.getThreshold(); } },
+	{ "dedup",			0,		1,
+	  [](int v) { dedup = v; },
+	  []() { return dedup ? 1 : 0; } },
+	{ "clip_kb",		0,		3072,
+	  [](int v) { clipKb = v; },
+	  []() { return (int) clipKb; } },
+	{ "topology",		0,		TOPOLOGY_COUNT - 1,
+	  [](int v) { topology = v; },
+	  []() { return (int) topology; } },
+	{ "pixformat",		0,		pixFormatCount - 1,
+	  [](int v) { pixFormat = v; },
+	  []() { return (int) pixFormat; } },
+};
+const int settingCount = sizeof(settingTable) / sizeof(settingTable[0]);
 
 // ======== Server Connection Handler Task ==========================
 void mjpegCB(void* pvParameters) {
-	TickType_t xLastWakeTime;
-	const TickType_t xFrequency = pdMS_TO_TICKS(WSINTERVAL);
-
-	// Creating frame synchronization semaphore and initializing it
-	frameSync = xSemaphoreCreateBinary();
-	xSemaphoreGive( frameSync );
-
-	// Creating a queue to track all connected clients
-	streamingClients = xQueueCreate( 10, sizeof(WiFiClient*) );
-
 	//=== setup section	==================
 
-	//	Creating RTOS task for grabbing frames from the camera
-	xTaskCreatePinnedToCore(
-		camCB,				// callback
-		"cam",				// name
-		4096,				// stacj size
-		NULL,				// parameters
-		2,					// priority
-		&tCam,				// RTOS task handle
-		APP_CPU);			// core
-
-	//	Creating task to push the stream to all connected clients
-	xTaskCreatePinnedToCore(
-		streamCB,
-		"strmCB",
-		4 * 1024,
-		NULL, //(void*) handler,
-		2,
-		&tStream,
-		APP_CPU);
+	//	Creating the pipeline tasks: grabbing frames from the camera, pushing the stream to all
+	//	connected clients, shrinking frames for the thumbnail streams and looking for motion.
+	//	Copying frames into the clip ring only if the ring is on
+	for ( int i = TASK_CAM; i < TASK_COUNT; i++ ) {
+		if ( i == TASK_RECORD && !ring.getBudget() ) continue;
+		startTask(i);
+	}
 
 	//	Registering webserver handling routines
-	server.on("/mjpeg/1", HTTP_GET, handleJPGSstream);
-	server.on("/jpg", HTTP_GET, handleJPG);
-	server.on("/get", HTTP_GET, get_handler);
-	server.on("/set", HTTP_GET, set_handler);
-
-	server.on("/control", HTTP_GET, control3_handler);
-	server.on("/restart", HTTP_GET, restart_handler);
-	server.on("/activatewebota", HTTP_GET, activatewebota_handler);
-	server.on("/reset", HTTP_GET, reset_handler);
+	for ( int i = 0; i < profileCount; i++ )
+		server.on(profiles[i].uri, HTTP_METHOD_GET, handleJPGSstream);
+	server.on("/jpg", HTTP_METHOD_GET, handleJPG);
+	server.on("/get", HTTP_METHOD_GET, get_handler);
+	server.on("/set", HTTP_METHOD_GET, set_handler);
+	server.on("/set", HTTP_METHOD_POST, set_handler);
+	server.on("/metrics", HTTP_METHOD_GET, metrics_handler);
+	server.on("/motion", HTTP_METHOD_GET, motion_handler);
+	server.on("/clip", HTTP_METHOD_GET, clip_handler);
+	server.on("/events", HTTP_METHOD_GET, events_handler);
+
+	server.on("/control", HTTP_METHOD_GET, control3_handler);
+	server.on(INDEX_HTML_PATH, HTTP_METHOD_GET, index_handler);
+	server.on("/restart", HTTP_METHOD_GET, restart_handler);
+	server.on("/activatewebota", HTTP_METHOD_GET, activatewebota_handler);
+	server.on("/reset", HTTP_METHOD_GET, reset_handler);
 	server.onNotFound(handleNotFound);
 
 	//	Starting webserver
 	server.begin();
 
 	//=== loop() section	===================
-	xLastWakeTime = xTaskGetTickCount();
+	//	No polling: the server sleeps in select() until a connection or request
+	//	comes in and serves it right away
 	for (;;) {
+		uint32_t t = micros();
+		uint32_t waited = server.getWaitMs();
 		server.handleClient();
+		t = micros() - t;
+		waited = (server.getWaitMs() - waited) * 1000;
+		tasks[TASK_MJPEG].busy.add(t > waited ? t - waited : 0);
+	}
+}
+
+
+// ==== RAW CAPTURE ======================================================
+// Encodes raw camera frames: fixed-point DCT and table-driven Huffman coding
+JpegEncoder encoder;
+int encoderQuality = 0;	// what the encoder's tables were last built for
+
+// Encoded frames live in fixed buffers allocated once at startup, like the thumbnails
+BufferPool rawPool;
+
+// Buffers: one being encoded, the published one and two still being sent
+const int RAW_BUFFERS = 4;
+
+// The newest raw frame, for the stages that read pixels. It holds on to a driver buffer
+FrameExchange rawFrame;
+
+// Encoded frames share their buffer with their camera_fb_t, so returning that returns both
+void freeRaw(camera_fb_t* fb) {
+	rawPool.release((uint8_t*) fb);
+}
+
+// RGB565 frames are boiled down to their luma as soon as they arrive, which hands the
+// driver buffer straight back. From there on they are grayscale frames
+BufferPool lumaPool;
+
+// Buffers: the published one, one being made and one the motion task may still be reading
+const int LUMA_BUFFERS = 3;
 
-		//	After every server client handling request, we let other tasks run and then pause
-		taskYIELD();
-		vTaskDelayUntil(&xLastWakeTime, xFrequency);
+void freeLuma(camera_fb_t* fb) {
+	lumaPool.release((uint8_t*) fb);
+}
+
+// ==== Turn an RGB565 camera frame into a grayscale one, releasing the source ============
+Frame* toLuma(Frame* src) {
+	uint8_t* slab = lumaPool.acquire();
+	if ( slab == NULL ) {
+		encodesDropped.add();
+		src->release();
+		return NULL;
 	}
+
+	camera_fb_t* fb = (camera_fb_t*) slab;
+	memset(fb, 0, sizeof(camera_fb_t));
+	fb->buf = (uint8_t*) (fb + 1);
+	fb->width = src->getWidth();
+	fb->height = src->getHeight();
+	fb->len = fb->width * fb->height;
+	fb->format = PIXFORMAT_GRAYSCALE;
+	fb->timestamp = src->getTimestamp();
+	rgb565ToY8(src->getBuf(), fb->buf, fb->len);
+	src->release();
+	return Frame::wrap(fb, freeLuma);
 }
 
+// ==== Encode a raw camera frame into a JPEG frame ========================
+Frame* encodeRaw(Frame* src) {
+	//	No free buffer means the clients are still busy with earlier frames - skip this one
+	uint8_t* slab = rawPool.acquire();
+	if ( slab == NULL ) {
+		encodesDropped.add();
+		return NULL;
+	}
 
-// Commonly used variables:
-volatile size_t camSize;		// size of the current frame, byte
-volatile char* camBuf;			// pointer to the current frame
+	camera_fb_t* fb = (camera_fb_t*) slab;
+	size_t capacity = rawPool.getSize() - sizeof(camera_fb_t);
 
+	//	The quality setting counts 0..63, the encoder 1..JPEG_QUALITY_CEILING. Tables are only
+	//	rebuilt on a change, which the quality controller makes at most once a second or when
+	//	a frame didn't fit
+	int quality = JpegEncoder::qualityFor(qualityCtl.getQuality());
+	if ( quality != encoderQuality ) {
+		encoder.setQuality(quality);
+		encoderQuality = quality;
+	}
+
+	memset(fb, 0, sizeof(camera_fb_t));
+	fb->buf = (uint8_t*) (fb + 1);
+	uint32_t t = micros();
+	if ( src->getFormat() == PIXFORMAT_GRAYSCALE )
+		fb->len = encoder.encodeGray(src->getBuf(), src->getWidth(), src->getHeight(), fb->buf, capacity);
+	else
+		fb->len = encoder.encodeYuv422(src->getBuf(), src->getWidth(), src->getHeight(), fb->buf, capacity);
+	encodeMs.observe((micros() - t) / 1000);
+	fb->width = src->getWidth();
+	fb->height = src->getHeight();
+	fb->format = PIXFORMAT_JPEG;
+	fb->timestamp = src->getTimestamp();
+
+	//	The frame didn't fit - drop it, and have the next one come out smaller
+	if ( fb->len == 0 ) {
+		encodesDropped.add();
+		qualityCtl.overflow(esp_camera_sensor_get());
+		rawPool.release(slab);
+		return NULL;
+	}
+	return Frame::wrap(fb, freeRaw);
+}
 
 // ==== RTOS task to grab frames from the camera =========================
 void camCB(void* pvParameters) {
 
 	TickType_t xLastWakeTime;
-
-	//	A running interval associated with currently desired frame rate
-	const TickType_t xFrequency = pdMS_TO_TICKS(1000 / FPS);
-
-	// Mutex for the critical section of swithing the active frames around
-	portMUX_TYPE xSemaphore = portMUX_INITIALIZER_UNLOCKED;
-
-	//	Pointers to the 2 frames, their respective sizes and index of the current frame
-	char* fbs[2] = { NULL, NULL };
-	size_t fSize[2] = { 0, 0 };
-	int ifb = 0;
+	uint32_t lastHash = 0;
+	uint32_t busy = 0;
 
 	//=== loop() section	===================
 	xLastWakeTime = xTaskGetTickCount();
 
 	for (;;) {
 
-		//	Grab a frame from the camera and query its size
+		//	Grab a frame from the camera and take the driver buffer over. Clients send
+		//	straight out of it; the driver gets it back once the last of them is done
+		uint32_t t = millis();
+		if ( busy == 0 ) busy = micros();
 		cam.run();
-		size_t s = cam.getSize();
-
-		//	If frame size is more that we have previously allocated - request	125% of the current frame space
-		if (s > fSize[ifb]) {
-			fSize[ifb] = s * 4 / 3;
-			fbs[ifb] = allocateMemory(fbs[ifb], fSize[ifb]);
+		Frame* f = Frame::wrap(cam.detach());
+
+		//	A raw frame goes to the stages that read pixels, and its JPEG on down the
+		//	pipeline like a frame from the sensor
+		if ( f && f->getFormat() == PIXFORMAT_RGB565 ) f = toLuma(f);
+		if ( f && f->getFormat() != PIXFORMAT_JPEG ) {
+			Frame* raw = f;
+			f = encodeRaw(raw);
+			rawFrame.publish(raw);
+		}
+		t = millis() - t;
+		captureMs.observe(t);
+		if ( f ) {
+			framesCaptured.add();
+			pacer.onCapture(t, f->getSize());
+
+			//	Keep frames within what the link carries at the target frame rate
+			qualityCtl.update(esp_camera_sensor_get(), pacer.getFrameBytes(), pacer.getTargetFps(), pacer.getDrainRate());
 		}
 
-		//	Copy current frame into local buffer
-		char* b = (char*) cam.getfb();
-		memcpy(fbs[ifb], b, s);
-
-		//	Let other tasks run and wait until the end of the current frame rate interval (if any time left)
-		taskYIELD();
-		vTaskDelayUntil(&xLastWakeTime, xFrequency);
-
-		//	Only switch frames around if no frame is currently being streamed to a client
-		//	Wait on a semaphore until client operation completes
-		xSemaphoreTake( frameSync, portMAX_DELAY );
+		//	Wait until the end of the current capture interval (if any time left). The pacer
+		//	works the interval out from the target frame rate and how fast the clients are.
+		//	The work goes into the busy time, the wait doesn't
+		tasks[TASK_CAM].busy.add(micros() - busy);
+		vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(pacer.captureInterval()));
+		busy = micros();
+
+		//	The camera returned nothing or all frames are still in use - try again next interval
+		if ( f == NULL ) {
+			framesDropped.add();
+			continue;
+		}
 
-		//	Do not allow interrupts while switching the current frame
-		portENTER_CRITICAL(&xSemaphore);
-		camBuf = fbs[ifb];
-		camSize = s;
-		ifb++;
-		ifb &= 1;	// this should produce 1, 0, 1, 0, 1 ... sequence
-		portEXIT_CRITICAL(&xSemaphore);
+		//	Clients only ever start frames with a newer sequence number than their last one, so
+		//	not publishing a repeat is all it takes for none of them to send it again
+		if ( dedup ) {
+			uint32_t h = f->hash();
+			if ( h == lastHash ) {
+				framesDuplicate.add();
+				f->release();
+				continue;
+			}
+			lastHash = h;
+		}
 
-		//	Let anyone waiting for a frame know that the frame is ready
-		xSemaphoreGive( frameSync );
+		//	Make this the newest frame. Never waits on the clients: whoever is still
+		//	sending the previous frame keeps it alive with a reference of its own
+		for ( int p = 0; p < profileCount; p++ )
+			if ( profiles[p].frames == &camFrame ) profiles[p].onFrame(f->getSize());
+		camFrame.publish(f);
 
-		//	Technically only needed once: let the streaming task know that we have at least one frame
-		//	and it could start sending frames to the clients, if any
+		//	Let the streaming task know that there is a new frame it could start sending
+		//	to the clients, if any. This also wakes it up from waiting for the next frame
 		xTaskNotifyGive( tStream );
-
-		//	Immediately let other (streaming) tasks run
-		taskYIELD();
+		xTaskNotifyGive( tThumb );
+		xTaskNotifyGive( tMotion );
+		if ( tRecord ) xTaskNotifyGive( tRecord );
+		xTaskNotifyGive( tMjpeg );	// for a snapshot waiting on a fresh frame
 
 		//	If streaming task has suspended itself (no active clients to stream to)
 		//	there is no need to grab frames from the camera. We can save some juice
-		//	by suspedning the tasks
-		if ( eTaskGetState( tStream ) == eSuspended ) {
+		//	by suspedning the tasks. Unless we are looking for motion or recording, which need the frames
+		if ( eTaskGetState( tStream ) == eSuspended && !motionMode && !ring.getBudget() ) {
+			tasks[TASK_CAM].busy.add(micros() - busy);
 			vTaskSuspend(NULL);	// passing NULL means "suspend yourself"
+			busy = 0;
 		}
 	}
 }
 
 
-// ==== Memory allocator that takes advantage of PSRAM if present =======================
-char* allocateMemory(char* aPtr, size_t aSize) {
+// ==== STREAMING ======================================================
+// ==== Handle connection request from clients ===============================
+void handleJPGSstream(void)
+{
+	//	Find the profile this client asked for
+	int p = -1;
+	for ( int i = 0; i < profileCount; i++ )
+		if ( strcmp(server.uri(), profiles[i].uri) == 0 ) p = i;
+	if ( p < 0 ) return;
+
+	//	At the limit a client that has been stalled for a while gives up its place. If nobody
+	//	has, tell the new one to come back later rather than leaving it hanging
+	if ( !registry.admit() ) {
+		server.sendHeader("Retry-After", "5");
+		server.send(503, "text/plain", "Too many clients");
+		return;
+	}
+
+	//	Create a new stream client to keep track of this one. It takes the connection
+	//	over from the server; the streaming task sends it the header along with its first frame
+	int sock = server.detach();
+	StreamClient* client = new StreamClient(sock);
+	if ( !registry.add(client, p) ) {
+		//	All slots still taken: the client admit() evicted hasn't been deleted yet. The
+		//	server has let go of the socket by now, so the 503 goes straight into it
+		static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 5\r\n"
+			"Content-Type: text/plain\r\nContent-Length: 16\r\nConnection: close\r\n\r\nToo many clients";
+		send(sock, busy, sizeof(busy) - 1, MSG_DONTWAIT);
+		delete client;
+		return;
+	}
+
+	// Wake up streaming tasks, if they were previously suspended:
+	if ( eTaskGetState( tCam ) == eSuspended ) vTaskResume( tCam );
+	if ( eTaskGetState( tStream ) == eSuspended ) vTaskResume( tStream );
+}
 
-	//	Since current buffer is too smal, free it
-	if (aPtr != NULL) free(aPtr);
 
+// ==== Actually stream content to all connected clients ========================
+void streamCB(void * pvParameters) {
+	//	Wait until the first frame is captured and there is something to send
+	//	to clients
+	ulTaskNotifyTake( pdTRUE,					/* Clear the notification value before exiting. */
+										portMAX_DELAY ); /* Block indefinitely. */
 
-	size_t freeHeap = ESP.getFreeHeap();
-	char* ptr = NULL;
+	bool wasIdle = false;
 
-	// If memory requested is more than 2/3 of the currently free heap, try PSRAM immediately
-	if ( aSize > freeHeap * 2 / 3 ) {
-		if ( psramFound() && ESP.getFreePsram() > aSize ) {
-			ptr = (char*) ps_malloc(aSize);
+	for (;;) {
+		//	Only bother to send anything if there is someone watching
+		if ( !registry.count() ) {
+			//	Since there are no connected clients, there is no reason to waste battery running
+			vTaskSuspend(NULL);
+			continue;
 		}
-	}
-	else {
-		//	Enough free heap - let's try allocating fast RAM as a buffer
-		ptr = (char*) malloc(aSize);
 
-		//	If allocation on the heap failed, let's give PSRAM one more chance:
-		if ( ptr == NULL && psramFound() && ESP.getFreePsram() > aSize) {
-			ptr = (char*) ps_malloc(aSize);
-		}
-	}
+		uint32_t now = millis();
+		uint32_t pass = micros();
+
+		//	When something starts moving, clients idling at 1 FPS get the next frame right away
+		bool idle = pacer.isIdle();
+		bool wake = wasIdle && !idle;
+		wasIdle = idle;
+
+		//	Unless a client becomes due earlier, sleep until the next frame
+		uint32_t wait = pacer.captureInterval();
+		uint32_t fastest = UINT32_MAX, slowest = 0, slowRate = 0;
+
+		//	Take a reference on the newest frame of every profile for this pass. Thumbnail
+		//	profiles may not have one yet
+		Frame* frames[profileCount];
+		for ( int p = 0; p < profileCount; p++ )
+			frames[p] = profiles[p].frames->acquire();
+
+		//	Give every client one pass, in place. Nobody waits on a socket: each client only
+		//	pushes what its socket takes right now and picks up where it left off next pass
+		bool busy = false;
+		fd_set full;
+		FD_ZERO(&full);
+		int maxSock = -1;
+		int n = 0;
+		for ( int i = 0; i < registry.getSlots(); i++ ) {
+			StreamClient* client = registry.get(i);
+			if ( client == NULL ) continue;
+
+			//	Drop clients that have disconnected, that have been stalled for far too long,
+			//	or that the server picked to make room for a new one. Bye!
+			uint32_t stalled = client->stalledFor(now);
+			if ( !client->connected() || stalled > REGISTRY_DROP_STALL || registry.evicting(i) ) {
+				registry.remove(i);
+				delete client;
+				continue;
+			}
+			registry.setStall(i, stalled);
+
+			StreamProfile& profile = profiles[registry.getProfile(i)];
+			Frame* f = frames[registry.getProfile(i)];
+			if ( wake ) client->hurry(now);
+
+			//	A client that is done with its frame and due for the next one moves on to the
+			//	newest, whatever it missed in between. The pacer spaces its frames out to
+			//	how fast it drains the profile's frames and the profile's rate, so slow clients
+			//	skip frames instead of queueing them. Decimated profiles wait for enough new frames
+			if ( f && client->ready(now) && f->getSeq() - client->lastSeq() >= (uint32_t) profile.decimation ) {
+				if ( client->lastSeq() ) framesSkipped.add(f->getSeq() - client->lastSeq() - 1);
+				client->start(f, pacer.clientPeriod(client->getDrainRate(), profile.fps, profile.frameBytes));
+			}
 
-	// Finally, if the memory pointer is NULL, we were not able to allocate any memory, and that is a terminal condition.
-	if (ptr == NULL) {
-		ESP.restart();
-	}
-	return ptr;
-}
+			if ( client->pump() ) {
+				busy = true;
+				FD_SET(client->getSocket(), &full);
+				if ( client->getSocket() > maxSock ) maxSock = client->getSocket();
+			}
 
+			uint32_t bytes;
+			client->collect(bytes, stalled);
+			if ( bytes ) streamBytes.add(bytes);
+			if ( stalled ) streamStallMs.add(stalled);
 
-// ==== STREAMING ======================================================
-const char HEADER[] = "HTTP/1.1 200 OK\r\n" \
-					  "Access-Control-Allow-Origin: *\r\n" \
-					  "Content-Type: multipart/x-mixed-replace; boundary=123456789000000000000987654321\r\n";
-const char BOUNDARY[] = "\r\n--123456789000000000000987654321\r\n";
-const char CTNTTYPE[] = "Content-Type: image/jpeg\r\nContent-Length: ";
-const int hdrLen = strlen(HEADER);
-const int bdrLen = strlen(BOUNDARY);
-const int cntLen = strlen(CTNTTYPE);
+			//	Make sure to wake up in time for an idle client's next frame
+			if ( client->idle() && !client->ready(now) && client->getDue() - now < wait )
+				wait = client->getDue() - now;
 
+			uint32_t period = client->getPeriod();
+			if ( period < fastest ) fastest = period;
+			if ( period > slowest ) slowest = period;
 
-// ==== Handle connection request from clients ===============================
-void handleJPGSstream(void)
-{
-	//	Can only acommodate 10 clients. The limit is a default for WiFi connections
-	if ( !uxQueueSpacesAvailable(streamingClients) ) return;
+			//	Only clients of full size frames tell the quality controller how big the camera's
+			//	frames can be; thumbnails come out at a fraction of that whatever it sets
+			uint32_t rate = client->getDrainRate();
+			if ( rate && profile.scale == 1 && ( slowRate == 0 || rate < slowRate ) ) slowRate = rate;
+			clientRates[n++].set(rate);
+		}
+		for ( int p = 0; p < profileCount; p++ )
+			if ( frames[p] ) frames[p]->release();
+		pacer.onClients(slowest ? fastest : 0, slowest, slowRate);
+		clientCount.set(n);
+
+		//	If some socket was full sleep until one of them takes data again, but no longer than
+		//	until the next frame or client is due. Otherwise sleep until a client becomes due or
+		//	camCB lets us know there is a new frame
+		uint32_t slept = millis();
+		tasks[TASK_STREAM].busy.add(micros() - pass);
+		if ( busy ) {
+			struct timeval tv = { 0, (long) ( wait ? wait : 1 ) * 1000 };
+			select( maxSock + 1, NULL, &full, NULL, &tv );
+			ulTaskNotifyTake( pdTRUE, 0 );	//	whatever frame came meanwhile is picked up now
+		}
+		else ulTaskNotifyTake( pdTRUE, pdMS_TO_TICKS(wait) );
+		streamWaitMs.add(millis() - slept);
+	}
+}
 
+// ==== THUMBNAILS ======================================================
+// Shrinks frames in the JPEG domain, without decoding them to full size
+JpegScaler scaler;
 
-	//	Create a new WiFi Client object to keep track of this one
-	WiFiClient* client = new WiFiClient();
-	*client = server.client();
+// Grayscale captures have their pixels at hand: thumbnails are boxed down from those and
+// encoded here, which is cheaper than decoding the JPEG just made from them
+JpegEncoder thumbEncoder;
+int thumbQuality = 0;		// what the thumbnail encoder's tables were last built for
+uint8_t* thumbLuma = NULL;	// the shrunk picture before encoding, only there for grayscale captures
 
-	//	Immediately send this client a header
-	client->write(HEADER, hdrLen);
-	client->write(BOUNDARY, bdrLen);
+// Thumbnails live in fixed buffers allocated once at startup, so however their sizes vary
+// over days of uptime they never fragment the heap
+BufferPool thumbPool;
 
-	// Push the client to the streaming queue
-	xQueueSend(streamingClients, (void *) &client, 0);
+// Buffers per downscaled profile: one being made, the published one and two still being sent
+const int THUMB_BUFFERS = 4;
 
-	// Wake up streaming tasks, if they were previously suspended:
-	if ( eTaskGetState( tCam ) == eSuspended ) vTaskResume( tCam );
-	if ( eTaskGetState( tStream ) == eSuspended ) vTaskResume( tStream );
+// Thumbnails share their buffer with their camera_fb_t, so returning that returns both
+void freeThumb(camera_fb_t* fb) {
+	thumbPool.release((uint8_t*) fb);
 }
 
+// ==== Size the thumbnail pool for the largest thumbnail the camera can produce ============
+void setupThumbPool(framesize_t framesize, pixformat_t format, int quality) {
+	int scale = 0, scaled = 0;
+	for ( int i = 0; i < profileCount; i++ ) {
+		if ( profiles[i].scale < 2 ) continue;
+		if ( scale == 0 || profiles[i].scale < scale ) scale = profiles[i].scale;
+		scaled++;
+	}
+	if ( scaled == 0 ) return;
 
-// ==== Actually stream content to all connected clients ========================
-void streamCB(void * pvParameters) {
-	char buf[16];
-	TickType_t xLastWakeTime;
-	TickType_t xFrequency;
+	size_t size = sizeof(camera_fb_t) + BufferPool::jpegBudget(resolution[framesize].width / scale, resolution[framesize].height / scale, quality);
+	if ( !thumbPool.begin(size, scaled * THUMB_BUFFERS) )
+		Serial.println("Not enough memory for the thumbnail buffers");
 
-	//	Wait until the first frame is captured and there is something to send
-	//	to clients
-	ulTaskNotifyTake( pdTRUE,					/* Clear the notification value before exiting. */
-										portMAX_DELAY ); /* Block indefinitely. */
+	//	RGB565 frames are grayscale by the time they get here. 1/8 is boxed down by 4 first
+	if ( format == PIXFORMAT_GRAYSCALE || format == PIXFORMAT_RGB565 ) {
+		if ( scale > 4 ) scale = 4;
+		size_t pixels = (resolution[framesize].width / scale) * (resolution[framesize].height / scale);
+		thumbLuma = (uint8_t*) (psramFound() ? ps_malloc(pixels) : malloc(pixels));
+	}
+}
 
-	xLastWakeTime = xTaskGetTickCount();
-	for (;;) {
-		// Default assumption we are running according to the FPS
-		xFrequency = pdMS_TO_TICKS(1000 / FPS);
+// ==== Box a grayscale frame down by 2, 4 or 8 and encode it ========================
+size_t shrinkGray(Frame* src, int scale, uint8_t* out, size_t capacity) {
+	int w = src->getWidth();
+	int h = src->getHeight();
+	if ( scale == 2 ) downscale2x(src->getBuf(), w, h, w, thumbLuma, w / 2);
+	else {
+		downscale4x(src->getBuf(), w, h, w, thumbLuma, w / 4);
+		if ( scale == 8 ) downscale2x(thumbLuma, w / 4, h / 4, w / 4, thumbLuma, w / 8);
+	}
 
-		//	Only bother to send anything if there is someone watching
-		UBaseType_t activeClients = uxQueueMessagesWaiting(streamingClients);
-		if ( activeClients ) {
-			// Adjust the period to the number of connected clients
-			xFrequency /= activeClients;
+	//	At the main stream's quality, as the JPEG domain path keeps the source's
+	int quality = JpegEncoder::qualityFor(qualityCtl.getQuality());
+	if ( quality != thumbQuality ) {
+		thumbEncoder.setQuality(quality);
+		thumbQuality = quality;
+	}
+	return thumbEncoder.encodeGray(thumbLuma, w / scale, h / scale, out, capacity);
+}
 
-			//	Since we are sending the same frame to everyone,
-			//	pop a client from the the front of the queue
-			WiFiClient *client;
-			xQueueReceive (streamingClients, (void*) &client, 0);
+// ==== Make a thumbnail frame out of a camera frame ========================
+Frame* makeThumb(Frame* src, int scale) {
+	//	No free buffer means the clients are still busy with earlier thumbnails - skip this one
+	uint8_t* slab = thumbPool.acquire();
+	if ( slab == NULL ) return NULL;
+
+	camera_fb_t* fb = (camera_fb_t*) slab;
+	size_t capacity = thumbPool.getSize() - sizeof(camera_fb_t);
+
+	memset(fb, 0, sizeof(camera_fb_t));
+	fb->buf = (uint8_t*) (fb + 1);
+	if ( src->getFormat() == PIXFORMAT_GRAYSCALE ) {
+		fb->len = shrinkGray(src, scale, fb->buf, capacity);
+		fb->width = src->getWidth() / scale;
+		fb->height = src->getHeight() / scale;
+	}
+	else {
+		fb->len = scaler.scale(src->getBuf(), src->getSize(), scale, fb->buf, capacity);
+		fb->width = scaler.getWidth();
+		fb->height = scaler.getHeight();
+	}
+	fb->format = PIXFORMAT_JPEG;
+	fb->timestamp = src->getTimestamp();
+
+	//	The source couldn't be decoded or the thumbnail didn't fit - drop it
+	if ( fb->len == 0 ) {
+		thumbsDropped.add();
+		thumbPool.release(slab);
+		return NULL;
+	}
+	return Frame::wrap(fb, freeThumb);
+}
 
-			//	Check if this client is still connected.
 
-			if (!client->connected()) {
-				//	delete this client reference if s/he has disconnected
-				//	and don't put it back on the queue anymore. Bye!
-				delete client;
-			}
-			else {
-
-				//	Ok. This is an actively connected client.
-				//	Let's grab a semaphore to prevent frame changes while we
-				//	are serving this frame
-				xSemaphoreTake( frameSync, portMAX_DELAY );
-
-				client->write(CTNTTYPE, cntLen);
-				sprintf(buf, "%d\r\n\r\n", camSize);
-				client->write(buf, strlen(buf));
-				client->write((char*) camBuf, (size_t)camSize);
-				client->write(BOUNDARY, bdrLen);
-
-				// Since this client is still connected, push it to the end
-				// of the queue for further processing
-				xQueueSend(streamingClients, (void *) &client, 0);
-
-				//	The frame has been served. Release the semaphore and let other tasks run.
-				//	If there is a frame switch ready, it will happen now in between frames
-				xSemaphoreGive( frameSync );
-				taskYIELD();
+// ==== RTOS task to shrink frames for the downscaled stream profiles ========================
+void thumbCB(void* pvParameters) {
+	for (;;) {
+		//	Wait for camCB to publish a new frame
+		ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+		//	Grayscale captures are shrunk from their pixels, everything else from its JPEG
+		Frame* src = thumbLuma ? rawFrame.acquire() : camFrame.acquire();
+		if ( src == NULL ) continue;
+		uint32_t now = millis();
+		uint32_t t = micros();
+
+		for ( int p = 0; p < profileCount; p++ ) {
+			StreamProfile& profile = profiles[p];
+
+			//	Only shrink frames for profiles someone is watching, and only as often as they are sent.
+			//	Allow for some capture jitter, or a late frame would halve the rate
+			if ( profile.scale < 2 || !registry.count(p) ) continue;
+			if ( profile.fps && now - profile.lastScaled < (uint32_t) (750 / profile.fps) ) continue;
+			profile.lastScaled = now;
+
+			Frame* thumb = makeThumb(src, profile.scale);
+			if ( thumb ) {
+				profile.onFrame(thumb->getSize());
+				profile.frames->publish(thumb);
+				xTaskNotifyGive( tStream );
 			}
 		}
-		else {
-			//	Since there are no connected clients, there is no reason to waste battery running
-			vTaskSuspend(NULL);
+		src->release();
+		tasks[TASK_THUMB].busy.add(micros() - t);
+	}
+}
+
+// ==== MOTION ======================================================
+// Frames are looked at no more often than this. Motion doesn't need the full frame rate,
+// and while streams idle the capture interval is bounded by max_latency anyway
+const uint32_t MOTION_INTERVAL = 200;
+
+// ==== RTOS task to look for motion in the camera frames ========================
+void motionCB(void* pvParameters) {
+	uint32_t last = 0;
+	for (;;) {
+		//	Wait for camCB to publish a new frame
+		ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+		uint32_t now = millis();
+		if ( !motionMode || now - last < MOTION_INTERVAL ) continue;
+		last = now;
+
+		//	Raw frames are read as they are, YUYV with a luma sample every other byte.
+		//	The format is the one the camera started with, not what pixformat says now
+		bool raw = cam.getPixelFormat() != PIXFORMAT_JPEG;
+		Frame* f = raw ? rawFrame.acquire() : camFrame.acquire();
+		if ( f == NULL ) continue;
+		uint32_t t = micros();
+		bool moving;
+		if ( raw ) {
+			int step = f->getFormat() == PIXFORMAT_GRAYSCALE ? 1 : 2;
+			moving = motion.analyze(f->getBuf(), f->getWidth(), f->getHeight(), f->getWidth() * step, step, now);
+		}
+		else moving = motion.analyze(f->getBuf(), f->getSize(), now);
+		f->release();
+		tasks[TASK_MOTION].busy.add(micros() - t);
+
+		//	In mode 2 streams idle while nothing moves. Going back to full rate wakes the
+		//	streaming task, so waiting clients don't sit out the rest of their idle period
+		bool idle = motionMode == 2 && !moving;
+		if ( pacer.isIdle() && !idle ) {
+			pacer.setIdle(false);
+			xTaskNotifyGive( tStream );
+		}
+		else pacer.setIdle(idle);
+	}
+}
+
+// ==== /motion: what moved, where and when ================================
+//	Regions are in grid cells; the grid size and the frame size let clients map them onto the picture.
+//	Grid row y covers rows y * rows / grid_y up to (y + 1) * rows / grid_y of the luma plane the
+//	detector looked at, which for JPEG has one row per 8 of the frame, (height + 7) / 8 of them
+//	Event times are in ms since boot, like "now"
+void motion_handler(void)
+{
+	StaticJsonDocument<2048> doc;
+	doc["mode"] = (int) motionMode;
+	doc["now"] = millis();
+	doc["active"] = motion.isActive();
+	doc["cells"] = motion.getCells();
+	doc["threshold"] = motion.getThreshold();
+	doc["width"] = motion.getWidth();
+	doc["height"] = motion.getHeight();
+	doc["rows"] = motion.getRows();
+	doc["grid_x"] = MOTION_GRID_X;
+	doc["grid_y"] = MOTION_GRID_Y;
+
+	//	Cells that changed in the last frame, one number per row with bit x for column x
+	JsonArray mask = doc.createNestedArray("mask");
+	for ( int y = 0; y < MOTION_GRID_Y; y++ )
+		mask.add(motion.getMask(y));
+
+	JsonArray events = doc.createNestedArray("events");
+	for ( int i = 0; i < motion.events(); i++ ) {
+		MotionEvent e = motion.event(i);
+		JsonObject o = events.createNestedObject();
+		o["start"] = e.start;
+		o["end"] = e.end;
+		o["peak"] = e.peak;
+		o["x0"] = e.x0;
+		o["y0"] = e.y0;
+		o["x1"] = e.x1;
+		o["y1"] = e.y1;
+	}
+
+	String response;
+	serializeJson(doc, response);
+	server.send(200, "application/json", response.c_str());
+}
+
+// ==== CLIPS ======================================================
+// ==== RTOS task to copy every new frame into the clip ring ========================
+void recordCB(void* pvParameters) {
+	uint32_t last = 0;
+	for (;;) {
+		//	Wait for camCB to publish a new frame
+		ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+		Frame* f = camFrame.acquire();
+		if ( f == NULL ) continue;
+		if ( f->getSeq() != last ) {
+			uint32_t t = micros();
+			last = f->getSeq();
+			ring.add(f->getBuf(), f->getSize(), millis());
+			tasks[TASK_RECORD].busy.add(micros() - t);
 		}
-		//	Let other tasks run after serving every client
-		taskYIELD();
-		vTaskDelayUntil(&xLastWakeTime, xFrequency);
+		f->release();
 	}
 }
 
-const char JHEADER[] =  "HTTP/1.1 200 OK\r\n" \
-						"Content-disposition: inline; filename=capture.jpg\r\n" \
-						"Content-type: image/jpeg\r\n\r\n";
-const int jhdLen = strlen(JHEADER);
+// Most a clip can ask for; the ring usually holds less anyway
+const int CLIP_MAX_SECONDS = 60;
+
+// The web server pumps a download whenever its socket takes more, and gives it up once the
+// viewer has stopped reading
+bool clipPump(void* ctx, bool stalled) {
+	ClipClient* clip = (ClipClient*) ctx;
+	if ( !stalled && clip->pump() ) return true;
+	delete clip;
+	return false;
+}
+
+// ==== /clip?seconds=N: the last N seconds from the ring, as a download ===================
+//	MJPEG by default, an AVI file with &format=avi. The download is handed to the web server,
+//	which sends it a piece at a time in between other requests while recording and live
+//	streaming go on. Frames are copied out of the ring as their turn comes
+void clip_handler(void)
+{
+	if ( ring.getBudget() == 0 ) {
+		server.send(503, "text/plain", "Clip recording is off, set clip_kb and restart");
+		return;
+	}
+	if ( server.pumping() == HTTP_MAX_PUMPS ) {
+		server.sendHeader("Retry-After", "5");
+		server.send(503, "text/plain", "Too many downloads");
+		return;
+	}
+
+	int seconds = server.hasArg("seconds") ? atoi(server.arg("seconds")) : 10;
+	if ( seconds < 1 ) seconds = 1;
+	if ( seconds > CLIP_MAX_SECONDS ) seconds = CLIP_MAX_SECONDS;
+
+	//	The clip ends with the newest frame there is right now
+	ClipClient* clip = new ClipClient(ring, strcmp(server.arg("format"), "avi") == 0);
+	int status = clip->prepare(ring.find(millis() - seconds * 1000), ring.end());
+	if ( status != 200 ) {
+		delete clip;
+		server.send(status, "text/plain", status == 404 ? "No frames recorded" : "Out of memory");
+		return;
+	}
+	clip->begin(server.pump(clipPump, clip));
+}
+
+// How long a snapshot waits for the camera to come up with a new frame
+const uint32_t SNAPSHOT_TIMEOUT = 2000;
+
+// ==== Wait for the camera to publish a frame newer than the current one ============
+Frame* nextFrame(uint32_t timeout)
+{
+	Frame* last = camFrame.acquire();
+	uint32_t seq = last ? last->getSeq() : 0;
+	if ( last ) last->release();
+
+	//	Forget notifications of frames we have already seen, then make sure the
+	//	camera task runs. With nobody streaming it takes one frame and suspends again
+	ulTaskNotifyTake(pdTRUE, 0);
+	if ( eTaskGetState( tCam ) == eSuspended ) vTaskResume( tCam );
+
+	uint32_t start = millis();
+	for (uint32_t waited = 0; waited < timeout; waited = millis() - start) {
+		ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout - waited));
+		Frame* f = camFrame.acquire();
+		if ( f && f->getSeq() != seq ) return f;
+		if ( f ) f->release();
+	}
+	return NULL;
+}
 
 // ==== Serve up one JPEG frame =============================================
 void handleJPG(void)
 {
-	WiFiClient client = server.client();
+	//	While the camera is running for the streams, the newest published frame is at
+	//	most one capture interval old, so that is what we serve - no extra capture and
+	//	no fighting camCB over the camera. ?fresh=1 waits for the next frame instead,
+	//	and so does a snapshot while the camera is idle and its last frame could be ancient
+	bool fresh = strcmp(server.arg("fresh"), "1") == 0 || eTaskGetState( tCam ) == eSuspended;
+	Frame* f = fresh ? nextFrame(SNAPSHOT_TIMEOUT) : camFrame.acquire();
+	if ( f == NULL ) {
+		server.send(503, "text/plain", "No frame available");
+		return;
+	}
 
-	if (!client.connected()) return;
-	cam.run();
-	client.write(JHEADER, jhdLen);
-	client.write((char*)cam.getfb(), cam.getSize());
+	//	With a Content-Length the client can keep the connection for the next snapshot
+	server.sendHeader("Content-disposition", "inline; filename=capture.jpg");
+	server.send(200, "image/jpeg", f->getBuf(), f->getSize());
+	f->release();
 }
 
 
+// ==== Export the pipeline metrics in the Prometheus text format ================
+static bool metricsChunk(void* ctx, const void* data, size_t len)
+{
+	return server.sendChunk(data, len);
+}
+
+void metrics_handler(void)
+{
+	//	The output grows with the clients and tasks, so it goes out in chunks of about one
+	//	TCP segment each rather than being put together in one buffer
+	const size_t capacity = 1400;
+	char* buf = (char*) malloc(capacity);
+	if ( buf == NULL ) {
+		server.send(503, "text/plain", "Out of memory");
+		return;
+	}
+	if ( !server.beginChunked(200, "text/plain; version=0.0.4") ) {
+		free(buf);
+		return;
+	}
+	MetricsWriter w(buf, capacity, metricsChunk, NULL);
+
+	w.histogram("esp32cam_capture_ms", "Time spent getting a frame from the camera driver", captureMs);
+	w.counter("esp32cam_frames_captured_total", "Frames captured and published", framesCaptured);
+	w.counter("esp32cam_frames_dropped_total", "Captures that returned no frame or found no free frame slot", framesDropped);
+	w.counter("esp32cam_frames_duplicate_total", "Frames identical to the one before, not published", framesDuplicate);
+	w.counter("esp32cam_frames_skipped_total", "Frames clients moved past without sending them", framesSkipped);
+	w.counter("esp32cam_stream_bytes_total", "Bytes sent to stream clients", streamBytes);
+	w.counter("esp32cam_stream_stall_ms_total", "Time stream client sockets were full", streamStallMs);
+	w.counter("esp32cam_stream_wait_ms_total", "Time the streaming task waited for frames or due clients", streamWaitMs);
+
+	uint32_t clients = clientCount.get();
+	w.gauge("esp32cam_stream_clients", "Connected stream clients", clients);
+	w.header("esp32cam_client_drain_bytes_per_second", "gauge", "How fast each stream client drains frames");
+	for ( uint32_t i = 0; i < clients && i < STREAM_SOCKETS; i++ ) {
+		char label[16];
+		snprintf(label, sizeof(label), "slot=\"%u\"", (unsigned) i);
+		w.sample("esp32cam_client_drain_bytes_per_second", label, clientRates[i].get());
+	}
+
+	w.counter("esp32cam_thumbs_dropped_total", "Thumbnails that could not be decoded or did not fit their buffer", thumbsDropped);
+	w.histogram("esp32cam_encode_ms", "Time spent encoding a raw frame", encodeMs);
+	w.counter("esp32cam_encodes_dropped_total", "Raw frames that found no free buffer or did not fit it", encodesDropped);
+	w.gauge("esp32cam_thumb_pool_slabs", "Thumbnail buffers in the pool", thumbPool.getCount());
+	w.gauge("esp32cam_thumb_pool_slab_bytes", "Size of each thumbnail buffer", thumbPool.getSize());
+	w.gauge("esp32cam_thumb_pool_in_use", "Thumbnail buffers currently in use", thumbPool.getInUse());
+	w.gauge("esp32cam_thumb_pool_peak", "Most thumbnail buffers in use at once", thumbPool.getPeak());
+	w.header("esp32cam_thumb_pool_exhausted_total", "counter", "Thumbnails skipped because no buffer was free");
+	w.sample("esp32cam_thumb_pool_exhausted_total", NULL, thumbPool.getExhausted());
+
+	w.gauge("esp32cam_stream_client_limit", "Most stream clients admitted at once", registry.getLimit());
+	w.header("esp32cam_stream_clients_evicted_total", "counter", "Stalled clients dropped to make room for new ones");
+	w.sample("esp32cam_stream_clients_evicted_total", NULL, registry.getEvicted());
+	w.header("esp32cam_stream_clients_rejected_total", "counter", "Clients turned away with a 503 because all places were taken");
+	w.sample("esp32cam_stream_clients_rejected_total", NULL, registry.getRejected());
+
+	w.header("esp32cam_motion_frames_total", "counter", "Frames looked at for motion");
+	w.sample("esp32cam_motion_frames_total", NULL, motion.getFrames());
+	w.header("esp32cam_motion_events_total", "counter", "Motion events since boot");
+	w.sample("esp32cam_motion_events_total", NULL, motion.getEventCount());
+	w.gauge("esp32cam_motion_active", "1 while something is moving", motion.isActive() ? 1 : 0);
+	w.gauge("esp32cam_motion_rows", "Rows of the luma plane the motion grid is laid over", motion.getRows());
+	w.gauge("esp32cam_stream_idle", "1 while streams idle for lack of motion", pacer.isIdle() ? 1 : 0);
+
+	w.gauge("esp32cam_clip_ring_bytes", "Size of the clip ring", ring.getBudget());
+	w.gauge("esp32cam_clip_ring_used_bytes", "Bytes of frames held in the clip ring", ring.getUsed());
+	w.gauge("esp32cam_clip_ring_frames", "Frames held in the clip ring", ring.getFrames());
+	w.gauge("esp32cam_clip_ring_span_ms", "Time between the oldest and the newest frame in the clip ring", ring.getSpan());
+	w.header("esp32cam_clip_ring_written_bytes_total", "counter", "Bytes copied into the clip ring");
+	w.sample("esp32cam_clip_ring_written_bytes_total", NULL, ring.getWritten());
+	w.header("esp32cam_clip_ring_evicted_total", "counter", "Frames dropped from the clip ring to make room");
+	w.sample("esp32cam_clip_ring_evicted_total", NULL, ring.getEvicted());
+
+	w.gauge("esp32cam_event_subscribers", "Settings pages subscribed to /events", events.count());
+	w.header("esp32cam_events_missed_total", "counter", "Events a subscriber missed because its socket was full");
+	w.sample("esp32cam_events_missed_total", NULL, events.getMissed());
+	w.header("esp32cam_events_dropped_total", "counter", "Events nobody got because there was no memory to put them together");
+	w.sample("esp32cam_events_dropped_total", NULL, events.getDropped());
+
+	w.gauge("esp32cam_capture_interval_ms", "Capture interval the pacer currently aims for", pacer.captureInterval());
+	w.gauge("esp32cam_frame_bytes", "Running average of the frame size", pacer.getFrameBytes());
+
+	w.gauge("esp32cam_heap_free_bytes", "Free internal heap", ESP.getFreeHeap());
+	w.gauge("esp32cam_heap_free_min_bytes", "Lowest free internal heap since boot", ESP.getMinFreeHeap());
+	w.gauge("esp32cam_psram_free_bytes", "Free PSRAM", ESP.getFreePsram());
+	w.gauge("esp32cam_psram_free_min_bytes", "Lowest free PSRAM since boot", ESP.getMinFreePsram());
+
+	//	Per task, and the busy time summed up per core. Whatever is left of a core's time went
+	//	to WiFi, lwIP and idling
+	uint32_t coreBusy[2] = { 0, 0 };
+	char label[40];
+	w.header("esp32cam_task_stack_free_min_bytes", "gauge", "Smallest amount of free stack each task has had");
+	for ( int i = 0; i < TASK_COUNT; i++ ) {
+		if ( *tasks[i].handle == NULL ) continue;
+		snprintf(label, sizeof(label), "task=\"%s\"", tasks[i].name);
+		w.sample("esp32cam_task_stack_free_min_bytes", label, uxTaskGetStackHighWaterMark(*tasks[i].handle));
+	}
+	w.header("esp32cam_task_busy_ms_total", "counter", "Time each task spent working rather than waiting");
+	for ( int i = 0; i < TASK_COUNT; i++ ) {
+		if ( *tasks[i].handle == NULL ) continue;
+		snprintf(label, sizeof(label), "task=\"%s\",core=\"%d\"", tasks[i].name, tasks[i].core);
+		w.sample("esp32cam_task_busy_ms_total", label, tasks[i].busy.get());
+		coreBusy[tasks[i].core] += tasks[i].busy.get();
+	}
+	w.header("esp32cam_core_busy_ms_total", "counter", "Time the pipeline tasks kept each core busy");
+	w.sample("esp32cam_core_busy_ms_total", "core=\"0\"", coreBusy[PRO_CPU]);
+	w.sample("esp32cam_core_busy_ms_total", "core=\"1\"", coreBusy[APP_CPU]);
+	w.gauge("esp32cam_task_topology", "Task topology in use", topology);
+
+	w.gauge("esp32cam_uptime_seconds", "Time since boot", millis() / 1000);
+
+	w.flush();
+	server.endChunked();
+	if ( w.isTruncated() ) Serial.println("Metrics output cut short");
+	free(buf);
+}
+
+
+// ==== /events: setting changes and stats as Server-Sent Events ==========================
+void events_handler(void)
+{
+	if ( events.count() >= EVENTS_MAX_SUBSCRIBERS ) {
+		server.sendHeader("Retry-After", "5");
+		server.send(503, "text/plain", "Too many subscribers");
+		return;
+	}
+	events.subscribe(server.detach());
+}
+
+// ==== Push the pipeline stats to the settings pages, once a second from loop() ==========
+void publishStats(void)
+{
+	static uint32_t lastMs, lastFrames, lastBytes;
+	uint32_t now = millis();
+	uint32_t frames = framesCaptured.get();
+	uint32_t bytes = streamBytes.get();
+	uint32_t elapsed = now - lastMs;
+
+	if ( events.count() && lastMs && elapsed ) {
+		char data[192];
+		snprintf(data, sizeof(data),
+			"{\"fps\":%u,\"kbps\":%u,\"clients\":%u,\"quality\":%d,\"framesize\":%d,\"motion\":%d,\"idle\":%d}",
+			(unsigned) ( (frames - lastFrames) * 1000 / elapsed ),
+			(unsigned) ( (uint64_t) (bytes - lastBytes) * 8 / elapsed ),
+			(unsigned) clientCount.get(),
+			qualityCtl.getQuality(),
+			(int) qualityCtl.getFramesize(),
+			motion.isActive() ? 1 : 0,
+			pacer.isIdle() ? 1 : 0);
+		events.publish("stats", data);
+	}
+	lastMs = now;
+	lastFrames = frames;
+	lastBytes = bytes;
+}
+
 // ==== Handle invalid URL requests ============================================
 void handleNotFound(){
 	String message = "Server is running!\n\n";
 	message += "URI: ";
 	message += server.uri();
 	message += "\nMethod: ";
-	message += (server.method() == HTTP_GET) ? "GET" : "POST";
+	message += (server.method() == HTTP_METHOD_GET) ? "GET" : "POST";
 	message += "\nArguments: ";
 	message += server.args();
 	message += "\nVersion: ";
@@ -683,7 +1175,7 @@ void handleNotFound(){
 	message += "\nCounter: ";
 	message += counter;
 	message += "\n";
-	server.send(200, "text / plain", message);
+	server.send(200, "text / plain", message.c_str());
 }
 
 
@@ -726,7 +1218,20 @@ void setup(){
 	config.pixel_format = PIXFORMAT_JPEG;
 	config.frame_size = FRAMESIZE_UXGA;
 	config.jpeg_quality = 0;
-	config.fb_count = 2;
+	// Frames are streamed straight out of the driver buffers, so allow for one
+	// being captured while clients are still sending the previous two
+	config.fb_count = 3;
+
+	// Raw frames are only kept until they are encoded, and by the one handed on to
+	// the stages that read pixels. The format has to be known before the driver starts
+	pixFormat = constrain(settings.getInt("pixformat", 0), 0, pixFormatCount - 1);
+	if ( pixFormats[pixFormat] != PIXFORMAT_JPEG ) {
+		config.pixel_format = pixFormats[pixFormat];
+		config.frame_size = RAW_FRAMESIZE;
+		config.fb_count = 2;
+	}
+	// RGB565 frames are only kept until their luma is taken out
+	if ( config.pixel_format == PIXFORMAT_RGB565 ) config.fb_count = 1;
 	
 
 	#if defined(CAMERA_MODEL_ESP_EYE)
@@ -740,35 +1245,30 @@ void setup(){
 		ESP.restart();
 	}
 
-	sensor_t * s = esp_camera_sensor_get();
-	
-	s->set_framesize(s, (framesize_t)preferences.getInt("framesize", s->status.framesize));
-	s->set_quality(s, 63 - preferences.getInt("quality", s->status.quality));
-	s->set_contrast(s, preferences.getInt("contrast", s->status.framesize));
-	s->set_brightness(s, preferences.getInt("brightness", s->status.brightness));
-	s->set_saturation(s, preferences.getInt("saturation", s->status.saturation));
-	s->set_gainceiling(s, (gainceiling_t)preferences.getInt("gainceiling", s->status.gainceiling));
-	s->set_colorbar(s, preferences.getInt("colorbar", s->status.colorbar));
-	s->set_whitebal(s, preferences.getInt("awb", s->status.awb));
-	s->set_gain_ctrl(s, preferences.getInt("agc", s->status.agc));
-	s->set_exposure_ctrl(s, preferences.getInt("aec", s->status.aec));
-	s->set_hmirror(s, preferences.getInt("hmirror", s->status.hmirror));
-	s->set_vflip(s, preferences.getInt("vflip", s->status.vflip));
-	s->set_awb_gain(s, preferences.getInt("awb_gain", s->status.awb_gain));
-	s->set_agc_gain(s, preferences.getInt("agc_gain", s->status.agc_gain));
-	s->set_aec_value(s, preferences.getInt("aec_value", s->status.aec_value));
-	s->set_aec2(s, preferences.getInt("aec2", s->status.aec2));
-	s->set_dcw(s, preferences.getInt("dcw", s->status.dcw));
-	s->set_bpc(s, preferences.getInt("bpc", s->status.bpc));
-	s->set_wpc(s, preferences.getInt("wpc", s->status.wpc));
-	s->set_raw_gma(s, preferences.getInt("raw_gma", s->status.raw_gma));
-	s->set_lenc(s, preferences.getInt("lenc", s->status.lenc));
-	s->set_special_effect(s, preferences.getInt("special_effect", s->status.special_effect));
-	s->set_wb_mode(s, preferences.getInt("wb_mode", s->status.wb_mode));
-	s->set_ae_level(s, preferences.getInt("ae_level", s->status.ae_level));
+	//	Bring the sensor and the pipeline to the stored settings, anything never set stays as it is
+	if ( !settings.bind(settingTable, settingCount) )
+		Serial.println("Settings with names over 15 characters can't be stored and are left out");
+	settings.applyAll();
 
 	preferences.end();
 
+	//	No frame, and no thumbnail, gets bigger than what the camera was set up for
+	setupThumbPool(config.frame_size, config.pixel_format, qualityCtl.getQualityMax());
+	if ( config.pixel_format != PIXFORMAT_JPEG ) {
+		size_t size = sizeof(camera_fb_t) + BufferPool::jpegBudget(resolution[config.frame_size].width, resolution[config.frame_size].height, 63);
+		if ( !rawPool.begin(size, RAW_BUFFERS) )
+			Serial.println("Not enough memory for the encoded frame buffers");
+	}
+	if ( config.pixel_format == PIXFORMAT_RGB565 ) {
+		size_t size = sizeof(camera_fb_t) + resolution[config.frame_size].width * resolution[config.frame_size].height;
+		if ( !lumaPool.begin(size, LUMA_BUFFERS) )
+			Serial.println("Not enough memory for the grayscale frame buffers");
+	}
+
+	//	The clip ring is sized once, at boot
+	if ( clipKb && !ring.begin((size_t) clipKb * 1024) )
+		Serial.println("Not enough memory for the clip ring");
+
 	ledcSetup(7, 5000, 8);
 	ledcAttachPin(4, 7);	//pin4 is LED
 	
@@ -800,19 +1300,16 @@ void setup(){
 				
 
 	// Start mainstreaming RTOS task
-	xTaskCreatePinnedToCore(
-		mjpegCB,
-		"mjpeg",
-		4 * 1024,
-		NULL,
-		2,
-		&tMjpeg,
-		APP_CPU);
+	startTask(TASK_MJPEG);
 }
 
 bool flag = false;
 
 void loop() {
+	//	Write settings back to flash once they have stopped changing
+	settings.loop(millis());
+	publishStats();
+
 	if(flag) {
 		webota.delay(1000);
 		webota.handle();
@@ -820,164 +1317,77 @@ void loop() {
 		vTaskDelay(1000);
 }
 
+// ==== /get: every setting, as set or as it is if it never was ======================
 void get_handler(){
-	sensor_t * s = esp_camera_sensor_get();
-	StaticJsonDocument<400> data;
-	
-	preferences.begin("CameraSettings", false);
-	
-	int framesize = preferences.getInt("framesize", 999);
-	data["framesize"] = (framesize == 999) ? s->status.framesize : framesize;
-	int quality = preferences.getInt("quality", 999);
-	data["quality"] = (quality == 999) ? 63 - s->status.quality : quality;
-	int contrast = preferences.getInt("contrast", 999);
-	data["contrast"] = (contrast == 999) ? s->status.contrast : contrast;
-	int brightness = preferences.getInt("brightness", 999);
-	data["brightness"] = (brightness == 999) ? s->status.brightness : brightness;
-	int saturation = preferences.getInt("saturation", 999);
-	data["saturation"] = (saturation == 999) ? s->status.saturation : saturation;
-	int gainceiling = preferences.getInt("gainceiling", 999);
-	data["gainceiling"] = (gainceiling == 999) ? s->status.gainceiling : gainceiling;
-	int colorbar = preferences.getInt("colorbar", 999);
-	data["colorbar"] = (colorbar == 999 ) ? s->status.colorbar : colorbar;
-	int awb = preferences.getInt("awb", 999);
-	data["awb"] = (awb == 999) ? s->status.awb : awb;
-	int agc = preferences.getInt("agc", 999);
-	data["agc"] = (agc == 999) ? s->status.agc : agc;
-	int aec = preferences.getInt("aec", 999);
-	data["aec"] = (aec == 999) ? s->status.aec : aec;
-	int hmirror = preferences.getInt("hmirror", 999);
-	data["hmirror"] = (hmirror == 999) ? s->status.hmirror : hmirror;
-	int vflip = preferences.getInt("vflip", 999);
-	data["vflip"] = (vflip == 999) ? s->status.vflip : vflip;
-	int awb_gain = preferences.getInt("awb_gain", 999);
-	data["awb_gain"] = (awb_gain == 999) ? s->status.awb_gain : awb_gain;
-	int agc_gain = preferences.getInt("agc_gain", 999);
-	data["agc_gain"] = (agc_gain == 999) ? s->status.agc_gain : agc_gain;
-	int aec_value = preferences.getInt("aec_value", 999);
-	data["aec_value"] = (aec_value == 999) ? s->status.aec_value : aec_value;
-	int aec2 = preferences.getInt("aec2", 999);
-	data["aec2"] = (aec2 == 999) ? s->status.aec2 : aec2;
-	int dcw = preferences.getInt("dcw", 999);
-	data["dcw"] = (dcw == 999) ? s->status.dcw : dcw;
-	int bpc = preferences.getInt("bpc", 999);
-	data["bpc"] = (bpc == 999) ? s->status.bpc : bpc;
-	int wpc = preferences.getInt("wpc", 999);
-	data["wpc"] = (wpc == 999) ? s->status.wpc : wpc;
-	int raw_gma = preferences.getInt("raw_gma", 999);
-	data["raw_gma"] = (raw_gma == 999) ? s->status.raw_gma : raw_gma;
-	int lenc = preferences.getInt("lenc", 999);
-	data["lenc"] = (lenc == 999) ? s->status.lenc : lenc;
-	int special_effect = preferences.getInt("special_effect", 999);
-	data["special_effect"] = (special_effect == 999) ? s->status.special_effect : special_effect;
-	int wb_mode = preferences.getInt("wb_mode", 999);
-	data["wb_mode"] = (wb_mode == 999) ? s->status.wb_mode : wb_mode;
-	int ae_level = preferences.getInt("ae_level", 999);
-	data["ae_level"] = (ae_level == 999) ? s->status.ae_level : ae_level;
-	
-	preferences.end();
-	
+	StaticJsonDocument<768> data;
+	for ( int i = 0; i < settingCount; i++ )
+		data[settingTable[i].name] = settings.get(settingTable[i]);
+
 	String response;
 	serializeJson(data, response);
-	server.send(200, "application/json", response);
+	server.send(200, "application/json", response.c_str());
 }
 
+// ==== /set: one variable, or several in one request =========================
+//	?var=<var>&val=<val>, repeated as often as needed, or a POSTed JSON body
+//	like {"framesize": 8, "quality": 40}
 void set_handler(){
-	String variable = server.arg("var");
-	String value = server.arg("val");
- 	
-		int val = value.toInt();
-		
-		sensor_t * s = esp_camera_sensor_get();
-		
-		preferences.begin("CameraSettings", false);
-		
-		if(variable == "framesize") {
-				if(s->pixformat == PIXFORMAT_JPEG) 
-					s->set_framesize(s, (framesize_t)val);
-					preferences.putInt("framesize", val);
+	//	What was set, as it ended up after clamping, for the other open settings pages
+	StaticJsonDocument<768> changed;
+
+	if ( server.bodyLength() ) {
+		StaticJsonDocument<768> doc;
+		DeserializationError err = deserializeJson(doc, server.body(), server.bodyLength());
+		if ( err ) {
+			server.send(400, "text/plain", err.c_str());
+			return;
 		}
-		else if(variable == "quality"){
-			s->set_quality(s, 63 - val);
-			preferences.putInt("quality", val);
-		} else if(variable == "contrast"){
-			s->set_contrast(s, val);
-			preferences.putInt("contrast", val);
-		} else if(variable == "brightness"){
-			s->set_brightness(s, val);
-			preferences.putInt("brightness", val);
-		} else if(variable == "saturation"){
-			s->set_saturation(s, val);
-			preferences.putInt("saturation", val);
-		} else if(variable == "gainceiling"){
-			s->set_gainceiling(s, (gainceiling_t)val);
-			preferences.putInt("gainceiling", val);
-		} else if(variable == "colorbar"){
-			s->set_colorbar(s, val);
-			preferences.putInt("colorbar", val);
-		} else if(variable == "awb"){
-			s->set_whitebal(s, val);
-			preferences.putInt("awb", val);
-		} else if(variable == "agc"){
-			s->set_gain_ctrl(s, val);
-			preferences.putInt("agc", val);
-		} else if(variable == "aec"){
-			s->set_exposure_ctrl(s, val);
-			preferences.putInt("aec", val);
-		} else if(variable == "hmirror"){
-			s->set_hmirror(s, val);
-			preferences.putInt("hmirror", val);
-		} else if(variable == "vflip"){
-			s->set_vflip(s, val);
-			preferences.putInt("vflip", val);
-		} else if(variable == "awb_gain"){
-			s->set_awb_gain(s, val);
-			preferences.putInt("awb_gain", val);
-		} else if(variable == "agc_gain"){
-			s->set_agc_gain(s, val);
-			preferences.putInt("agc_gain", val);
-		} else if(variable == "aec_value"){
-			s->set_aec_value(s, val);
-			preferences.putInt("aec_value", val);
-		} else if(variable == "aec2"){
-			s->set_aec2(s, val);
-			preferences.putInt("aec2", val);
-		} else if(variable == "dcw"){
-			s->set_dcw(s, val);
-			preferences.putInt("dcw", val);
-		} else if(variable == "bpc"){
-			s->set_bpc(s, val);
-			preferences.putInt("bpc", val);
-		} else if(variable == "wpc"){
-			s->set_wpc(s, val);
-			preferences.putInt("wpc", val);
-		} else if(variable == "raw_gma"){
-			s->set_raw_gma(s, val);
-			preferences.putInt("raw_gma", val);
-		} else if(variable == "lenc"){
-			s->set_lenc(s, val);
-			preferences.putInt("lenc", val);
-		} else if(variable == "special_effect"){
-			s->set_special_effect(s, val);
-			preferences.putInt("special_effect", val);
-		} else if(variable == "wb_mode"){
-			s->set_wb_mode(s, val);
-			preferences.putInt("wb_mode", val);
-		} else if(variable == "ae_level"){
-			s->set_ae_level(s, val);
-			preferences.putInt("ae_level", val);
+		for ( JsonPair kv : doc.as<JsonObject>() ) {
+			const Setting* e = settings.lookup(kv.key().c_str());
+			if ( e && settings.set(e->name, kv.value().as<int>()) ) changed[e->name] = settings.get(*e);
 		}
-		
-		preferences.end();
-		
-		server.send(200, "text/plain", ("OK"));
+	}
+
+	for ( int i = 0; i + 1 < server.args(); i++ ) {
+		if ( strcmp(server.argName(i), "var") != 0 || strcmp(server.argName(i + 1), "val") != 0 ) continue;
+		const Setting* e = settings.lookup(server.arg(i));
+		if ( e && settings.set(e->name, atoi(server.arg(i + 1))) ) changed[e->name] = settings.get(*e);
+	}
+
+	server.send(200, "text/plain", ("OK"));
+
+	if ( events.count() ) {
+		String data;
+		serializeJson(changed, data);
+		if ( !events.publish("settings", data.c_str()) ) Serial.printf("settings event of %u bytes dropped\n", data.length());
+	}
 }
 
+// ==== /control: send the browser on to the settings page =============================
+//	The page lives at a URL with its hash in it, so it can be cached for good. This only points
+//	there and is never cached itself, so the page that comes with new firmware shows up right away
 void control3_handler(){
-	server.send(200, "text/html", (const char *)INDEX_HTML);
+	server.sendHeader("Location", INDEX_HTML_PATH);
+	server.sendHeader("Cache-Control", "no-cache");
+	server.send(302, "text/plain", "");
+}
+
+// ==== The settings page, gzipped at build time by tools/embed_ui.py ======================
+//	A browser that has it already gets a 304 and not a single byte of it
+void index_handler(){
+	const char* tag = server.header("If-None-Match");
+	server.sendHeader("ETag", "\"" INDEX_HTML_HASH "\"");
+	server.sendHeader("Cache-Control", "public, max-age=31536000, immutable");
+	if ( tag && strstr(tag, INDEX_HTML_HASH) ) {
+		server.send(304, "text/html", "");
+		return;
+	}
+	server.sendHeader("Content-Encoding", "gzip");
+	server.send(200, "text/html", INDEX_HTML_GZ, sizeof(INDEX_HTML_GZ));
 }
 
 void restart_handler(){
+	settings.flush();
 	server.send(200, "text/plain", ("OK"));
 	delay(500);
 	ESP.restart();
@@ -989,9 +1399,7 @@ void activatewebota_handler(){
 }
 
 void reset_handler(){
-	preferences.begin("CameraSettings", false);
-	preferences.clear();
-	preferences.end();
+	settings.clear();
 	server.send(200, "text/plain", ("OK"));
 	server.send(200, "text/plain", ("OK"));
 	delay(500);
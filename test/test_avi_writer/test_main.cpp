@@ -0,0 +1,244 @@
+// AviWriter: a file written through a sink that can seek and one that can't,
+// parsed back - the RIFF and movi sizes, the buffer size a player is told to
+// allocate, the chunks in movi and the idx1 entries pointing at them, a skipped
+// frame showing the one before it again. Then a clip downloaded as AVI, whose
+// Content-Length must be exactly what comes.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "AviWriter.h"
+#include "ClipClient.h"
+#include "JpegEncoder.h"
+
+#define WIDTH 160
+#define HEIGHT 120
+#define FRAMES 12
+#define SKIPPED 5 // the frame that goes missing
+
+static uint8_t gray[WIDTH * HEIGHT];
+static std::vector<uint8_t> jpgs[FRAMES];
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// JPEGs of changing detail, so their sizes differ; every third one is given
+// an odd length to need a pad byte
+static bool encodeFrames(void)
+{
+    JpegEncoder encoder;
+    encoder.setQuality(80);
+    for (int n = 0; n < FRAMES; n++)
+    {
+        for (int y = 0; y < HEIGHT; y++)
+            for (int x = 0; x < WIDTH; x++)
+                gray[y * WIDTH + x] = ((x * (n + 1)) ^ (y * 3)) & 0xFF;
+        jpgs[n].resize(WIDTH * HEIGHT);
+        size_t len = encoder.encodeGray(gray, WIDTH, HEIGHT, jpgs[n].data(), jpgs[n].size());
+        if (len == 0)
+            return false;
+        if (n % 3 == 0 && !(len & 1))
+            len++;
+        jpgs[n].resize(len);
+    }
+    return true;
+}
+
+static bool collect(void *ctx, const void *data, size_t len)
+{
+    ((std::string *)ctx)->append((const char *)data, len);
+    return true;
+}
+
+static bool write(void *ctx, const void *data, size_t len)
+{
+    return fwrite(data, 1, len, (FILE *)ctx) == len;
+}
+
+// Everything a player relies on, for FRAMES frames with SKIPPED replaced
+static void checkFile(const uint8_t *avi, size_t size, uint32_t largest)
+{
+    TEST_ASSERT_EQUAL(0, memcmp(avi, "RIFF", 4));
+    TEST_ASSERT_EQUAL(size - 8, get32(avi + 4));
+    TEST_ASSERT_EQUAL(0, memcmp(avi + 8, "AVI ", 4));
+
+    // avih, then strh inside the strl list
+    TEST_ASSERT_EQUAL(0, memcmp(avi + 24, "avih", 4));
+    TEST_ASSERT_EQUAL(FRAMES, get32(avi + 48));                       // dwTotalFrames
+    TEST_ASSERT_EQUAL(AviWriter::chunkSize(largest), get32(avi + 60)); // dwSuggestedBufferSize
+    TEST_ASSERT_EQUAL(WIDTH, get32(avi + 64));
+    TEST_ASSERT_EQUAL(HEIGHT, get32(avi + 68));
+    TEST_ASSERT_EQUAL(0, memcmp(avi + 100, "strh", 4));
+    TEST_ASSERT_EQUAL(FRAMES, get32(avi + 140));                       // dwLength
+    TEST_ASSERT_EQUAL(AviWriter::chunkSize(largest), get32(avi + 144));
+
+    // movi holds one chunk per frame, JUNK of the same size for the missing one
+    const uint8_t *movi = avi + AVI_HEADER_SIZE - 4;
+    TEST_ASSERT_EQUAL(0, memcmp(movi - 8, "LIST", 4));
+    TEST_ASSERT_EQUAL(0, memcmp(movi, "movi", 4));
+    uint32_t moviSize = get32(movi - 4);
+    uint32_t offsets[FRAMES];
+    uint32_t at = 4;
+    for (int n = 0; n < FRAMES; n++)
+    {
+        const uint8_t *c = movi + at;
+        TEST_ASSERT_EQUAL(0, memcmp(c, n == SKIPPED ? "JUNK" : "00dc", 4));
+        TEST_ASSERT_EQUAL(jpgs[n].size(), get32(c + 4));
+        if (n != SKIPPED)
+            TEST_ASSERT_EQUAL(0, memcmp(c + 8, jpgs[n].data(), jpgs[n].size()));
+        offsets[n] = at;
+        at += AviWriter::chunkSize(jpgs[n].size());
+    }
+    TEST_ASSERT_EQUAL(moviSize, at);
+
+    // idx1: the missing frame shows the one before it again
+    const uint8_t *idx = movi + moviSize;
+    TEST_ASSERT_EQUAL(0, memcmp(idx, "idx1", 4));
+    TEST_ASSERT_EQUAL(FRAMES * 16, get32(idx + 4));
+    for (int n = 0; n < FRAMES; n++)
+    {
+        const uint8_t *e = idx + 8 + n * 16;
+        int shown = n == SKIPPED ? n - 1 : n;
+        TEST_ASSERT_EQUAL(0, memcmp(e, "00dc", 4));
+        TEST_ASSERT_EQUAL(offsets[shown], get32(e + 8));
+        TEST_ASSERT_EQUAL(jpgs[shown].size(), get32(e + 12));
+        TEST_ASSERT_EQUAL(0, memcmp(movi + get32(e + 8), "00dc", 4));
+    }
+    TEST_ASSERT_EQUAL(size, (size_t)(idx + 8 + FRAMES * 16 - avi));
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_file_rewritten_in_place(void)
+{
+    FILE *f = tmpfile();
+    TEST_ASSERT_NOT_NULL(f);
+    AviWriter writer;
+    TEST_ASSERT_TRUE(writer.begin(write, f, WIDTH, HEIGHT, 10, FRAMES));
+    uint32_t largest = 0;
+    for (int n = 0; n < FRAMES; n++)
+    {
+        if (n == SKIPPED)
+        {
+            TEST_ASSERT_TRUE(writer.skip(jpgs[n].size()));
+            continue;
+        }
+        TEST_ASSERT_TRUE(writer.add(jpgs[n].data(), jpgs[n].size()));
+        if (jpgs[n].size() > largest)
+            largest = jpgs[n].size();
+    }
+    TEST_ASSERT_FALSE(writer.add(jpgs[0].data(), jpgs[0].size())); // no room left
+    TEST_ASSERT_TRUE(writer.end());
+    TEST_ASSERT_EQUAL(FRAMES, writer.getFrames());
+
+    fseek(f, 0, SEEK_SET);
+    fwrite(writer.header(), 1, AVI_HEADER_SIZE, f);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    TEST_ASSERT_EQUAL(writer.getSize(), size);
+
+    std::vector<uint8_t> avi(size);
+    fseek(f, 0, SEEK_SET);
+    TEST_ASSERT_EQUAL(size, (long)fread(avi.data(), 1, size, f));
+    fclose(f);
+    checkFile(avi.data(), size, largest);
+}
+
+void test_stream_declared_up_front(void)
+{
+    // what a download plans from the ring before sending anything
+    uint32_t bytes = 0, largest = 0;
+    for (int n = 0; n < FRAMES; n++)
+    {
+        bytes += AviWriter::chunkSize(jpgs[n].size());
+        if (jpgs[n].size() > largest)
+            largest = jpgs[n].size();
+    }
+
+    std::string out;
+    AviWriter writer;
+    TEST_ASSERT_TRUE(writer.begin(collect, &out, WIDTH, HEIGHT, 10, FRAMES, FRAMES, bytes, largest));
+    std::string first = out;
+    for (int n = 0; n < FRAMES; n++)
+        if (n == SKIPPED)
+            TEST_ASSERT_TRUE(writer.skip(jpgs[n].size()));
+        else
+            TEST_ASSERT_TRUE(writer.add(jpgs[n].data(), jpgs[n].size()));
+    TEST_ASSERT_TRUE(writer.end());
+
+    // the header sent first is the one the file ends up needing
+    TEST_ASSERT_EQUAL(AVI_HEADER_SIZE + bytes + 8 + FRAMES * 16, out.size());
+    TEST_ASSERT_EQUAL(writer.getSize(), out.size());
+    TEST_ASSERT_EQUAL(0, memcmp(first.data(), writer.header(), AVI_HEADER_SIZE));
+    checkFile((const uint8_t *)out.data(), out.size(), largest);
+}
+
+void test_clip_download_length(void)
+{
+    FrameRing ring;
+    TEST_ASSERT_TRUE(ring.begin(256 * 1024));
+    uint32_t largest = 0;
+    for (int n = 0; n < FRAMES; n++)
+    {
+        TEST_ASSERT_TRUE(ring.add(jpgs[n].data(), jpgs[n].size(), 1000 + n * 100));
+        if (jpgs[n].size() > largest)
+            largest = jpgs[n].size();
+    }
+
+    int sv[2];
+    TEST_ASSERT_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+    ClipClient *clip = new ClipClient(ring, true);
+    TEST_ASSERT_EQUAL(200, clip->prepare(ring.end() - FRAMES, ring.end()));
+    clip->begin(sv[0]);
+
+    std::string in;
+    char buf[4096];
+    bool more = true;
+    while (more)
+    {
+        more = clip->pump();
+        int n;
+        while ((n = recv(sv[1], buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+            in.append(buf, n);
+    }
+    TEST_ASSERT_EQUAL(FRAMES, clip->getFrames());
+    TEST_ASSERT_EQUAL(0, clip->getSkipped());
+    delete clip;
+    int n;
+    while ((n = recv(sv[1], buf, sizeof(buf), 0)) > 0)
+        in.append(buf, n);
+    close(sv[1]);
+
+    size_t body = in.find("\r\n\r\n") + 4;
+    size_t length = strtoul(in.c_str() + in.find("Content-Length: ") + 16, NULL, 10);
+    TEST_ASSERT_EQUAL(in.size() - body, length);
+
+    const uint8_t *avi = (const uint8_t *)in.data() + body;
+    TEST_ASSERT_EQUAL(length - 8, get32(avi + 4));
+    TEST_ASSERT_EQUAL(FRAMES, get32(avi + 48));
+    TEST_ASSERT_EQUAL(AviWriter::chunkSize(largest), get32(avi + 60));
+    TEST_ASSERT_EQUAL(10, 1000000 / get32(avi + 32)); // a frame every 100 ms
+}
+
+int main(int argc, char **argv)
+{
+    if (!encodeFrames())
+        return 1;
+    UNITY_BEGIN();
+    RUN_TEST(test_file_rewritten_in_place);
+    RUN_TEST(test_stream_declared_up_front);
+    RUN_TEST(test_clip_download_length);
+    return UNITY_END();
+}
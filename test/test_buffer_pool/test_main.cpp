@@ -0,0 +1,163 @@
+// BufferPool: a long soak of frames of ever changing sizes held for random
+// times, which never allocates and never hands a slab out twice, and several
+// threads acquiring and releasing at once through the compare-and-swap.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <pthread.h>
+#include <malloc.h>
+#include <sched.h>
+
+#include "BufferPool.h"
+
+#define SLABS 8
+#define SOAK_ROUNDS 2000000
+#define THREADS 4
+#define THREAD_ROUNDS 500000
+
+static BufferPool pool;
+static BufferPool shared;
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_slab_size_and_alignment(void)
+{
+    BufferPool p;
+    size_t budget = BufferPool::jpegBudget(800, 600, 63);
+    TEST_ASSERT_TRUE(p.begin(budget, SLABS));
+    TEST_ASSERT_GREATER_OR_EQUAL(budget, p.getSize());
+    TEST_ASSERT_EQUAL(0, p.getSize() % 32);
+    for (int i = 0; i < SLABS; i++)
+        TEST_ASSERT_EQUAL(0, (uintptr_t)p.acquire() % 32);
+    TEST_ASSERT_NULL(p.acquire());
+    TEST_ASSERT_EQUAL(1, p.getExhausted());
+}
+
+// Days of frames compressed into a loop: sizes follow the scene, frames are
+// held from one to a dozen rounds, and now and then everything is in use
+void test_fragmentation_soak(void)
+{
+    size_t slab = BufferPool::jpegBudget(800, 600, 53);
+    TEST_ASSERT_TRUE(pool.begin(slab, SLABS));
+
+    struct Held
+    {
+        uint8_t *buf;
+        uint32_t until;
+        uint32_t tag;
+    } held[SLABS] = {};
+
+    struct mallinfo2 before = mallinfo2();
+    uint32_t seed = 1, drops = 0;
+    for (uint32_t round = 1; round <= SOAK_ROUNDS; round++)
+    {
+        for (int i = 0; i < SLABS; i++)
+            if (held[i].buf && held[i].until == round)
+            {
+                // nobody wrote over it while it was held
+                uint32_t tag;
+                memcpy(&tag, held[i].buf, 4);
+                TEST_ASSERT_EQUAL_UINT32(held[i].tag, tag);
+                pool.release(held[i].buf);
+                held[i].buf = NULL;
+            }
+
+        seed = seed * 1103515245 + 12345;
+        size_t len = slab / 4 + (seed >> 8) % (slab * 3 / 4);
+        uint8_t *buf = pool.acquire();
+        if (buf == NULL)
+        {
+            drops++;
+            continue;
+        }
+        int i = 0;
+        while (held[i].buf)
+            i++;
+        held[i].buf = buf;
+        held[i].until = round + 1 + (seed >> 4) % 12;
+        held[i].tag = round;
+        memcpy(buf, &round, 4);
+        buf[len - 1] = 0xD9; // the whole frame fits
+    }
+    struct mallinfo2 after = mallinfo2();
+    for (int i = 0; i < SLABS; i++)
+        pool.release(held[i].buf);
+
+    printf("%u frames, %u dropped with every slab in use, peak %d of %d\n",
+           (unsigned)pool.getAcquired(), (unsigned)drops, pool.getPeak(), pool.getCount());
+    TEST_ASSERT_EQUAL(drops, pool.getExhausted());
+    TEST_ASSERT_EQUAL(SOAK_ROUNDS - drops, pool.getAcquired());
+    TEST_ASSERT_EQUAL(SLABS, pool.getPeak());
+    TEST_ASSERT_EQUAL(before.uordblks, after.uordblks); // the heap never moved
+    TEST_ASSERT_EQUAL(0, pool.getInUse());
+}
+
+struct Worker
+{
+    pthread_t thread;
+    uint32_t id;
+    uint32_t got;
+    uint32_t clashes;
+};
+
+static void *churn(void *arg)
+{
+    Worker &w = *(Worker *)arg;
+    for (int i = 0; i < THREAD_ROUNDS; i++)
+    {
+        uint8_t *buf = shared.acquire();
+        if (buf == NULL)
+            continue;
+        w.got++;
+        // claim the slab, let the others run, then see whether one of them
+        // got it too
+        memset(buf, w.id, 64);
+        sched_yield();
+        for (int j = 0; j < 64; j++)
+            if (buf[j] != w.id)
+            {
+                w.clashes++;
+                break;
+            }
+        shared.release(buf);
+    }
+    return NULL;
+}
+
+void test_acquire_release_under_contention(void)
+{
+    // fewer slabs than threads, so they keep finding the pool empty
+    TEST_ASSERT_TRUE(shared.begin(64, THREADS - 1));
+    Worker workers[THREADS] = {};
+    for (int t = 0; t < THREADS; t++)
+    {
+        workers[t].id = t + 1;
+        pthread_create(&workers[t].thread, NULL, churn, &workers[t]);
+    }
+    uint32_t got = 0;
+    for (int t = 0; t < THREADS; t++)
+    {
+        pthread_join(workers[t].thread, NULL);
+        TEST_ASSERT_EQUAL_MESSAGE(0, workers[t].clashes, "two threads held the same slab");
+        got += workers[t].got;
+    }
+    TEST_ASSERT_EQUAL(0, shared.getInUse());
+    TEST_ASSERT_EQUAL(got, shared.getAcquired());
+    printf("%u slabs handed out to %d threads, %u times the pool was empty\n",
+           (unsigned)got, THREADS, (unsigned)shared.getExhausted());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_slab_size_and_alignment);
+    RUN_TEST(test_fragmentation_soak);
+    RUN_TEST(test_acquire_release_under_contention);
+    return UNITY_END();
+}
@@ -0,0 +1,273 @@
+// ClientRegistry: admission at the limit, eviction of stalled clients, and
+// what one streaming pass over the slots costs from 1 to 30 clients, each a
+// StreamClient on a local socket drained by a reader thread. Also the metrics
+// writer, which used to cut its output off once the clients made it long.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "Frame.h"
+#include "StreamClient.h"
+#include "ClientRegistry.h"
+#include "Metrics.h"
+
+#define MAX_CLIENTS 30
+#define FRAMES 500
+#define FRAME_SIZE 30000
+
+static camera_fb_t fb;
+static FrameExchange exchange;
+
+static void keep(camera_fb_t *)
+{
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_admit_up_to_the_limit(void)
+{
+    ClientRegistry registry;
+    registry.setLimit(3);
+    StreamClient *clients[4];
+    for (int i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_TRUE(registry.admit());
+        clients[i] = new StreamClient(-1);
+        TEST_ASSERT_TRUE(registry.add(clients[i], 0));
+    }
+    TEST_ASSERT_EQUAL(3, registry.count());
+
+    // nobody has stalled long enough to give up their place
+    registry.setStall(1, REGISTRY_EVICT_STALL - 1);
+    TEST_ASSERT_FALSE(registry.admit());
+    TEST_ASSERT_EQUAL(1, registry.getRejected());
+
+    // now somebody has, and is marked for the streaming task to delete
+    registry.setStall(1, REGISTRY_EVICT_STALL);
+    TEST_ASSERT_TRUE(registry.admit());
+    TEST_ASSERT_TRUE(registry.evicting(1));
+    TEST_ASSERT_EQUAL(1, registry.getEvicted());
+    TEST_ASSERT_EQUAL(3, registry.count()); // until it is gone
+
+    // there is room under the limit again, but while all slots are taken the
+    // new client still has nowhere to go and the server has to turn it away
+    registry.setLimit(registry.getSlots());
+    for (int i = 3; i < registry.getSlots(); i++)
+        TEST_ASSERT_TRUE(registry.add(new StreamClient(-1), 1));
+    clients[3] = new StreamClient(-1);
+    TEST_ASSERT_FALSE(registry.add(clients[3], 0));
+    delete clients[3];
+
+    // once the streaming task has removed the evicted one it gets its slot
+    delete registry.get(1);
+    registry.remove(1);
+    TEST_ASSERT_TRUE(registry.add(new StreamClient(-1), 0));
+    TEST_ASSERT_EQUAL(3, registry.count(0));
+
+    for (int i = 0; i < registry.getSlots(); i++)
+        if (registry.get(i))
+        {
+            delete registry.get(i);
+            registry.remove(i);
+        }
+    TEST_ASSERT_EQUAL(0, registry.count());
+}
+
+struct Drain
+{
+    pthread_t thread;
+    int socks[MAX_CLIENTS];
+    uint64_t bytes[MAX_CLIENTS];
+    int count;
+    std::atomic<bool> done;
+};
+
+// one reader for all viewers, so the machine running the test isn't busier
+// with threads than the streaming pass being measured
+static void *drain(void *arg)
+{
+    Drain &d = *(Drain *)arg;
+    static uint8_t buf[65536];
+    while (!d.done)
+    {
+        fd_set rd;
+        FD_ZERO(&rd);
+        int maxSock = 0;
+        for (int i = 0; i < d.count; i++)
+        {
+            FD_SET(d.socks[i], &rd);
+            if (d.socks[i] > maxSock)
+                maxSock = d.socks[i];
+        }
+        struct timeval tv = {0, 10000};
+        if (select(maxSock + 1, &rd, NULL, NULL, &tv) <= 0)
+            continue;
+        for (int i = 0; i < d.count; i++)
+            if (FD_ISSET(d.socks[i], &rd))
+            {
+                int n = read(d.socks[i], buf, sizeof(buf));
+                if (n > 0)
+                    d.bytes[i] += n;
+            }
+    }
+    return NULL;
+}
+
+// The streaming task's pass: every slot is looked at in place, idle clients
+// start the new frame and all are pumped until it is out. Returns µs per frame
+static double stream(ClientRegistry &registry, Drain &d)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < FRAMES; n++)
+    {
+        fb.timestamp.tv_sec = n;
+        exchange.publish(Frame::wrap(&fb, keep));
+        Frame *f = exchange.acquire();
+
+        bool busy = true;
+        while (busy)
+        {
+            busy = false;
+            for (int i = 0; i < registry.getSlots(); i++)
+            {
+                StreamClient *c = registry.get(i);
+                if (c == NULL)
+                    continue;
+                if (c->idle() && c->lastSeq() != f->getSeq())
+                    c->start(f, 0);
+                busy |= c->pump() || !c->idle();
+            }
+        }
+        f->release();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / FRAMES;
+}
+
+void test_streaming_pass_scales_with_clients(void)
+{
+    fb.buf = (uint8_t *)malloc(FRAME_SIZE);
+    fb.len = FRAME_SIZE;
+    memset(fb.buf, 0x55, FRAME_SIZE);
+
+    const int counts[] = {1, 2, 5, 10, 20, 30};
+    double perClient[6];
+    for (int k = 0; k < 6; k++)
+    {
+        int clients = counts[k];
+        ClientRegistry registry(clients);
+        registry.setLimit(clients);
+        Drain d;
+        d.count = clients;
+        d.done = false;
+        for (int i = 0; i < clients; i++)
+        {
+            int sv[2];
+            TEST_ASSERT_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+            TEST_ASSERT_TRUE(registry.admit());
+            TEST_ASSERT_TRUE(registry.add(new StreamClient(sv[0]), 0));
+            d.socks[i] = sv[1];
+            d.bytes[i] = 0;
+        }
+        TEST_ASSERT_FALSE(registry.admit());
+        pthread_create(&d.thread, NULL, drain, &d);
+
+        double us = stream(registry, d);
+        perClient[k] = us / clients;
+        printf("%2d clients: %7.1f us per frame, %5.1f us per client\n", clients, us, perClient[k]);
+
+        for (int i = 0; i < registry.getSlots(); i++)
+            if (registry.get(i))
+            {
+                delete registry.get(i);
+                registry.remove(i);
+            }
+        usleep(50000);
+        d.done = true;
+        pthread_join(d.thread, NULL);
+        for (int i = 0; i < clients; i++)
+        {
+            // every viewer got every frame
+            TEST_ASSERT_GREATER_OR_EQUAL((uint64_t)FRAMES * FRAME_SIZE, d.bytes[i]);
+            close(d.socks[i]);
+        }
+    }
+    // O(clients): going from 10 to 30 doesn't make each one dearer by much
+    TEST_ASSERT_LESS_THAN(perClient[3] * 2, perClient[5]);
+    free(fb.buf);
+}
+
+static bool collect(void *ctx, const void *data, size_t len)
+{
+    ((std::string *)ctx)->append((const char *)data, len);
+    return true;
+}
+
+static void writeClients(MetricsWriter &w, int clients)
+{
+    w.header("esp32cam_client_drain_bytes_per_second", "gauge", "How fast each stream client drains frames");
+    for (int i = 0; i < clients; i++)
+    {
+        char label[16];
+        snprintf(label, sizeof(label), "slot=\"%d\"", i);
+        w.sample("esp32cam_client_drain_bytes_per_second", label, 1000000 + i);
+    }
+}
+
+void test_metrics_overflow_is_reported(void)
+{
+    char buf[256];
+    MetricsWriter w(buf, sizeof(buf));
+    writeClients(w, MAX_CLIENTS);
+    TEST_ASSERT_TRUE(w.isTruncated());
+    TEST_ASSERT_EQUAL('\n', buf[w.length() - 1]); // cut at a whole line
+}
+
+void test_metrics_flow_through_the_sink(void)
+{
+    char buf[256];
+    std::string out;
+    MetricsWriter w(buf, sizeof(buf), collect, &out);
+    writeClients(w, MAX_CLIENTS);
+    TEST_ASSERT_TRUE(w.flush());
+    TEST_ASSERT_FALSE(w.isTruncated());
+
+    // every sample made it, in order and whole
+    size_t at = 0;
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        char line[96];
+        snprintf(line, sizeof(line), "esp32cam_client_drain_bytes_per_second{slot=\"%d\"} %d\n", i, 1000000 + i);
+        at = out.find(line, at);
+        TEST_ASSERT_TRUE(at != std::string::npos);
+    }
+
+    // a line longer than the whole buffer can't go anywhere
+    char small[16];
+    std::string rest;
+    MetricsWriter tiny(small, sizeof(small), collect, &rest);
+    tiny.gauge("esp32cam_uptime_seconds", "Time since boot", 1);
+    TEST_ASSERT_TRUE(tiny.isTruncated());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_admit_up_to_the_limit);
+    RUN_TEST(test_streaming_pass_scales_with_clients);
+    RUN_TEST(test_metrics_overflow_is_reported);
+    RUN_TEST(test_metrics_flow_through_the_sink);
+    return UNITY_END();
+}
@@ -0,0 +1,140 @@
+// Frame handles on driver buffers: clients get the driver's own buffer, it goes
+// back to the driver with the last reference and never before, and the pool
+// of handles holds up with several tasks wrapping and releasing at once.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <pthread.h>
+#include <atomic>
+
+#include "FakeCamera.h"
+#include "Frame.h"
+
+#define THREADS 4
+#define ROUNDS 200000
+
+static const uint8_t jpeg[] = {0xFF, 0xD8, 0xFF, 0xD9};
+
+static std::atomic<int> returned[THREADS];
+static camera_fb_t buffers[THREADS];
+
+static void giveBack(camera_fb_t *fb)
+{
+    returned[fb - buffers]++;
+}
+
+void setUp(void)
+{
+    FakeCamera::reset();
+    FakeCamera::add(jpeg, sizeof(jpeg), 8, 8);
+    camera_config_t config = {PIXFORMAT_JPEG, FRAMESIZE_VGA, 12, 2};
+    esp_camera_init(&config);
+}
+
+void tearDown(void)
+{
+}
+
+void test_clients_read_the_driver_buffer(void)
+{
+    camera_fb_t *fb = esp_camera_fb_get();
+    TEST_ASSERT_NOT_NULL(fb);
+    Frame *f = Frame::wrap(fb);
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL_PTR(fb->buf, f->getBuf());
+    TEST_ASSERT_EQUAL(fb->len, f->getSize());
+    f->release();
+}
+
+void test_buffer_goes_back_with_the_last_reference(void)
+{
+    Frame *f = Frame::wrap(esp_camera_fb_get());
+    TEST_ASSERT_EQUAL(1, FakeCamera::getOut());
+
+    // two clients sending it
+    f->retain();
+    f->retain();
+    f->release(); // the capture task is done with it
+    TEST_ASSERT_EQUAL(1, FakeCamera::getOut());
+    f->release();
+    TEST_ASSERT_EQUAL(1, FakeCamera::getOut());
+    f->release();
+    TEST_ASSERT_EQUAL(0, FakeCamera::getOut());
+
+    // released for good, it can't be picked up again
+    TEST_ASSERT_FALSE(f->tryRetain());
+}
+
+void test_full_pool_hands_the_buffer_straight_back(void)
+{
+    Frame *held[FRAME_POOL_SIZE];
+    for (int i = 0; i < FRAME_POOL_SIZE; i++)
+        held[i] = Frame::wrap(&buffers[0], giveBack);
+    returned[0] = 0;
+
+    TEST_ASSERT_NULL(Frame::wrap(&buffers[0], giveBack));
+    TEST_ASSERT_EQUAL(1, returned[0].load());
+
+    for (int i = 0; i < FRAME_POOL_SIZE; i++)
+        held[i]->release();
+    TEST_ASSERT_EQUAL(1 + FRAME_POOL_SIZE, returned[0].load());
+}
+
+// Every thread wraps its own buffer over and over while the others do the same,
+// checking nobody else got the slot it holds
+static void *churn(void *arg)
+{
+    long t = (long)arg;
+    for (int i = 0; i < ROUNDS; i++)
+    {
+        Frame *f = Frame::wrap(&buffers[t], giveBack);
+        if (f == NULL)
+            continue; // all slots taken this instant, the buffer went back already
+        if (f->getBuf() != buffers[t].buf)
+            return (void *)1;
+        f->retain();
+        f->release();
+        f->release();
+    }
+    return NULL;
+}
+
+void test_wrap_under_contention(void)
+{
+    static uint8_t data[THREADS][4];
+    pthread_t threads[THREADS];
+    for (long t = 0; t < THREADS; t++)
+    {
+        buffers[t].buf = data[t];
+        buffers[t].len = sizeof(data[t]);
+        returned[t] = 0;
+    }
+    for (long t = 0; t < THREADS; t++)
+        pthread_create(&threads[t], NULL, churn, (void *)t);
+
+    for (long t = 0; t < THREADS; t++)
+    {
+        void *failed;
+        pthread_join(threads[t], &failed);
+        TEST_ASSERT_NULL_MESSAGE(failed, "a slot was handed out twice");
+    }
+
+    // every buffer went back exactly once per wrap, and every slot is free again
+    for (int t = 0; t < THREADS; t++)
+        TEST_ASSERT_EQUAL(ROUNDS, returned[t].load());
+    Frame *held[FRAME_POOL_SIZE];
+    for (int i = 0; i < FRAME_POOL_SIZE; i++)
+        TEST_ASSERT_NOT_NULL(held[i] = Frame::wrap(&buffers[0], giveBack));
+    for (int i = 0; i < FRAME_POOL_SIZE; i++)
+        held[i]->release();
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_clients_read_the_driver_buffer);
+    RUN_TEST(test_buffer_goes_back_with_the_last_reference);
+    RUN_TEST(test_full_pool_hands_the_buffer_straight_back);
+    RUN_TEST(test_wrap_under_contention);
+    return UNITY_END();
+}
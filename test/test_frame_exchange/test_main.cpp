@@ -0,0 +1,140 @@
+// FrameExchange under load: one producer publishing as fast as it can and
+// several consumers on their own threads. No consumer may ever see a frame
+// whose buffer is being rewritten, frames only ever get newer, and the
+// producer never has to wait for anybody.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <pthread.h>
+#include <atomic>
+
+#include "Frame.h"
+
+#define CONSUMERS 4
+#define FRAMES 200000
+#define FRAME_SIZE 256
+// every consumer holds one frame at most, the exchange one and the producer
+// one it is filling: with one more there is always a free buffer
+#define BUFFERS (CONSUMERS + 3)
+
+static camera_fb_t fbs[BUFFERS];
+static uint8_t data[BUFFERS][FRAME_SIZE];
+static std::atomic<bool> busy[BUFFERS];
+static FrameExchange exchange;
+static std::atomic<bool> done;
+
+static void giveBack(camera_fb_t *fb)
+{
+    busy[fb - fbs].store(false, std::memory_order_release);
+}
+
+static void *produce(void *arg)
+{
+    uint32_t *waits = (uint32_t *)arg;
+    for (uint32_t n = 1; n <= FRAMES; n++)
+    {
+        int i = 0;
+        for (;;)
+        {
+            bool expected = false;
+            if (busy[i].compare_exchange_strong(expected, true, std::memory_order_acquire))
+                break;
+            if (++i == BUFFERS)
+            {
+                (*waits)++;
+                i = 0;
+            }
+        }
+
+        // the whole buffer says which frame it is
+        memset(data[i], n & 0xFF, FRAME_SIZE);
+        memcpy(data[i], &n, sizeof(n));
+        fbs[i].buf = data[i];
+        fbs[i].len = FRAME_SIZE;
+        Frame *f = Frame::wrap(&fbs[i], giveBack);
+        if (f)
+            exchange.publish(f);
+    }
+    done = true;
+    return NULL;
+}
+
+struct Consumer
+{
+    pthread_t thread;
+    uint32_t frames;
+    uint32_t torn;
+    uint32_t backwards;
+};
+
+static void *consume(void *arg)
+{
+    Consumer &c = *(Consumer *)arg;
+    uint32_t last = 0, lastSeq = 0;
+    while (!done)
+    {
+        Frame *f = exchange.acquire();
+        if (f == NULL)
+            continue;
+
+        uint32_t n;
+        memcpy(&n, f->getBuf(), sizeof(n));
+        for (int j = sizeof(n); j < FRAME_SIZE; j++)
+            if (f->getBuf()[j] != (n & 0xFF))
+            {
+                c.torn++;
+                break;
+            }
+        if (n < last || f->getSeq() < lastSeq)
+            c.backwards++;
+        last = n;
+        lastSeq = f->getSeq();
+        c.frames++;
+        f->release();
+    }
+    return NULL;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_no_torn_frames(void)
+{
+    uint32_t waits = 0;
+    Consumer consumers[CONSUMERS] = {};
+    pthread_t producer;
+
+    for (int i = 0; i < CONSUMERS; i++)
+        pthread_create(&consumers[i].thread, NULL, consume, &consumers[i]);
+    pthread_create(&producer, NULL, produce, &waits);
+    pthread_join(producer, NULL);
+    for (int i = 0; i < CONSUMERS; i++)
+        pthread_join(consumers[i].thread, NULL);
+
+    for (int i = 0; i < CONSUMERS; i++)
+    {
+        TEST_ASSERT_EQUAL_MESSAGE(0, consumers[i].torn, "a consumer read a frame being rewritten");
+        TEST_ASSERT_EQUAL_MESSAGE(0, consumers[i].backwards, "a consumer got an older frame after a newer one");
+        TEST_ASSERT_GREATER_THAN(0, consumers[i].frames);
+    }
+    TEST_ASSERT_EQUAL_MESSAGE(0, waits, "the producer found every buffer held");
+
+    // the newest frame is the last one published, and dropping it frees everything
+    Frame *f = exchange.acquire();
+    uint32_t n;
+    memcpy(&n, f->getBuf(), sizeof(n));
+    TEST_ASSERT_EQUAL(FRAMES, n);
+    f->release();
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_no_torn_frames);
+    return UNITY_END();
+}
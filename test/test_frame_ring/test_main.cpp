@@ -0,0 +1,401 @@
+// FrameRing: frames of changing sizes going round the ring many times stay
+// intact and never overlap, a reader copying out while frames come in only
+// ever gets whole ones, and what adding and copying cost. Then a clip download
+// through the web server over a slow link, which must not hold up other
+// requests in the meantime, and one whose viewer stops reading, which must not
+// hold on to the download's place.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "FrameRing.h"
+#include "ClipClient.h"
+#include "HttpServer.h"
+
+#define BUDGET (256 * 1024)
+#define MAX_FRAME (24 * 1024)
+#define ROUNDS 20000
+#define CLIP_BUDGET (16 * 1024 * 1024)
+
+static uint8_t frame[MAX_FRAME];
+static uint32_t seed = 1;
+
+static size_t randomSize(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return 2000 + (seed >> 8) % (MAX_FRAME - 2000);
+}
+
+// a frame whose every byte follows from its number
+static void paint(uint8_t *buf, size_t len, uint32_t n)
+{
+    for (size_t i = 0; i < len; i++)
+        buf[i] = (uint8_t)(n * 13 + i * 7 + (i >> 8));
+}
+
+static bool intact(const uint8_t *buf, size_t len, uint32_t n)
+{
+    for (size_t i = 0; i < len; i++)
+        if (buf[i] != (uint8_t)(n * 13 + i * 7 + (i >> 8)))
+            return false;
+    return true;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_wraparound_keeps_frames_whole(void)
+{
+    FrameRing ring;
+    TEST_ASSERT_TRUE(ring.begin(BUDGET));
+    std::vector<uint32_t> sizes;
+    uint64_t total = 0;
+    uint8_t out[MAX_FRAME];
+
+    for (uint32_t n = 0; n < ROUNDS; n++)
+    {
+        size_t len = randomSize();
+        paint(frame, len, n);
+        TEST_ASSERT_TRUE(ring.add(frame, len, n * 40));
+        sizes.push_back(len);
+        total += len;
+
+        // every frame still held is the one that went in under its number
+        TEST_ASSERT_LESS_OR_EQUAL(BUDGET, ring.getUsed());
+        uint32_t held = ring.getFrames();
+        TEST_ASSERT_EQUAL(n + 1, ring.end());
+        if (n % 97 == 0)
+            for (uint32_t id = ring.end() - held; id != ring.end(); id++)
+            {
+                uint32_t ms;
+                size_t got = ring.copy(id, out, sizeof(out), ms);
+                TEST_ASSERT_EQUAL(sizes[id], got);
+                TEST_ASSERT_EQUAL(id * 40, ms);
+                TEST_ASSERT_TRUE(intact(out, got, id));
+            }
+
+        // and the one before those is gone
+        uint32_t ms;
+        if (held <= n)
+            TEST_ASSERT_EQUAL(0, ring.copy(ring.end() - held - 1, out, sizeof(out), ms));
+    }
+
+    TEST_ASSERT_EQUAL((uint32_t)total, ring.getWritten());
+    TEST_ASSERT_EQUAL(ROUNDS - ring.getFrames(), ring.getEvicted());
+    TEST_ASSERT_EQUAL((ring.getFrames() - 1) * 40, ring.getSpan());
+    // nothing more than a frame's worth of the end is ever left unused
+    TEST_ASSERT_GREATER_THAN(BUDGET - 2 * MAX_FRAME, ring.getUsed());
+
+    // frames over half the ring are left out rather than emptying it
+    TEST_ASSERT_FALSE(ring.add(frame, BUDGET / 2 + 1, 0));
+}
+
+struct Reader
+{
+    FrameRing *ring;
+    std::atomic<bool> done;
+    uint32_t copies;
+    uint32_t torn;
+    uint32_t gone;
+};
+
+static void *read(void *arg)
+{
+    Reader &r = *(Reader *)arg;
+    static uint8_t out[MAX_FRAME];
+    while (!r.done)
+    {
+        // always the oldest, the one most likely to be evicted under it
+        uint32_t id = r.ring->end() - r.ring->getFrames();
+        uint32_t ms;
+        size_t len = r.ring->copy(id, out, sizeof(out), ms);
+        if (len == 0)
+        {
+            r.gone++;
+            continue;
+        }
+        r.copies++;
+        if (!intact(out, len, ms))
+            r.torn++;
+    }
+    return NULL;
+}
+
+void test_copies_while_recording(void)
+{
+    FrameRing ring;
+    TEST_ASSERT_TRUE(ring.begin(BUDGET));
+    Reader r;
+    r.ring = &ring;
+    r.done = false;
+    r.copies = r.torn = r.gone = 0;
+    pthread_t thread;
+    pthread_create(&thread, NULL, read, &r);
+
+    uint32_t start = micros();
+    uint64_t bytes = 0;
+    for (uint32_t n = 0; n < ROUNDS; n++)
+    {
+        size_t len = randomSize();
+        paint(frame, len, n);
+        ring.add(frame, len, n); // the frame number as its time, for the reader to check
+        bytes += len;
+    }
+    uint32_t us = micros() - start;
+    r.done = true;
+    pthread_join(thread, NULL);
+
+    printf("adding %.0f MB/s while copying out %u frames, %u evicted before they could be\n",
+           bytes / (double)us, (unsigned)r.copies, (unsigned)r.gone);
+    TEST_ASSERT_EQUAL(0, r.torn);
+    TEST_ASSERT_GREATER_THAN(0, r.copies);
+}
+
+void test_throughput_and_memory(void)
+{
+    FrameRing ring;
+    TEST_ASSERT_TRUE(ring.begin(BUDGET));
+    static uint8_t out[MAX_FRAME];
+    paint(frame, MAX_FRAME, 0);
+
+    uint32_t start = micros();
+    for (uint32_t n = 0; n < ROUNDS; n++)
+        ring.add(frame, 20000, n);
+    uint32_t addUs = micros() - start;
+
+    start = micros();
+    uint32_t copied = 0;
+    for (uint32_t n = 0; n < ROUNDS; n++)
+    {
+        uint32_t ms;
+        copied += ring.copy(ring.end() - 1 - n % ring.getFrames(), out, sizeof(out), ms);
+    }
+    uint32_t copyUs = micros() - start;
+
+    printf("add %.2f us, copy %.2f us per 20 KB frame; %u KB ring + %u bytes of index hold %u frames\n",
+           addUs / (double)ROUNDS, copyUs / (double)ROUNDS, BUDGET / 1024,
+           (unsigned)(RING_INDEX * 3 * sizeof(uint32_t)), (unsigned)ring.getFrames());
+    TEST_ASSERT_EQUAL(ROUNDS * 20000u, copied);
+    TEST_ASSERT_EQUAL(BUDGET / 20000, ring.getFrames());
+}
+
+// ==== a clip download through the web server ====
+
+static FrameRing clipRing;
+static HttpServer server(0);
+static std::atomic<bool> running;
+
+static bool clipPump(void *ctx, bool stalled)
+{
+    ClipClient *clip = (ClipClient *)ctx;
+    if (!stalled && clip->pump())
+        return true;
+    delete clip;
+    return false;
+}
+
+static void handleClip(void)
+{
+    ClipClient *clip = new ClipClient(clipRing, false);
+    int status = clip->prepare(clipRing.end() - clipRing.getFrames(), clipRing.end());
+    if (status != 200)
+    {
+        delete clip;
+        server.send(status, "text/plain", "no clip");
+        return;
+    }
+    int sock = server.pump(clipPump, clip);
+    if (sock < 0)
+    {
+        delete clip;
+        server.send(503, "text/plain", "busy");
+        return;
+    }
+    clip->begin(sock);
+}
+
+static void handlePing(void)
+{
+    server.send(200, "text/plain", "pong");
+}
+
+static void *serve(void *)
+{
+    while (running)
+        server.handleClient();
+    return NULL;
+}
+
+static int connectServer(int rcvbuf = 0)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(server.getPort());
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (rcvbuf)
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    connect(sock, (struct sockaddr *)&addr, sizeof(addr));
+    return sock;
+}
+
+void test_clip_download_does_not_block_the_server(void)
+{
+    // more than the sockets can buffer between the server and the viewer
+    TEST_ASSERT_TRUE(clipRing.begin(CLIP_BUDGET));
+    uint32_t n;
+    for (n = 0; n < RING_INDEX - 100; n++)
+    {
+        paint(frame, MAX_FRAME, n);
+        clipRing.add(frame, MAX_FRAME, n);
+    }
+    uint32_t first = clipRing.end() - clipRing.getFrames();
+    uint32_t count = clipRing.getFrames();
+
+    // a viewer reading slowly through a small window
+    int clip = connectServer(8192);
+    send(clip, "GET /clip HTTP/1.1\r\n\r\n", 22, 0);
+
+    // a second download has to wait its turn
+    while (server.pumping() == 0)
+        usleep(1000);
+    int other = connectServer();
+    send(other, "GET /clip HTTP/1.1\r\n\r\n", 22, 0);
+    char buf[16384];
+    int got = recv(other, buf, sizeof(buf) - 1, 0);
+    TEST_ASSERT_GREATER_THAN(0, got);
+    buf[got] = 0;
+    TEST_ASSERT_EQUAL(0, memcmp(buf, "HTTP/1.1 503", 12));
+    close(other);
+
+    std::string in;
+    uint32_t worst = 0;
+    int pings = 0;
+    int ping = connectServer();
+    for (;;)
+    {
+        // meanwhile the server answers at once, and recording goes on
+        uint32_t t = micros();
+        send(ping, "GET /ping HTTP/1.1\r\n\r\n", 22, 0);
+        std::string answer;
+        while (answer.find("pong") == std::string::npos)
+        {
+            int r = recv(ping, buf, sizeof(buf), 0);
+            TEST_ASSERT_GREATER_THAN(0, r);
+            answer.append(buf, r);
+        }
+        t = micros() - t;
+        if (t > worst)
+            worst = t;
+        if (++pings % 10 == 0)
+        {
+            paint(frame, 5000, n);
+            clipRing.add(frame, 5000, n++);
+        }
+
+        int r = recv(clip, buf, sizeof(buf), 0);
+        if (r <= 0)
+            break;
+        in.append(buf, r);
+        usleep(1000);
+    }
+    close(ping);
+    close(clip);
+
+    // every frame of the clip came through whole and in order, none of the
+    // ones recorded meanwhile
+    uint32_t frames = 0, last = 0;
+    size_t at = 0;
+    while ((at = in.find("Content-Length: ", at)) != std::string::npos)
+    {
+        size_t len = strtoul(in.c_str() + at + 16, NULL, 10);
+        uint32_t ms = strtoul(in.c_str() + in.find("X-Timestamp: ", at) + 13, NULL, 10);
+        size_t body = in.find("\r\n\r\n", at) + 4;
+        TEST_ASSERT_TRUE(body + len <= in.size());
+        TEST_ASSERT_TRUE(intact((const uint8_t *)in.data() + body, len, ms));
+        TEST_ASSERT_TRUE(frames == 0 || ms > last);
+        TEST_ASSERT_TRUE(ms >= first && ms < first + count);
+        last = ms;
+        frames++;
+        at = body + len;
+    }
+    printf("%u of %u frames, %u bytes downloaded; %d requests served meanwhile, slowest in %u us\n",
+           (unsigned)frames, (unsigned)count, (unsigned)in.size(), pings, (unsigned)worst);
+    TEST_ASSERT_EQUAL(count, frames);
+    TEST_ASSERT_EQUAL(first + count - 1, last);
+    TEST_ASSERT_GREATER_THAN(10, pings);
+    TEST_ASSERT_LESS_THAN(50000, worst);
+    TEST_ASSERT_EQUAL(0, server.pumping());
+}
+
+static int status(int sock)
+{
+    char buf[16];
+    int got = recv(sock, buf, 12, MSG_WAITALL);
+    return got == 12 ? atoi(buf + 9) : -1;
+}
+
+void test_stalled_download_is_given_up(void)
+{
+    // a viewer that takes the headers and then stops reading
+    int stalled = connectServer(8192);
+    send(stalled, "GET /clip HTTP/1.1\r\n\r\n", 22, 0);
+    TEST_ASSERT_EQUAL(200, status(stalled));
+    uint32_t start = millis();
+    while (server.pumping() && millis() - start < HTTP_IDLE_TIMEOUT + 3000)
+        usleep(10000);
+    uint32_t gone = millis() - start;
+    printf("stalled download given up after %u ms\n", (unsigned)gone);
+    TEST_ASSERT_EQUAL(0, server.pumping());
+    TEST_ASSERT_GREATER_OR_EQUAL(HTTP_IDLE_TIMEOUT, gone);
+    close(stalled);
+
+    // and the next download has its place
+    int next = connectServer();
+    send(next, "GET /clip HTTP/1.1\r\n\r\n", 22, 0);
+    TEST_ASSERT_EQUAL(200, status(next));
+    close(next);
+    while (server.pumping())
+        usleep(1000);
+}
+
+int main(int argc, char **argv)
+{
+    signal(SIGPIPE, SIG_IGN); // a viewer hanging up mid-download, as lwIP reports it
+    server.on("/clip", HTTP_METHOD_GET, handleClip);
+    server.on("/ping", HTTP_METHOD_GET, handlePing);
+    if (!server.begin())
+        return 1;
+    running = true;
+    pthread_t serving;
+    pthread_create(&serving, NULL, serve, NULL);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_wraparound_keeps_frames_whole);
+    RUN_TEST(test_copies_while_recording);
+    RUN_TEST(test_throughput_and_memory);
+    RUN_TEST(test_clip_download_does_not_block_the_server);
+    RUN_TEST(test_stalled_download_is_given_up);
+    int failures = UNITY_END();
+
+    running = false;
+    close(connectServer());
+    pthread_join(serving, NULL);
+    return failures;
+}
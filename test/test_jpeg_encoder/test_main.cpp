@@ -0,0 +1,298 @@
+// JpegEncoder on SVGA frames of a made-up scene with the detail of a room -
+// gradients, hard edges, fine texture and sensor noise: bytes per frame over
+// the quality setting, which at its top has to fit the encoded frame buffers,
+// and how fast YUV422 and grayscale frames encode. What every step of the
+// scale looks like decoded again, and with libjpeg around, next to what it
+// makes of the same frame. Then a frame that doesn't fit anyway, which has to
+// bring quality down until they do.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <math.h>
+#include <vector>
+#ifdef HAVE_LIBJPEG
+#include <stdio.h>
+#include <jpeglib.h>
+#endif
+
+#include "JpegEncoder.h"
+#include "JpegScaler.h"
+#include "QualityController.h"
+#include "BufferPool.h"
+
+#define WIDTH 800
+#define HEIGHT 600
+#define FRAMES 20
+
+static uint8_t yuyv[WIDTH * HEIGHT * 2];
+static uint8_t gray[WIDTH * HEIGHT];
+static std::vector<uint8_t> out(WIDTH * HEIGHT * 2);
+static uint32_t seed = 1;
+
+static int noise(int levels)
+{
+    seed = seed * 1103515245 + 12345;
+    return (int)((seed >> 16) % (2 * levels + 1)) - levels;
+}
+
+static uint8_t clamp(int v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static void paint(void)
+{
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+        {
+            int v = 40 + x * 120 / WIDTH + y * 60 / HEIGHT; // light falling across the room
+            if ((x / 100 + y / 75) % 3 == 0)
+                v += 70; // furniture, posters
+            if (x > 500 && y > 300)
+                v += ((x ^ y) & 4) ? 25 : -25; // a patterned rug
+            if (y % 150 < 2 || x % 200 < 2)
+                v = 20; // frames and shelves
+            v += noise(5);
+            gray[y * WIDTH + x] = clamp(v);
+            yuyv[(y * WIDTH + x) * 2] = clamp(v);
+            yuyv[(y * WIDTH + x) * 2 + 1] = clamp(128 + ((x & 1) ? y * 40 / HEIGHT : -x * 30 / WIDTH) + noise(2));
+        }
+}
+
+// PSNR of a decoded luma plane against the scene, box filtered when the plane
+// is factor times smaller
+static float psnr(const uint8_t *plane, int stride, int factor)
+{
+    double se = 0;
+    int w = WIDTH / factor, h = HEIGHT / factor;
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+        {
+            int sum = 0;
+            for (int j = 0; j < factor; j++)
+                for (int i = 0; i < factor; i++)
+                    sum += gray[(y * factor + j) * WIDTH + x * factor + i];
+            double d = plane[y * stride + x] - (double)sum / (factor * factor);
+            se += d * d;
+        }
+    double mse = se / (w * h);
+    return mse > 0 ? 10 * log10(255.0 * 255.0 / mse) : 99;
+}
+
+#ifdef HAVE_LIBJPEG
+// the luma of a whole frame, as libjpeg decodes it
+static void referenceDecode(const uint8_t *jpg, size_t len, uint8_t *luma)
+{
+    jpeg_decompress_struct d;
+    jpeg_error_mgr err;
+    d.err = jpeg_std_error(&err);
+    jpeg_create_decompress(&d);
+    jpeg_mem_src(&d, (unsigned char *)jpg, len);
+    jpeg_read_header(&d, TRUE);
+    d.out_color_space = JCS_GRAYSCALE;
+    jpeg_start_decompress(&d);
+    while (d.output_scanline < d.output_height)
+    {
+        JSAMPROW row = luma + d.output_scanline * WIDTH;
+        jpeg_read_scanlines(&d, &row, 1);
+    }
+    jpeg_finish_decompress(&d);
+    jpeg_destroy_decompress(&d);
+}
+
+// the scene's luma as libjpeg encodes it at the same quality
+static size_t referenceEncode(int quality, std::vector<uint8_t> &jpg)
+{
+    jpeg_compress_struct c;
+    jpeg_error_mgr err;
+    c.err = jpeg_std_error(&err);
+    jpeg_create_compress(&c);
+    unsigned char *buf = NULL;
+    unsigned long len = 0;
+    jpeg_mem_dest(&c, &buf, &len);
+    c.image_width = WIDTH;
+    c.image_height = HEIGHT;
+    c.input_components = 1;
+    c.in_color_space = JCS_GRAYSCALE;
+    jpeg_set_defaults(&c);
+    jpeg_set_quality(&c, quality, TRUE);
+    jpeg_start_compress(&c, TRUE);
+    while (c.next_scanline < c.image_height)
+    {
+        JSAMPROW row = gray + c.next_scanline * WIDTH;
+        jpeg_write_scanlines(&c, &row, 1);
+    }
+    jpeg_finish_compress(&c);
+    jpeg_destroy_compress(&c);
+    jpg.assign(buf, buf + len);
+    free(buf);
+    return len;
+}
+#endif
+
+static int setQuality(sensor_t *s, int quality)
+{
+    s->status.quality = quality;
+    return 0;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_quality_scale(void)
+{
+    TEST_ASSERT_EQUAL(1, JpegEncoder::qualityFor(0));
+    TEST_ASSERT_EQUAL(JPEG_QUALITY_CEILING, JpegEncoder::qualityFor(63));
+    TEST_ASSERT_EQUAL(JPEG_QUALITY_CEILING, JpegEncoder::qualityFor(100));
+    for (int s = 1; s <= 63; s++)
+        TEST_ASSERT_GREATER_OR_EQUAL(JpegEncoder::qualityFor(s - 1), JpegEncoder::qualityFor(s));
+}
+
+void test_bytes_per_frame(void)
+{
+    JpegEncoder encoder;
+    size_t slab = BufferPool::jpegBudget(WIDTH, HEIGHT, 63);
+    const int settings[] = {10, 30, 53, 63};
+    size_t top = 0;
+    for (int setting : settings)
+    {
+        encoder.setQuality(JpegEncoder::qualityFor(setting));
+        size_t len = encoder.encodeYuv422(yuyv, WIDTH, HEIGHT, out.data(), out.size());
+        TEST_ASSERT_GREATER_THAN(0, len);
+        printf("setting %2d, quality %2d: %6u bytes a frame\n", setting, JpegEncoder::qualityFor(setting), (unsigned)len);
+        top = len;
+    }
+
+    // the old top of the scale, for comparison
+    encoder.setQuality(100);
+    size_t full = encoder.encodeYuv422(yuyv, WIDTH, HEIGHT, out.data(), out.size());
+    printf("quality 100: %u bytes a frame, %u KB buffers\n", (unsigned)full, (unsigned)(slab / 1024));
+
+    TEST_ASSERT_LESS_OR_EQUAL(slab, top);
+    TEST_ASSERT_GREATER_THAN(top, full);
+}
+
+// what the viewer sees at every step: decoded at half size here, in full by
+// libjpeg when it is around, where the same quality from it is no better
+void test_quality_steps(void)
+{
+    JpegEncoder encoder;
+    JpegScaler scaler;
+    std::vector<uint8_t> half(WIDTH * HEIGHT);
+    const int settings[] = {0, 10, 30, 53, 63};
+    const float floors[] = {22, 30, 33, 35, 37}; // dB
+    float last = 0;
+    for (int s = 0; s < 5; s++)
+    {
+        int quality = JpegEncoder::qualityFor(settings[s]);
+        encoder.setQuality(quality);
+        size_t len = encoder.encodeYuv422(yuyv, WIDTH, HEIGHT, out.data(), out.size());
+        TEST_ASSERT_GREATER_THAN(0, len);
+        TEST_ASSERT_GREATER_THAN(0, scaler.scale(out.data(), len, 2, half.data(), half.size()));
+        float decoded = psnr(scaler.getPlane(), scaler.getStride(), 2);
+        printf("quality %2d: PSNR %.1f dB at half size", quality, decoded);
+        TEST_ASSERT_GREATER_THAN_FLOAT(floors[s], decoded);
+        TEST_ASSERT_GREATER_THAN_FLOAT(last, decoded);
+        last = decoded;
+
+#ifdef HAVE_LIBJPEG
+        static uint8_t luma[WIDTH * HEIGHT];
+        referenceDecode(out.data(), len, luma);
+        float full = psnr(luma, WIDTH, 1);
+
+        size_t ours = encoder.encodeGray(gray, WIDTH, HEIGHT, out.data(), out.size());
+        std::vector<uint8_t> ref;
+        size_t theirs = referenceEncode(quality, ref);
+        referenceDecode(ref.data(), theirs, luma);
+        float reference = psnr(luma, WIDTH, 1);
+        printf(", %.1f dB in full; gray %u bytes, libjpeg %u bytes and %.1f dB", full, (unsigned)ours,
+               (unsigned)theirs, reference);
+        TEST_ASSERT_GREATER_THAN_FLOAT(floors[s], full);
+        TEST_ASSERT_GREATER_THAN_FLOAT(reference - 0.5f, full);
+        TEST_ASSERT_LESS_THAN(theirs * 11 / 10, ours);
+#endif
+        printf("\n");
+    }
+}
+
+void test_throughput(void)
+{
+    JpegEncoder encoder;
+    encoder.setQuality(JpegEncoder::qualityFor(53));
+
+    size_t yuvBytes = 0, grayBytes = 0;
+    uint32_t start = micros();
+    for (int i = 0; i < FRAMES; i++)
+        yuvBytes += encoder.encodeYuv422(yuyv, WIDTH, HEIGHT, out.data(), out.size());
+    uint32_t yuvUs = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < FRAMES; i++)
+        grayBytes += encoder.encodeGray(gray, WIDTH, HEIGHT, out.data(), out.size());
+    uint32_t grayUs = micros() - start;
+
+    printf("YUV422: %.1f MB/s in, %.1f ms and %u bytes a frame\n", (double)sizeof(yuyv) * FRAMES / yuvUs,
+           yuvUs / 1000.0 / FRAMES, (unsigned)(yuvBytes / FRAMES));
+    printf("gray:   %.1f MB/s in, %.1f ms and %u bytes a frame\n", (double)sizeof(gray) * FRAMES / grayUs,
+           grayUs / 1000.0 / FRAMES, (unsigned)(grayBytes / FRAMES));
+    TEST_ASSERT_GREATER_THAN(0, yuvBytes);
+    TEST_ASSERT_GREATER_THAN(0, grayBytes);
+}
+
+void test_overflow_steps_quality_down(void)
+{
+    sensor_t sensor;
+    memset(&sensor, 0, sizeof(sensor));
+    sensor.set_quality = setQuality;
+    QualityController qc;
+    qc.setEnabled(true);
+    qc.setQuality(63);
+
+    // buffers too small for the top of the scale
+    JpegEncoder encoder;
+    encoder.setQuality(JpegEncoder::qualityFor(63));
+    size_t capacity = encoder.encodeYuv422(yuyv, WIDTH, HEIGHT, out.data(), out.size()) * 2 / 3;
+
+    int dropped = 0;
+    for (int i = 0; i < 30; i++)
+    {
+        encoder.setQuality(JpegEncoder::qualityFor(qc.getQuality()));
+        if (encoder.encodeYuv422(yuyv, WIDTH, HEIGHT, out.data(), capacity) == 0)
+        {
+            dropped++;
+            qc.overflow(&sensor);
+        }
+    }
+    printf("%d frames dropped on the way down to quality %d\n", dropped, qc.getQuality());
+    TEST_ASSERT_GREATER_THAN(0, dropped);
+    TEST_ASSERT_LESS_THAN(10, dropped);
+    TEST_ASSERT_EQUAL(qc.getQuality(), qc.getCeiling());
+    TEST_ASSERT_EQUAL(63 - qc.getQuality(), sensor.status.quality);
+
+    // a link with room to spare doesn't take it back up past what fits
+    int fitted = qc.getQuality();
+    for (int i = 0; i < 20; i++)
+        qc.step(10000, 10, 10000000);
+    TEST_ASSERT_EQUAL(fitted, qc.getQuality());
+
+    // until the operator asks for more again
+    qc.setQuality(63);
+    TEST_ASSERT_EQUAL(63, qc.getCeiling());
+}
+
+int main(int argc, char **argv)
+{
+    paint();
+    UNITY_BEGIN();
+    RUN_TEST(test_quality_scale);
+    RUN_TEST(test_bytes_per_frame);
+    RUN_TEST(test_quality_steps);
+    RUN_TEST(test_throughput);
+    RUN_TEST(test_overflow_steps_quality_down);
+    return UNITY_END();
+}
@@ -0,0 +1,130 @@
+// JpegScaler at 1/2, 1/4 and 1/8 against a box filter of the original
+// pixels: PSNR of the luma it decodes in the DCT domain, the thumbnail JPEG
+// it writes, and time per frame.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <math.h>
+
+#include "JpegEncoder.h"
+#include "JpegScaler.h"
+
+#define WIDTH 800
+#define HEIGHT 600
+#define RUNS 20
+
+static uint8_t *yuyv;
+static uint8_t *luma;
+static uint8_t *jpg;
+static size_t jpgLen;
+static uint8_t *out;
+static JpegScaler scaler;
+
+// a scene with smooth shading, edges and fine texture
+static void makeScene(void)
+{
+    yuyv = (uint8_t *)malloc(WIDTH * HEIGHT * 2);
+    luma = (uint8_t *)malloc(WIDTH * HEIGHT);
+    uint32_t seed = 7;
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+        {
+            seed = seed * 1103515245 + 12345;
+            float v = 128 + 60 * sinf(x / 37.0f) * cosf(y / 23.0f) + (seed >> 29);
+            if ((x - 400) * (x - 400) + (y - 300) * (y - 300) < 150 * 150)
+                v += 50;
+            if (x / 100 % 2 && y > 450)
+                v -= 70;
+            uint8_t l = v < 0 ? 0 : v > 255 ? 255 : v;
+            luma[y * WIDTH + x] = l;
+            yuyv[(y * WIDTH + x) * 2] = l;
+            yuyv[(y * WIDTH + x) * 2 + 1] = x & 1 ? 128 + y / 8 : 160 - x / 8;
+        }
+
+    JpegEncoder encoder;
+    encoder.setQuality(90);
+    jpg = (uint8_t *)malloc(WIDTH * HEIGHT);
+    jpgLen = encoder.encodeYuv422(yuyv, WIDTH, HEIGHT, jpg, WIDTH * HEIGHT);
+    out = (uint8_t *)malloc(WIDTH * HEIGHT);
+}
+
+// PSNR of a plane against factor x factor box averages of the original luma
+static float psnr(const uint8_t *plane, int stride, int factor)
+{
+    double se = 0;
+    int w = WIDTH / factor, h = HEIGHT / factor;
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+        {
+            int sum = 0;
+            for (int j = 0; j < factor; j++)
+                for (int i = 0; i < factor; i++)
+                    sum += luma[(y * factor + j) * WIDTH + x * factor + i];
+            double d = plane[y * stride + x] - (double)sum / (factor * factor);
+            se += d * d;
+        }
+    double mse = se / (w * h);
+    return mse > 0 ? 10 * log10(255.0 * 255.0 / mse) : 99;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+static void checkScale(int factor, float minPsnr)
+{
+    uint32_t t = micros();
+    size_t len = 0;
+    for (int i = 0; i < RUNS; i++)
+        len = scaler.scale(jpg, jpgLen, factor, out, WIDTH * HEIGHT);
+    t = micros() - t;
+    TEST_ASSERT_GREATER_THAN(0, len);
+    TEST_ASSERT_EQUAL(WIDTH / factor, scaler.getWidth());
+    TEST_ASSERT_EQUAL(HEIGHT / factor, scaler.getHeight());
+    float decoded = psnr(scaler.getPlane(), scaler.getStride(), factor);
+
+    // the thumbnail as it goes out, seen at 1/8 of its size
+    TEST_ASSERT_NOT_NULL(scaler.preview(out, len));
+    float sent = psnr(scaler.getPlane(), scaler.getStride(), factor * 8);
+
+    printf("1/%d: %6.2f ms/frame, %6u bytes, PSNR %.1f dB decoded, %.1f dB sent\n",
+           factor, t / 1000.0f / RUNS, (unsigned)len, decoded, sent);
+    TEST_ASSERT_GREATER_THAN_FLOAT(minPsnr, decoded);
+    TEST_ASSERT_GREATER_THAN_FLOAT(minPsnr, sent);
+}
+
+void test_half(void)
+{
+    checkScale(2, 30);
+}
+
+void test_quarter(void)
+{
+    checkScale(4, 30);
+}
+
+void test_eighth(void)
+{
+    checkScale(8, 30);
+}
+
+void test_rejects_what_it_cant_do(void)
+{
+    TEST_ASSERT_EQUAL(0, scaler.scale(jpg, jpgLen, 3, out, WIDTH * HEIGHT));
+    TEST_ASSERT_EQUAL(0, scaler.scale(jpg, jpgLen, 2, out, 100));
+}
+
+int main(int argc, char **argv)
+{
+    makeScene();
+    UNITY_BEGIN();
+    RUN_TEST(test_half);
+    RUN_TEST(test_quarter);
+    RUN_TEST(test_eighth);
+    RUN_TEST(test_rejects_what_it_cant_do);
+    return UNITY_END();
+}
@@ -0,0 +1,149 @@
+// MotionDetector replaying made-up scenes: sensor noise and an exposure change
+// are not motion, a square walking across the picture is, in the cells it
+// crosses, and the event ends MOTION_HOLD ms after it stops. The same scene
+// encoded as JPEG goes through the DC-only path, with a frame height that
+// isn't a multiple of 8.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+
+#include "MotionDetector.h"
+#include "JpegEncoder.h"
+
+#define WIDTH 320
+#define HEIGHT 236 // 29.5 blocks: the last block row is only half in the picture
+#define FRAME_MS 200
+
+static uint8_t frame[WIDTH * HEIGHT];
+static uint32_t seed = 1;
+
+// a textured background, noise of a few levels on top, brightness scaled by
+// gain/16, and a bright square at (sx, sy) unless sx < 0
+static void paint(int gain, int sx, int sy)
+{
+    for (int y = 0; y < HEIGHT; y++)
+        for (int x = 0; x < WIDTH; x++)
+        {
+            seed = seed * 1103515245 + 12345;
+            int v = 60 + ((x / 20 + y / 20) & 1) * 40 + (int)((seed >> 16) % 7) - 3;
+            if (sx >= 0 && x >= sx && x < sx + 40 && y >= sy && y < sy + 40)
+                v = 230;
+            v = v * gain / 16;
+            frame[y * WIDTH + x] = v > 255 ? 255 : v;
+        }
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_noise_and_exposure_are_not_motion(void)
+{
+    MotionDetector m;
+    uint32_t now = 1000;
+    for (int i = 0; i < 20; i++, now += FRAME_MS)
+    {
+        paint(16, -1, 0);
+        TEST_ASSERT_FALSE(m.analyze(frame, WIDTH, HEIGHT, WIDTH, 1, now));
+    }
+    // the sensor brightening everything by an eighth, then settling there
+    for (int i = 0; i < 20; i++, now += FRAME_MS)
+    {
+        paint(18, -1, 0);
+        TEST_ASSERT_FALSE(m.analyze(frame, WIDTH, HEIGHT, WIDTH, 1, now));
+    }
+    TEST_ASSERT_EQUAL(0, m.getEventCount());
+    TEST_ASSERT_EQUAL(40, m.getFrames());
+}
+
+void test_moving_square_makes_one_event(void)
+{
+    MotionDetector m;
+    uint32_t now = 1000;
+    for (int i = 0; i < 10; i++, now += FRAME_MS)
+    {
+        paint(16, -1, 0);
+        m.analyze(frame, WIDTH, HEIGHT, WIDTH, 1, now);
+    }
+
+    // across the middle, left to right
+    uint32_t started = now;
+    for (int x = 20; x + 40 < WIDTH; x += 20, now += FRAME_MS)
+    {
+        paint(16, x, 100);
+        m.analyze(frame, WIDTH, HEIGHT, WIDTH, 1, now);
+        TEST_ASSERT_TRUE(m.isActive());
+        // the square's cells, and nothing in the top or bottom rows
+        TEST_ASSERT_EQUAL(0, m.getMask(0));
+        TEST_ASSERT_EQUAL(0, m.getMask(MOTION_GRID_Y - 1));
+    }
+    uint32_t stopped = now - FRAME_MS;
+
+    // gone: the event lasts until nothing has moved for MOTION_HOLD
+    while (m.isActive() && now < stopped + 2 * MOTION_HOLD)
+    {
+        paint(16, -1, 0);
+        m.analyze(frame, WIDTH, HEIGHT, WIDTH, 1, now);
+        now += FRAME_MS;
+    }
+    TEST_ASSERT_FALSE(m.isActive());
+    TEST_ASSERT_EQUAL(1, m.getEventCount());
+
+    MotionEvent e = m.event(0);
+    TEST_ASSERT_EQUAL(started, e.start);
+    TEST_ASSERT_GREATER_OR_EQUAL(stopped, e.end);
+    TEST_ASSERT_EQUAL(20 * MOTION_GRID_X / WIDTH, e.x0);
+    TEST_ASSERT_GREATER_OR_EQUAL(MOTION_GRID_X - 2, e.x1);
+    // rows 100 to 140 of 236 are grid rows 5 to 7
+    TEST_ASSERT_EQUAL(100 * MOTION_GRID_Y / HEIGHT, e.y0);
+    TEST_ASSERT_EQUAL(139 * MOTION_GRID_Y / HEIGHT, e.y1);
+
+    // raw frames are looked at whole
+    TEST_ASSERT_EQUAL(WIDTH, m.getWidth());
+    TEST_ASSERT_EQUAL(HEIGHT, m.getHeight());
+    TEST_ASSERT_EQUAL(HEIGHT, m.getRows());
+}
+
+void test_jpeg_frames_through_the_dc_path(void)
+{
+    JpegEncoder encoder;
+    encoder.setQuality(80);
+    std::vector<uint8_t> jpg(WIDTH * HEIGHT);
+    MotionDetector m;
+
+    uint32_t now = 1000;
+    uint32_t us = 0;
+    int frames = 0;
+    for (int i = 0; i < 30; i++, now += FRAME_MS)
+    {
+        paint(16, i < 10 ? -1 : 20 + (i - 10) * 12, 100);
+        size_t len = encoder.encodeGray(frame, WIDTH, HEIGHT, jpg.data(), jpg.size());
+        TEST_ASSERT_GREATER_THAN(0, len);
+        uint32_t t = micros();
+        bool moving = m.analyze(jpg.data(), len, now);
+        us += micros() - t;
+        frames++;
+        TEST_ASSERT_EQUAL(i >= 10, moving);
+    }
+    printf("%u us per %dx%d JPEG frame\n", (unsigned)(us / frames), WIDTH, HEIGHT);
+
+    // the frame's own size, and the block rows the grid was laid over
+    TEST_ASSERT_EQUAL(WIDTH, m.getWidth());
+    TEST_ASSERT_EQUAL(HEIGHT, m.getHeight());
+    TEST_ASSERT_EQUAL((HEIGHT + 7) / 8, m.getRows());
+    TEST_ASSERT_EQUAL(1, m.getEventCount());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_noise_and_exposure_are_not_motion);
+    RUN_TEST(test_moving_square_makes_one_event);
+    RUN_TEST(test_jpeg_frames_through_the_dc_path);
+    return UNITY_END();
+}
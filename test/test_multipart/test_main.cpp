@@ -0,0 +1,194 @@
+// Multipart parts on the wire: the part header built once per frame and sent
+// with the JPEG and the boundary in one gather write, against the four
+// separate writes per part streams used to make. Counts the send calls and
+// the TCP data segments (TCP_INFO) per frame over loopback with Nagle off,
+// the way a small write goes out on its own on the device. Frames are sent
+// one at a time, each once the last has arrived, as they are at camera pace;
+// a backlog would let the kernel merge writes on its own.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/tcp.h>
+#include <arpa/inet.h>
+#include <atomic>
+
+#include "Frame.h"
+#include "StreamClient.h"
+
+#define FRAMES 200
+#define FRAME_SIZE 20000
+
+static int listener;
+static int sender, receiver;
+static pthread_t drainer;
+
+static camera_fb_t fb;
+static uint8_t data[FRAME_SIZE];
+static FrameExchange exchange;
+static std::atomic<size_t> received;
+static size_t sent;
+
+static void keep(camera_fb_t *)
+{
+}
+
+// read everything as fast as it comes
+static void *drain(void *)
+{
+    static char buf[65536];
+    int n;
+    while ((n = recv(receiver, buf, sizeof(buf), 0)) > 0)
+        received += n;
+    return NULL;
+}
+
+// wait for everything sent so far to arrive
+static void arrived(size_t bytes)
+{
+    sent += bytes;
+    while (received < sent)
+        ;
+}
+
+static bool dataSegments(int sock, uint32_t &segs)
+{
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    memset(&info, 0, sizeof(info));
+    if (getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &len) != 0 ||
+        len < offsetof(struct tcp_info, tcpi_data_segs_out) + sizeof(info.tcpi_data_segs_out))
+        return false;
+    segs = info.tcpi_data_segs_out;
+    return true;
+}
+
+void setUp(void)
+{
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listener, (struct sockaddr *)&addr, sizeof(addr));
+    listen(listener, 1);
+    socklen_t alen = sizeof(addr);
+    getsockname(listener, (struct sockaddr *)&addr, &alen);
+
+    receiver = socket(AF_INET, SOCK_STREAM, 0);
+    connect(receiver, (struct sockaddr *)&addr, sizeof(addr));
+    sender = accept(listener, NULL, NULL);
+    int one = 1;
+    setsockopt(sender, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    pthread_create(&drainer, NULL, drain, NULL);
+
+    fb.buf = data;
+    fb.len = FRAME_SIZE;
+    received = 0;
+    sent = 0;
+}
+
+void tearDown(void)
+{
+    pthread_join(drainer, NULL);
+    close(receiver);
+    close(listener);
+}
+
+// what streamCB used to do per client and frame
+static void sendSeparately(int sock, uint32_t &calls)
+{
+    static const char type[] = "Content-Type: image/jpeg\r\nContent-Length: ";
+    static const char boundary[] = "\r\n--123456789000000000000987654321\r\n";
+    char length[16];
+    int n = sprintf(length, "%u\r\n\r\n", (unsigned)fb.len);
+
+    send(sock, type, strlen(type), 0);
+    send(sock, length, n, 0);
+    send(sock, fb.buf, fb.len, 0);
+    send(sock, boundary, strlen(boundary), 0);
+    calls += 4;
+    arrived(strlen(type) + n + fb.len + strlen(boundary));
+}
+
+void test_gather_write_cuts_calls_and_segments(void)
+{
+    uint32_t before, after, calls = 0;
+    if (!dataSegments(sender, before))
+    {
+        close(sender);
+        TEST_IGNORE_MESSAGE("TCP_INFO has no segment counts on this kernel");
+    }
+    for (int i = 0; i < FRAMES; i++)
+        sendSeparately(sender, calls);
+    dataSegments(sender, after);
+    float separateCalls = (float)calls / FRAMES;
+    float separateSegs = (float)(after - before) / FRAMES;
+
+    // the HTTP response header goes out once, before the first frame
+    StreamClient *client = new StreamClient(dup(sender));
+    uint32_t bytes, stalled;
+    while (client->pump())
+        ;
+    client->collect(bytes, stalled);
+    arrived(bytes);
+
+    calls = 0;
+    dataSegments(sender, before);
+    for (uint32_t i = 0; i < FRAMES; i++)
+    {
+        Frame *f = Frame::wrap(&fb, keep);
+        exchange.publish(f);
+        f = exchange.acquire();
+        client->start(f, 0);
+        f->release();
+        do
+            calls++;
+        while (client->pump());
+        client->collect(bytes, stalled);
+        arrived(bytes);
+    }
+    dataSegments(sender, after);
+    float gatherCalls = (float)calls / FRAMES;
+    float gatherSegs = (float)(after - before) / FRAMES;
+
+    delete client;
+    close(sender);
+
+    printf("per frame: separate writes %.2f calls %.2f segments, gather write %.2f calls %.2f segments\n",
+           separateCalls, separateSegs, gatherCalls, gatherSegs);
+    TEST_ASSERT_EQUAL_FLOAT(4.0f, separateCalls);
+    TEST_ASSERT_LESS_THAN_FLOAT(1.1f, gatherCalls);
+    TEST_ASSERT_LESS_THAN_FLOAT(separateSegs / 2, gatherSegs);
+}
+
+// Every client sends the same ready-made header: built once, at publication
+void test_part_header_is_built_once_per_frame(void)
+{
+    Frame *f = Frame::wrap(&fb, keep);
+    exchange.publish(f);
+    Frame *a = exchange.acquire();
+    Frame *b = exchange.acquire();
+    TEST_ASSERT_EQUAL_PTR(a->getPart(), b->getPart());
+
+    char expected[32];
+    snprintf(expected, sizeof(expected), "Content-Length: %u\r\n", (unsigned)FRAME_SIZE);
+    TEST_ASSERT_NOT_NULL(strstr(a->getPart(), expected));
+    TEST_ASSERT_NOT_NULL(strstr(a->getPart(), "X-Frame: "));
+    TEST_ASSERT_EQUAL(strlen(a->getPart()), a->getPartLen());
+    TEST_ASSERT_EQUAL(0, strcmp(a->getPart() + a->getPartLen() - 4, "\r\n\r\n"));
+    a->release();
+    b->release();
+    close(sender);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_gather_write_cuts_calls_and_segments);
+    RUN_TEST(test_part_header_is_built_once_per_frame);
+    return UNITY_END();
+}
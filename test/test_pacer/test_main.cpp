@@ -0,0 +1,164 @@
+// Pacer against a simulated camera and simulated links, a millisecond at a
+// time: every client gets the target rate or as many frames as its link
+// carries, whichever is less, and no frame sits in a socket for long.
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "Pacer.h"
+
+#define SIM_MS 20000
+#define FRAME_BYTES 30000
+
+struct Link
+{
+    uint32_t rate;      // bytes/s it carries
+    uint32_t queued;    // bytes of the current frame not yet through
+    uint32_t started;   // ms the current frame was started
+    uint32_t due;       // ms from which the next may start
+    uint32_t drainRate; // as StreamClient measures it
+    uint32_t period;
+    uint32_t frames;
+    uint32_t worst;     // longest a frame took to get through, ms
+    double carry;
+};
+
+static Pacer pacer;
+
+// Run the links for ms milliseconds. The camera delivers FRAME_BYTES frames
+// that take captureMs to capture
+static void simulate(Link *links, int count, uint32_t ms, uint32_t captureMs)
+{
+    for (uint32_t now = 0; now < ms; now++)
+    {
+        if (now % pacer.captureInterval() == 0)
+            pacer.onCapture(captureMs, FRAME_BYTES);
+
+        uint32_t fastest = UINT32_MAX, slowest = 0, slowRate = 0;
+        for (int i = 0; i < count; i++)
+        {
+            Link &l = links[i];
+            if (l.queued)
+            {
+                l.carry += l.rate / 1000.0;
+                uint32_t n = l.carry < l.queued ? (uint32_t)l.carry : l.queued;
+                l.carry -= n;
+                l.queued -= n;
+                if (l.queued == 0)
+                {
+                    uint32_t elapsed = now + 1 - l.started;
+                    uint32_t rate = (uint64_t)FRAME_BYTES * 1000 / elapsed;
+                    l.drainRate = l.drainRate ? l.drainRate - l.drainRate / 4 + rate / 4 : rate;
+                    if (elapsed > l.worst)
+                        l.worst = elapsed;
+                    l.frames++;
+                }
+            }
+            if (l.queued == 0 && (int32_t)(now - l.due) >= 0)
+            {
+                l.period = pacer.clientPeriod(l.drainRate);
+                l.queued = FRAME_BYTES;
+                l.started = now;
+                l.due = now + l.period;
+            }
+            if (l.period < fastest)
+                fastest = l.period;
+            if (l.period > slowest)
+                slowest = l.period;
+            if (l.drainRate && (slowRate == 0 || l.drainRate < slowRate))
+                slowRate = l.drainRate;
+        }
+        pacer.onClients(fastest, slowest, slowRate);
+    }
+}
+
+void setUp(void)
+{
+    pacer = Pacer();
+}
+
+void tearDown(void)
+{
+}
+
+void test_each_link_gets_what_it_carries(void)
+{
+    pacer.setTargetFps(14);
+    // fast enough for the target, half of it, and a tenth
+    Link links[3] = {};
+    links[0].rate = 2000000;
+    links[1].rate = FRAME_BYTES * 7;
+    links[2].rate = FRAME_BYTES * 14 / 10;
+    simulate(links, 3, SIM_MS, 20);
+
+    float seconds = SIM_MS / 1000.0f;
+    TEST_ASSERT_INT_WITHIN(1, 14, links[0].frames / seconds);
+    TEST_ASSERT_INT_WITHIN(1, 7, links[1].frames / seconds);
+    TEST_ASSERT_INT_WITHIN(1, 1, links[2].frames / seconds);
+
+    // with frames spaced out to the link, none waits behind another: each takes
+    // about as long as the link needs for one
+    TEST_ASSERT_LESS_THAN(100, links[0].worst);
+    TEST_ASSERT_LESS_OR_EQUAL(1000 / 7 + 20, links[1].worst);
+    TEST_ASSERT_LESS_OR_EQUAL(1000 * 10 / 14 + 20, links[2].worst);
+}
+
+void test_slow_camera_sets_the_pace(void)
+{
+    pacer.setTargetFps(25);
+    Link links[1] = {};
+    links[0].rate = 10000000;
+    simulate(links, 1, 2000, 100);
+    TEST_ASSERT_EQUAL(100, pacer.captureInterval());
+}
+
+void test_capture_follows_the_fastest_client_up_to_the_latency_ceiling(void)
+{
+    pacer.setTargetFps(20);
+    pacer.setMaxLatency(200);
+    Link links[1] = {};
+    links[0].rate = FRAME_BYTES * 2; // 500 ms a frame
+    simulate(links, 1, SIM_MS, 10);
+    TEST_ASSERT_EQUAL(200, pacer.captureInterval());
+    TEST_ASSERT_TRUE(pacer.overLatency());
+
+    pacer.setMaxLatency(1000);
+    TEST_ASSERT_INT_WITHIN(25, 500, pacer.captureInterval());
+}
+
+void test_target_and_profile_rate_and_idle(void)
+{
+    pacer.setTargetFps(10);
+    TEST_ASSERT_EQUAL(100, pacer.clientPeriod(0));
+    TEST_ASSERT_EQUAL(500, pacer.clientPeriod(0, 2));
+    pacer.setIdle(true);
+    TEST_ASSERT_EQUAL(1000 / PACER_IDLE_FPS, pacer.clientPeriod(0));
+    pacer.setIdle(false);
+
+    pacer.setTargetFps(0);
+    TEST_ASSERT_EQUAL(1, pacer.getTargetFps());
+    pacer.setMaxLatency(1);
+    TEST_ASSERT_EQUAL(50, pacer.getMaxLatency());
+}
+
+// a thumbnail client drains its profile's small frames, not the camera's
+void test_profile_frame_size_sets_the_drain_period(void)
+{
+    pacer.setTargetFps(10);
+    pacer.onCapture(10, 30000);
+    TEST_ASSERT_EQUAL(500, pacer.clientPeriod(60000));
+    TEST_ASSERT_EQUAL(500, pacer.clientPeriod(60000, 2, 3000));
+    TEST_ASSERT_EQUAL(100, pacer.clientPeriod(60000, 0, 3000));
+    TEST_ASSERT_EQUAL(250, pacer.clientPeriod(12000, 0, 3000));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_each_link_gets_what_it_carries);
+    RUN_TEST(test_slow_camera_sets_the_pace);
+    RUN_TEST(test_capture_follows_the_fastest_client_up_to_the_latency_ceiling);
+    RUN_TEST(test_target_and_profile_rate_and_idle);
+    RUN_TEST(test_profile_frame_size_sets_the_drain_period);
+    return UNITY_END();
+}
@@ -0,0 +1,289 @@
+// End to end benchmark of the streaming path on the host: FakeCamera, Frame,
+// FrameExchange and FrameRing as the capture task uses them, StreamClient as
+// the streaming task does, and 1 to 10 viewers reading over loopback TCP.
+//
+// Replays the JPEGs in $FAKE_CAMERA_DIR if that is set, synthetic VGA frames
+// otherwise. Prints per client count the frames a second every viewer got,
+// p50 and p99 glass-to-socket latency (capture timestamp to the last byte of
+// the frame read by the viewer), the bytes copied per frame and the streaming
+// thread's CPU time per viewer.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <algorithm>
+#include <vector>
+
+#include "FakeCamera.h"
+#include "Frame.h"
+#include "FrameRing.h"
+#include "JpegEncoder.h"
+#include "StreamClient.h"
+
+#define CAMERA_FPS 25
+#define RUN_MS 600
+#define MAX_VIEWERS 10
+
+static FrameExchange exchange;
+static FrameRing ring;
+static volatile bool running;
+static uint32_t captured;
+static uint32_t capturedBytes;
+
+static int listener;
+static StreamClient *clients[MAX_VIEWERS];
+static int clientCount;
+
+struct Viewer
+{
+    pthread_t thread;
+    int sock;
+    uint32_t frames;
+    std::vector<uint32_t> latencies; // us
+    bool intact;                     // every frame arrived whole and in order
+};
+static Viewer viewers[MAX_VIEWERS];
+
+static void addSyntheticFrames(int count)
+{
+    const int w = 640, h = 480;
+    uint8_t *yuyv = (uint8_t *)malloc(w * h * 2);
+    uint8_t *jpg = (uint8_t *)malloc(w * h);
+    JpegEncoder encoder;
+    encoder.setQuality(80);
+
+    uint32_t seed = 1;
+    for (int n = 0; n < count; n++)
+    {
+        // a textured background and a bright square moving across it
+        for (int y = 0; y < h; y++)
+            for (int x = 0; x < w; x++)
+            {
+                seed = seed * 1103515245 + 12345;
+                int v = 96 + ((x / 8 + y / 8) & 1) * 48 + (seed >> 28);
+                if (x >= n * 40 && x < n * 40 + 96 && y >= 160 && y < 256)
+                    v = 235;
+                yuyv[(y * w + x) * 2] = v;
+                yuyv[(y * w + x) * 2 + 1] = x & 1 ? 120 + y / 16 : 128 + x / 32;
+            }
+        size_t len = encoder.encodeYuv422(yuyv, w, h, jpg, w * h);
+        TEST_ASSERT_GREATER_THAN(0, len);
+        TEST_ASSERT_TRUE(FakeCamera::add(jpg, len, w, h));
+    }
+    free(yuyv);
+    free(jpg);
+}
+
+// the capture task: take a frame, hand it to the streams and record it
+static void *capture(void *)
+{
+    while (running)
+    {
+        camera_fb_t *fb = esp_camera_fb_get();
+        if (fb == NULL)
+            continue;
+        captured++;
+        capturedBytes += fb->len;
+        ring.add(fb->buf, fb->len, millis());
+        Frame *f = Frame::wrap(fb);
+        if (f)
+            exchange.publish(f);
+    }
+    return NULL;
+}
+
+// Read the stream and time every frame from its X-Timestamp to its last byte
+static void *view(void *arg)
+{
+    Viewer &v = *(Viewer *)arg;
+    std::vector<char> buf;
+    char chunk[16384];
+    uint32_t lastSeq = 0;
+
+    for (;;)
+    {
+        int n = recv(v.sock, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+            break;
+        buf.insert(buf.end(), chunk, chunk + n);
+
+        for (;;)
+        {
+            buf.push_back(0);
+            const char *s = buf.data();
+            const char *cl = strstr(s, "Content-Length: ");
+            const char *ts = strstr(s, "X-Timestamp: ");
+            const char *seq = strstr(s, "X-Frame: ");
+            const char *body = cl ? strstr(cl, "\r\n\r\n") : NULL;
+            buf.pop_back();
+            if (!cl || !ts || !seq || !body)
+                break;
+            size_t len = strtoul(cl + 16, NULL, 10);
+            body += 4;
+            size_t at = body - buf.data();
+            if (buf.size() < at + len)
+                break;
+
+            char *frac;
+            uint32_t sec = strtoul(ts + 13, &frac, 10);
+            uint32_t taken = sec * 1000000 + strtoul(frac + 1, NULL, 10);
+            v.latencies.push_back(micros() - taken);
+
+            uint32_t s2 = strtoul(seq + 9, NULL, 10);
+            if (s2 <= lastSeq || (uint8_t)body[0] != 0xFF || (uint8_t)body[1] != 0xD8 ||
+                (uint8_t)body[len - 2] != 0xFF || (uint8_t)body[len - 1] != 0xD9)
+                v.intact = false;
+            lastSeq = s2;
+            v.frames++;
+            buf.erase(buf.begin(), buf.begin() + at + len);
+        }
+    }
+    return NULL;
+}
+
+static uint64_t threadCpuUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void connectViewers(int count)
+{
+    struct sockaddr_in addr;
+    socklen_t alen = sizeof(addr);
+    getsockname(listener, (struct sockaddr *)&addr, &alen);
+
+    for (int i = 0; i < count; i++)
+    {
+        Viewer &v = viewers[i];
+        v.sock = socket(AF_INET, SOCK_STREAM, 0);
+        TEST_ASSERT_EQUAL(0, connect(v.sock, (struct sockaddr *)&addr, sizeof(addr)));
+        v.frames = 0;
+        v.latencies.clear();
+        v.intact = true;
+
+        int sock = accept(listener, NULL, NULL);
+        TEST_ASSERT_GREATER_OR_EQUAL(0, sock);
+        int one = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        clients[i] = new StreamClient(sock);
+        pthread_create(&v.thread, NULL, view, &v);
+    }
+    clientCount = count;
+}
+
+// The streaming task, cut down to what matters here: every client that is
+// done moves on to the newest frame, and every pass pumps them all
+static uint64_t stream(uint32_t ms)
+{
+    uint64_t cpu = threadCpuUs();
+    uint32_t start = millis();
+    while (millis() - start < ms)
+    {
+        Frame *f = exchange.acquire();
+        bool busy = false;
+        for (int i = 0; i < clientCount; i++)
+        {
+            StreamClient *c = clients[i];
+            if (f && c->idle() && f->getSeq() != c->lastSeq())
+                c->start(f, 0);
+            if (c->pump())
+                busy = true;
+        }
+        if (f)
+            f->release();
+        delay(busy ? 0 : 1);
+    }
+    return threadCpuUs() - cpu;
+}
+
+static uint32_t percentile(std::vector<uint32_t> &all, int p)
+{
+    std::sort(all.begin(), all.end());
+    return all.empty() ? 0 : all[(all.size() - 1) * p / 100];
+}
+
+void setUp(void)
+{
+    FakeCamera::reset();
+}
+
+void tearDown(void)
+{
+}
+
+void test_stream_to_loopback_viewers(void)
+{
+    const char *dir = getenv("FAKE_CAMERA_DIR");
+    if (!(dir && FakeCamera::load(dir)))
+        addSyntheticFrames(8);
+
+    camera_config_t config = {PIXFORMAT_JPEG, FRAMESIZE_VGA, 12, 2};
+    TEST_ASSERT_EQUAL(ESP_OK, esp_camera_init(&config));
+    FakeCamera::setFps(CAMERA_FPS);
+    TEST_ASSERT_TRUE(ring.begin(2 * 1024 * 1024));
+
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    TEST_ASSERT_EQUAL(0, bind(listener, (struct sockaddr *)&addr, sizeof(addr)));
+    TEST_ASSERT_EQUAL(0, listen(listener, MAX_VIEWERS));
+
+    printf("viewers  fps/viewer  p50 ms  p99 ms  copied/frame  cpu/viewer\n");
+    for (int count = 1; count <= MAX_VIEWERS; count++)
+    {
+        running = true;
+        captured = 0;
+        capturedBytes = 0;
+        uint32_t ringBytes = ring.getWritten();
+        pthread_t cam;
+        pthread_create(&cam, NULL, capture, NULL);
+        connectViewers(count);
+
+        uint64_t cpu = stream(RUN_MS);
+
+        running = false;
+        pthread_join(cam, NULL);
+        for (int i = 0; i < count; i++)
+        {
+            delete clients[i];
+            pthread_join(viewers[i].thread, NULL);
+            close(viewers[i].sock);
+        }
+
+        std::vector<uint32_t> all;
+        uint32_t fewest = UINT32_MAX;
+        for (int i = 0; i < count; i++)
+        {
+            TEST_ASSERT_TRUE_MESSAGE(viewers[i].intact, "a frame arrived torn or out of order");
+            all.insert(all.end(), viewers[i].latencies.begin(), viewers[i].latencies.end());
+            if (viewers[i].frames < fewest)
+                fewest = viewers[i].frames;
+        }
+        float fps = fewest * 1000.0f / RUN_MS;
+        uint32_t copied = ring.getWritten() - ringBytes;
+        printf("%7d  %10.1f  %6.1f  %6.1f  %12u  %8.1f%%\n", count, fps,
+               percentile(all, 50) / 1000.0f, percentile(all, 99) / 1000.0f, (unsigned)(copied / captured),
+               cpu * 100.0f / (RUN_MS * 1000.0f) / count);
+
+        // nobody falls behind the camera, and the only copy of a frame is the recording
+        TEST_ASSERT_GREATER_OR_EQUAL(CAMERA_FPS * 8 / 10, fps);
+        TEST_ASSERT_EQUAL_UINT32(capturedBytes, copied);
+    }
+    close(listener);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_stream_to_loopback_viewers);
+    return UNITY_END();
+}
@@ -0,0 +1,260 @@
+// PixelConvert: the word-at-a-time paths against the per-pixel ones, which
+// unaligned buffers take, on random pixels of odd sizes, offsets and strides,
+// and both against a plain reference, never reading or writing past the end.
+// Then what each path does at SVGA.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <math.h>
+#include <vector>
+
+#include "PixelConvert.h"
+
+#define WIDTH 800
+#define HEIGHT 600
+#define ROUNDS 500
+#define FRAMES 50
+
+static uint32_t seed = 1;
+
+static uint32_t random32(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+static void fill(uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+        buf[i] = random32();
+}
+
+static int box(const uint8_t *src, int stride, int x, int y, int factor)
+{
+    int sum = factor * factor / 2;
+    for (int j = 0; j < factor; j++)
+        for (int i = 0; i < factor; i++)
+            sum += src[(y * factor + j) * stride + x * factor + i];
+    return sum / (factor * factor);
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// BT.601 full range in floating point, rounded
+static uint8_t reference(float v)
+{
+    v = roundf(v);
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+void test_yuv422_to_y8(void)
+{
+    // the word path and, one byte off, the per-pixel one both take every Y
+    std::vector<uint8_t> src(4096 + 8), a(2048 + 8), b(2048 + 8);
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        size_t pixels = random32() % 2048;
+        fill(src.data(), src.size());
+        yuv422ToY8(src.data(), a.data(), pixels);
+        for (size_t i = 0; i < pixels; i++)
+            TEST_ASSERT_EQUAL(src[i * 2], a[i]);
+        memmove(src.data() + 1, src.data(), pixels * 2);
+        yuv422ToY8(src.data() + 1, b.data() + 1, pixels);
+        TEST_ASSERT_EQUAL(0, memcmp(a.data(), b.data() + 1, pixels));
+    }
+}
+
+// Against BT.601 worked out in floating point, one byte off or not. The input
+// is followed by bytes that would show up in the last pixel if an odd count
+// read past its Y and U, and the output by bytes that must stay as they are
+static void checkRgb888(const uint8_t *yuyv, size_t pixels, int off)
+{
+    std::vector<uint8_t> in(pixels * 2 + 8), out(pixels * 3 + 8, 0xA5);
+    memcpy(in.data() + off, yuyv, pixels * 2);
+    memset(in.data() + off + pixels * 2, 255, 4);
+    yuv422ToRgb888(in.data() + off, out.data() + off, pixels);
+
+    for (size_t i = 0; i < pixels; i++)
+    {
+        const uint8_t *pair = yuyv + (i & ~1) * 2;
+        float y = yuyv[i * 2], u = pair[1] - 128.0f;
+        float v = (i | 1) < pixels ? pair[3] - 128.0f : i ? yuyv[i * 2 - 1] - 128.0f : 0;
+        const uint8_t *rgb = out.data() + off + i * 3;
+        TEST_ASSERT_INT_WITHIN(1, reference(y + 1.402f * v), rgb[0]);
+        TEST_ASSERT_INT_WITHIN(1, reference(y - 0.344136f * u - 0.714136f * v), rgb[1]);
+        TEST_ASSERT_INT_WITHIN(1, reference(y + 1.772f * u), rgb[2]);
+    }
+    for (int i = 0; i < 8 - off; i++)
+        TEST_ASSERT_EQUAL(0xA5, out[off + pixels * 3 + i]);
+}
+
+void test_yuv422_to_rgb888(void)
+{
+    // grey stays grey, and white white
+    uint8_t white[4] = {255, 128, 255, 128}, rgb[6];
+    yuv422ToRgb888(white, rgb, 2);
+    for (int i = 0; i < 6; i++)
+        TEST_ASSERT_EQUAL(255, rgb[i]);
+
+    // every pixel count up to a few words, then random ones, odd ones among them
+    std::vector<uint8_t> src(4096);
+    for (size_t pixels = 0; pixels < 16; pixels++)
+    {
+        fill(src.data(), pixels * 2);
+        checkRgb888(src.data(), pixels, 0);
+        checkRgb888(src.data(), pixels, 1);
+    }
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        size_t pixels = random32() % 2048;
+        fill(src.data(), pixels * 2);
+        checkRgb888(src.data(), pixels, round & 1);
+    }
+}
+
+void test_rgb565_to_y8(void)
+{
+    // every colour, against BT.601 worked out in floating point
+    std::vector<uint8_t> all(65536 * 2);
+    for (int c = 0; c < 65536; c++)
+    {
+        all[c * 2] = c >> 8;
+        all[c * 2 + 1] = c & 255;
+    }
+    std::vector<uint8_t> y(65536);
+    rgb565ToY8(all.data(), y.data(), 65536);
+    for (int c = 0; c < 65536; c++)
+    {
+        float r = ((c >> 11) & 31) * 255 / 31.0f;
+        float g = ((c >> 5) & 63) * 255 / 63.0f;
+        float b = (c & 31) * 255 / 31.0f;
+        float ref = 0.299f * r + 0.587f * g + 0.114f * b;
+        TEST_ASSERT_TRUE(fabsf(y[c] - ref) <= 1.5f);
+    }
+    TEST_ASSERT_EQUAL(255, y[65535]);
+    TEST_ASSERT_EQUAL(0, y[0]);
+
+    // the word path and the per-pixel one agree byte for byte
+    std::vector<uint8_t> src(4096 + 8), a(2048 + 8), b(2048 + 8);
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        size_t pixels = random32() % 2048;
+        fill(src.data(), src.size());
+        rgb565ToY8(src.data(), a.data(), pixels);
+        memmove(src.data() + 1, src.data(), pixels * 2);
+        rgb565ToY8(src.data() + 1, b.data() + 1, pixels);
+        TEST_ASSERT_EQUAL(0, memcmp(a.data(), b.data() + 1, pixels));
+    }
+}
+
+static void checkDownscale(int factor)
+{
+    std::vector<uint8_t> src(160 * 120 + 8), a(80 * 60 + 8), b(80 * 60 + 8);
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        int width = 1 + random32() % 150;
+        int height = 1 + random32() % 110;
+        int stride = width + random32() % 10;
+        int w = width / factor, h = height / factor;
+        int dstStride = w + random32() % 4;
+        fill(src.data(), src.size());
+
+        // aligned when the strides allow it, then one byte off
+        int s = (stride + 3) & ~3, d = (dstStride + 3) & ~3;
+        void (*fn)(const uint8_t *, int, int, int, uint8_t *, int) = factor == 2 ? downscale2x : downscale4x;
+        fn(src.data(), width, height, s, a.data(), d);
+        for (int y = 0; y < h; y++)
+            for (int x = 0; x < w; x++)
+                TEST_ASSERT_EQUAL(box(src.data(), s, x, y, factor), a[y * d + x]);
+
+        fn(src.data() + 1, width, height, stride, b.data() + 1, dstStride);
+        for (int y = 0; y < h; y++)
+            for (int x = 0; x < w; x++)
+                TEST_ASSERT_EQUAL(box(src.data() + 1, stride, x, y, factor), b[1 + y * dstStride + x]);
+    }
+}
+
+void test_downscale(void)
+{
+    checkDownscale(2);
+    checkDownscale(4);
+
+    // 1/8 the way the thumbnails do it: by 4, then by 2 in place
+    std::vector<uint8_t> src(WIDTH * HEIGHT), a(WIDTH * HEIGHT / 16), b(WIDTH * HEIGHT / 64);
+    fill(src.data(), src.size());
+    downscale4x(src.data(), WIDTH, HEIGHT, WIDTH, a.data(), WIDTH / 4);
+    std::vector<uint8_t> quarter = a;
+    downscale2x(quarter.data(), WIDTH / 4, HEIGHT / 4, WIDTH / 4, b.data(), WIDTH / 8);
+    downscale2x(a.data(), WIDTH / 4, HEIGHT / 4, WIDTH / 4, a.data(), WIDTH / 8);
+    TEST_ASSERT_EQUAL(0, memcmp(a.data(), b.data(), b.size()));
+}
+
+// ms per SVGA frame, through the word path or, one byte off, the per-pixel one
+static double timeYuv422(bool rgb, bool words)
+{
+    static uint8_t src[WIDTH * HEIGHT * 2 + 4], dst[WIDTH * HEIGHT * 3 + 4];
+    int off = words ? 0 : 1;
+    uint32_t start = micros();
+    for (int i = 0; i < FRAMES; i++)
+        if (rgb)
+            yuv422ToRgb888(src + off, dst + off, WIDTH * HEIGHT);
+        else
+            yuv422ToY8(src + off, dst + off, WIDTH * HEIGHT);
+    return (micros() - start) / 1000.0 / FRAMES;
+}
+
+static double timeRgb565(bool words)
+{
+    static uint8_t src[WIDTH * HEIGHT * 2 + 4], dst[WIDTH * HEIGHT + 4];
+    int off = words ? 0 : 1;
+    uint32_t start = micros();
+    for (int i = 0; i < FRAMES; i++)
+        rgb565ToY8(src + off, dst + off, WIDTH * HEIGHT);
+    return (micros() - start) / 1000.0 / FRAMES;
+}
+
+static double timeDownscale(int factor, bool words)
+{
+    static uint8_t src[WIDTH * HEIGHT + 4], dst[WIDTH * HEIGHT / 4 + 4];
+    int off = words ? 0 : 1;
+    uint32_t start = micros();
+    for (int i = 0; i < FRAMES; i++)
+        if (factor == 2)
+            downscale2x(src + off, WIDTH, HEIGHT, WIDTH, dst + off, WIDTH / 2);
+        else
+            downscale4x(src + off, WIDTH, HEIGHT, WIDTH, dst + off, WIDTH / 4);
+    return (micros() - start) / 1000.0 / FRAMES;
+}
+
+// only printed: how long a frame takes says little on the host
+void test_throughput(void)
+{
+    double yWords = timeYuv422(false, true), yBytes = timeYuv422(false, false);
+    double rgb888Words = timeYuv422(true, true), rgb888Bytes = timeYuv422(true, false);
+    double rgbWords = timeRgb565(true), rgbBytes = timeRgb565(false);
+    double d2Words = timeDownscale(2, true), d2Bytes = timeDownscale(2, false);
+    double d4Words = timeDownscale(4, true), d4Bytes = timeDownscale(4, false);
+    printf("YUV422 to Y8: %.2f ms a frame in words, %.2f per pixel\n", yWords, yBytes);
+    printf("YUV422 to RGB888: %.2f ms a frame in words, %.2f per pixel\n", rgb888Words, rgb888Bytes);
+    printf("RGB565 to Y8: %.2f ms a frame in words, %.2f per pixel, %.0f MB/s in\n", rgbWords, rgbBytes,
+           WIDTH * HEIGHT * 2 / rgbWords / 1000);
+    printf("downscale 2x: %.2f ms a frame in words, %.2f per pixel\n", d2Words, d2Bytes);
+    printf("downscale 4x: %.2f ms a frame in words, %.2f per pixel\n", d4Words, d4Bytes);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_yuv422_to_y8);
+    RUN_TEST(test_yuv422_to_rgb888);
+    RUN_TEST(test_rgb565_to_y8);
+    RUN_TEST(test_downscale);
+    RUN_TEST(test_throughput);
+    return UNITY_END();
+}
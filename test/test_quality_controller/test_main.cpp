@@ -0,0 +1,128 @@
+// QualityController closed loop on a replayed trace: scene detail and link
+// rate change over time, frame sizes follow from quality, frame size and
+// detail, and the controller has to keep the stream within the link.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <math.h>
+
+#include "FakeCamera.h"
+#include "QualityController.h"
+
+#define FPS 10
+
+// one stretch of the trace
+struct Phase
+{
+    int seconds;
+    float detail;  // 1 for a typical scene
+    uint32_t link; // bytes/s the slowest client drains
+};
+
+static const Phase trace[] = {
+    {20, 1.0f, 400000},  // plenty of room
+    {30, 2.5f, 400000},  // busy scene
+    {30, 1.0f, 100000},  // congested link
+    {40, 1.0f, 50000},   // barely there: quality alone won't do
+    {60, 1.0f, 400000},  // recovered
+};
+
+static uint32_t pixels(framesize_t fs)
+{
+    switch (fs)
+    {
+    case FRAMESIZE_QVGA: return 320 * 240;
+    case FRAMESIZE_CIF: return 400 * 296;
+    case FRAMESIZE_HVGA: return 480 * 320;
+    case FRAMESIZE_VGA: return 640 * 480;
+    default: return 800 * 600;
+    }
+}
+
+// roughly what the OV2640 makes of a typical scene: about 4 bits a pixel at
+// the top of the scale, halving every 14 steps down
+static uint32_t frameBytes(int quality, framesize_t fs, float detail)
+{
+    return pixels(fs) * 0.3f * exp2f((quality - 10) / 14.0f) / 8 * detail + 1500;
+}
+
+static QualityController qc;
+
+void setUp(void)
+{
+    qc = QualityController();
+    qc.setEnabled(true);
+    qc.setQuality(53);
+    qc.setFramesize(FRAMESIZE_SVGA);
+}
+
+void tearDown(void)
+{
+}
+
+// the bytes/s of the last second of every phase, against the link
+void test_replayed_trace_stays_within_the_link(void)
+{
+    uint32_t last = 0;
+    for (const Phase &p : trace)
+    {
+        for (int s = 0; s < p.seconds; s++)
+        {
+            last = frameBytes(qc.getQuality(), qc.getFramesize(), p.detail);
+            qc.step(last, FPS, p.link);
+            TEST_ASSERT_GREATER_OR_EQUAL(qc.getQualityMin(), qc.getQuality());
+            TEST_ASSERT_LESS_OR_EQUAL(qc.getQualityMax(), qc.getQuality());
+        }
+        char msg[64];
+        snprintf(msg, sizeof(msg), "%u B/s over a %u B/s link", (unsigned)(last * FPS), (unsigned)p.link);
+        TEST_ASSERT_LESS_OR_EQUAL_MESSAGE(p.link + p.link / 10, last * FPS, msg);
+        if (p.link == 50000)
+            TEST_ASSERT_LESS_THAN(FRAMESIZE_SVGA, qc.getFramesize());
+    }
+
+    // back on a good link: the operator's frame size again, and quality back up
+    // to where the link is put to use
+    TEST_ASSERT_EQUAL(FRAMESIZE_SVGA, qc.getFramesize());
+    TEST_ASSERT_GREATER_OR_EQUAL(400000 * 7 / 10, last * FPS);
+}
+
+void test_operator_bounds_and_bitrate_cap(void)
+{
+    qc.setBounds(30, 40);
+    qc.setBitrate(800); // kbit/s, 100 KB/s
+    for (int s = 0; s < 60; s++)
+        qc.step(frameBytes(qc.getQuality(), qc.getFramesize(), 1.0f), FPS, 400000);
+    TEST_ASSERT_LESS_OR_EQUAL(40, qc.getQuality());
+    TEST_ASSERT_GREATER_OR_EQUAL(30, qc.getQuality());
+    TEST_ASSERT_LESS_OR_EQUAL(110000, frameBytes(qc.getQuality(), qc.getFramesize(), 1.0f) * FPS);
+
+    // nothing to go by, nothing to do
+    TEST_ASSERT_FALSE(qc.step(20000, FPS, 0) && qc.getBitrate() == 0);
+}
+
+// update() hands decisions to the sensor on its own scale, lower is better
+void test_update_drives_the_sensor(void)
+{
+    FakeCamera::reset();
+    camera_config_t config = {PIXFORMAT_JPEG, FRAMESIZE_SVGA, 10, 1};
+    TEST_ASSERT_EQUAL(ESP_OK, esp_camera_init(&config));
+
+    delay(QC_INTERVAL);
+    qc.update(esp_camera_sensor_get(), 200000, FPS, 100000);
+    TEST_ASSERT_LESS_THAN(53, qc.getQuality());
+    TEST_ASSERT_EQUAL(63 - qc.getQuality(), FakeCamera::getQuality());
+
+    // the next decision is a second away
+    int q = qc.getQuality();
+    qc.update(esp_camera_sensor_get(), 200000, FPS, 100000);
+    TEST_ASSERT_EQUAL(q, qc.getQuality());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_replayed_trace_stays_within_the_link);
+    RUN_TEST(test_operator_bounds_and_bitrate_cap);
+    RUN_TEST(test_update_drives_the_sensor);
+    return UNITY_END();
+}
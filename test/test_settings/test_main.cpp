@@ -0,0 +1,59 @@
+// Settings: a table entry whose name is too long for an NVS key is caught when
+// the table is bound instead of silently never being stored, and the others
+// still go through the write-back cache into NVS.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <Preferences.h>
+
+#include "Settings.h"
+
+static int threshold, mode;
+
+static const Setting table[] = {
+    { "motion",           0, 2,   [](int v) { mode = v; },      []() { return mode; } },
+    { "motion_thresh",    1, 255, [](int v) { threshold = v; }, []() { return threshold; } },
+    { "motion_threshold", 1, 255, [](int v) { threshold = v; }, []() { return threshold; } },
+};
+
+void setUp(void)
+{
+    Preferences::reset();
+}
+
+void tearDown(void)
+{
+}
+
+void test_long_keys_are_refused_at_bind(void)
+{
+    Settings settings("test");
+    TEST_ASSERT_FALSE(settings.bind(table, 3));
+    TEST_ASSERT_NULL(settings.lookup("motion_threshold"));
+    TEST_ASSERT_FALSE(settings.set("motion_threshold", 20));
+
+    TEST_ASSERT_TRUE(settings.bind(table, 2));
+    TEST_ASSERT_NOT_NULL(settings.lookup("motion_thresh"));
+}
+
+void test_values_reach_nvs(void)
+{
+    Settings settings("test");
+    TEST_ASSERT_TRUE(settings.bind(table, 2));
+    TEST_ASSERT_TRUE(settings.set("motion_thresh", 300));
+    TEST_ASSERT_EQUAL(255, threshold); // clamped
+    settings.flush();
+
+    Preferences prefs;
+    TEST_ASSERT_TRUE(prefs.begin("test", true));
+    TEST_ASSERT_EQUAL(255, prefs.getInt("motion_thresh", 0));
+    prefs.end();
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_long_keys_are_refused_at_bind);
+    RUN_TEST(test_values_reach_nvs);
+    return UNITY_END();
+}
@@ -0,0 +1,262 @@
+// StreamClient over loopback TCP: frames arrive whole and in order however
+// the socket splits them up, and a viewer on a slow link doesn't cost the
+// others any frames.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <vector>
+
+#include "Frame.h"
+#include "StreamClient.h"
+
+#define VIEWERS 4
+#define FRAME_SLOTS 6
+
+static camera_fb_t fbs[FRAME_SLOTS];
+static std::atomic<bool> slotBusy[FRAME_SLOTS];
+static FrameExchange exchange;
+
+static void giveBack(camera_fb_t *fb)
+{
+    slotBusy[fb - fbs] = false;
+}
+
+// A frame of len bytes whose content follows from n, like a JPEG from the
+// outside. NULL while every slot is still being sent
+static Frame *makeFrame(uint32_t n, size_t len)
+{
+    for (int i = 0; i < FRAME_SLOTS; i++)
+    {
+        bool expected = false;
+        if (!slotBusy[i].compare_exchange_strong(expected, true))
+            continue;
+        camera_fb_t &fb = fbs[i];
+        fb.buf = (uint8_t *)realloc(fb.buf, len);
+        fb.len = len;
+        for (size_t j = 0; j < len; j++)
+            fb.buf[j] = (uint8_t)(n * 31 + j * 7);
+        fb.buf[0] = 0xFF;
+        fb.buf[1] = 0xD8;
+        fb.buf[len - 2] = 0xFF;
+        fb.buf[len - 1] = 0xD9;
+        fb.timestamp.tv_sec = n; // what frame this is, for the viewer to check
+        return Frame::wrap(&fb, giveBack);
+    }
+    return NULL;
+}
+
+static bool frameIntact(const uint8_t *p, size_t len, uint32_t n)
+{
+    for (size_t j = 2; j < len - 2; j++)
+        if (p[j] != (uint8_t)(n * 31 + j * 7))
+            return false;
+    return p[0] == 0xFF && p[1] == 0xD8 && p[len - 2] == 0xFF && p[len - 1] == 0xD9;
+}
+
+struct Viewer
+{
+    pthread_t thread;
+    int sock;
+    int rate;      // bytes/s the link takes, 0 for as fast as it goes
+    int maxRead;   // bytes per recv() at most
+    uint32_t frames;
+    bool intact;
+};
+
+static void *view(void *arg)
+{
+    Viewer &v = *(Viewer *)arg;
+    std::vector<uint8_t> buf;
+    std::vector<uint8_t> chunk(v.maxRead);
+    uint32_t last = 0;
+    uint32_t seed = v.sock;
+
+    for (;;)
+    {
+        seed = seed * 1103515245 + 12345;
+        int n = recv(v.sock, chunk.data(), 1 + (seed >> 8) % v.maxRead, 0);
+        if (n <= 0)
+            break;
+        if (v.rate)
+            delay(n * 1000 / v.rate);
+        buf.insert(buf.end(), chunk.begin(), chunk.begin() + n);
+
+        for (;;)
+        {
+            buf.push_back(0);
+            const char *s = (const char *)buf.data();
+            const char *cl = strstr(s, "Content-Length: ");
+            const char *ts = strstr(s, "X-Timestamp: ");
+            const char *body = cl ? strstr(cl, "\r\n\r\n") : NULL;
+            buf.pop_back();
+            if (!cl || !ts || !body)
+                break;
+            size_t len = strtoul(cl + 16, NULL, 10);
+            size_t at = body + 4 - s;
+            if (buf.size() < at + len)
+                break;
+            uint32_t n = strtoul(ts + 13, NULL, 10);
+            if (n <= last || !frameIntact(buf.data() + at, len, n))
+                v.intact = false;
+            last = n;
+            v.frames++;
+            buf.erase(buf.begin(), buf.begin() + at + len);
+        }
+    }
+    return NULL;
+}
+
+static int listener;
+static StreamClient *clients[VIEWERS];
+static Viewer viewers[VIEWERS];
+
+static void connectViewer(int i, int rate, int maxRead, int bufSize)
+{
+    struct sockaddr_in addr;
+    socklen_t alen = sizeof(addr);
+    getsockname(listener, (struct sockaddr *)&addr, &alen);
+
+    Viewer &v = viewers[i];
+    v.sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (bufSize)
+        setsockopt(v.sock, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+    TEST_ASSERT_EQUAL(0, connect(v.sock, (struct sockaddr *)&addr, sizeof(addr)));
+    v.rate = rate;
+    v.maxRead = maxRead;
+    v.frames = 0;
+    v.intact = true;
+
+    int sock = accept(listener, NULL, NULL);
+    if (bufSize)
+        setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof(bufSize));
+    clients[i] = new StreamClient(sock);
+    pthread_create(&v.thread, NULL, view, &v);
+}
+
+static void disconnect(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        delete clients[i];
+        pthread_join(viewers[i].thread, NULL);
+        close(viewers[i].sock);
+    }
+}
+
+// The streaming task's loop: a new frame every period ms, every idle client
+// moves on to the newest, and with a socket full it sleeps in select() until
+// one takes data again or the next frame is due. Returns the frames made
+static uint32_t stream(int count, uint32_t ms, uint32_t period, size_t size, uint32_t &pumps)
+{
+    uint32_t start = millis(), next = start, made = 0;
+    pumps = 0;
+    while (millis() - start < ms)
+    {
+        uint32_t now = millis();
+        if ((int32_t)(now - next) >= 0)
+        {
+            Frame *f = makeFrame(made + 1, size + made % 7 * 1013);
+            if (f)
+            {
+                exchange.publish(f);
+                made++;
+            }
+            next += period;
+        }
+
+        Frame *f = exchange.acquire();
+        fd_set full;
+        FD_ZERO(&full);
+        int maxSock = -1;
+        for (int i = 0; i < count; i++)
+        {
+            StreamClient *c = clients[i];
+            if (f && c->idle() && f->getSeq() != c->lastSeq())
+                c->start(f, 0);
+            pumps++;
+            if (c->pump())
+            {
+                FD_SET(c->getSocket(), &full);
+                if (c->getSocket() > maxSock)
+                    maxSock = c->getSocket();
+            }
+        }
+        if (f)
+            f->release();
+
+        uint32_t wait = (int32_t)(next - millis()) > 0 ? next - millis() : 0;
+        if (maxSock >= 0)
+        {
+            struct timeval tv = {0, (long)(wait ? wait : 1) * 1000};
+            select(maxSock + 1, NULL, &full, NULL, &tv);
+        }
+        else
+            delay(wait);
+    }
+    return made;
+}
+
+void setUp(void)
+{
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listener, (struct sockaddr *)&addr, sizeof(addr));
+    listen(listener, VIEWERS);
+}
+
+void tearDown(void)
+{
+    close(listener);
+}
+
+// Small socket buffers and a reader taking random bites: nearly every frame
+// goes out over several pumps, split anywhere, with EAGAIN in between
+void test_partial_writes_soak(void)
+{
+    connectViewer(0, 0, 3000, 4096);
+    uint32_t pumps;
+    uint32_t made = stream(1, 2000, 5, 20000, pumps);
+    disconnect(1);
+
+    TEST_ASSERT_TRUE_MESSAGE(viewers[0].intact, "a frame arrived torn or out of order");
+    TEST_ASSERT_GREATER_THAN(made / 2, viewers[0].frames);
+    // far more pumps than frames: the socket kept filling up
+    TEST_ASSERT_GREATER_THAN(viewers[0].frames * 2, pumps);
+}
+
+// One viewer on a link that takes 100 KB/s, three that take anything: the
+// fast ones see every frame, the slow one skips to the newest
+void test_throttled_viewer_does_not_slow_the_others(void)
+{
+    connectViewer(0, 100000, 16384, 16384);
+    for (int i = 1; i < VIEWERS; i++)
+        connectViewer(i, 0, 65536, 0);
+
+    uint32_t pumps;
+    uint32_t made = stream(VIEWERS, 2000, 40, 30000, pumps);
+    disconnect(VIEWERS);
+
+    for (int i = 0; i < VIEWERS; i++)
+        TEST_ASSERT_TRUE_MESSAGE(viewers[i].intact, "a frame arrived torn or out of order");
+    for (int i = 1; i < VIEWERS; i++)
+        TEST_ASSERT_GREATER_OR_EQUAL(made - 1, viewers[i].frames);
+    TEST_ASSERT_LESS_THAN(made / 2, viewers[0].frames);
+    TEST_ASSERT_GREATER_THAN(0, viewers[0].frames);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_partial_writes_soak);
+    RUN_TEST(test_throttled_viewer_does_not_slow_the_others);
+    return UNITY_END();
+}
@@ -0,0 +1,212 @@
+// Topology: the role tables, then the pipeline's tasks run through a model of
+// the two cores - fixed priorities, preemption, equal priorities taking turns -
+// on each topology, with a burst of /set requests in the middle. Capture and
+// sending must keep up on every one of them, and on the default one HTTP and
+// background work as well. Costs are rough figures for SVGA JPEG on the device.
+
+#include <Arduino.h>
+#include <unity.h>
+#include <deque>
+
+#include "Topology.h"
+
+#define TICK_US 100
+#define MS(n) ((n) * 1000 / TICK_US)
+#define DURATION MS(10000)
+#define FRAME MS(66) // 15 fps
+#define BURST_FROM MS(3000)
+#define BURST_TO MS(5000)
+#define WIFI_PRIORITY 23 // the WiFi driver's own task, pinned to PRO_CPU
+
+struct SimTask
+{
+    const char *name;
+    int role;    // ROLE_COUNT for WiFi
+    int period;  // ticks between releases, 0 if released by another task
+    int after;   // the task whose finishing releases this one, -1 if periodic
+    int every;   // on every n-th time it finishes
+    int cost;    // ticks of work per release
+    bool queues; // releases wait their turn rather than replace a pending one
+
+    int core, priority;
+    std::deque<int> released;
+    int left, lastRun;
+    int finished, overruns, worst;
+    long busy;
+};
+
+enum { SIM_WIFI, SIM_CAM, SIM_STREAM, SIM_MJPEG, SIM_THUMB, SIM_MOTION, SIM_RECORD, SIM_COUNT };
+
+static SimTask sim[SIM_COUNT] = {
+    // name     role              period    after       every  cost      queues
+    {"wifi",   ROLE_COUNT,      0,        SIM_STREAM, 1,     MS(2),    true},  // sending a frame's worth
+    {"cam",    ROLE_CAPTURE,    FRAME,    -1,         0,     MS(5),    false},
+    {"stream", ROLE_STREAM,     0,        SIM_CAM,    1,     MS(8),    false},
+    {"mjpeg",  ROLE_HTTP,       MS(5),    -1,         0,     MS(3),    true},  // only during the burst
+    {"thumb",  ROLE_BACKGROUND, 0,        SIM_CAM,    7,     MS(30),   false}, // about 2 fps
+    {"motion", ROLE_BACKGROUND, 0,        SIM_CAM,    3,     MS(10),   false},
+    {"record", ROLE_BACKGROUND, 0,        SIM_CAM,    1,     MS(1),    false},
+};
+
+static void release(SimTask &t, int now)
+{
+    if (!t.released.empty())
+    {
+        t.overruns++;
+        if (!t.queues)
+            return; // the newer frame replaces the pending one
+    }
+    if (t.released.empty())
+        t.left = t.cost;
+    t.released.push_back(now);
+}
+
+// ticks of the busiest core, in percent
+static int simulate(int topology)
+{
+    for (int i = 0; i < SIM_COUNT; i++)
+    {
+        SimTask &t = sim[i];
+        t.core = t.role == ROLE_COUNT ? PRO_CPU : topologyCore(topology, (task_role_t)t.role);
+        t.priority = t.role == ROLE_COUNT ? WIFI_PRIORITY : rolePriority[t.role];
+        t.released.clear();
+        t.left = t.lastRun = t.finished = t.overruns = t.worst = 0;
+        t.busy = 0;
+    }
+
+    long coreBusy[2] = {0, 0};
+    for (int now = 0; now < DURATION; now++)
+    {
+        for (int i = 0; i < SIM_COUNT; i++)
+        {
+            SimTask &t = sim[i];
+            if (t.period == 0 || now % t.period)
+                continue;
+            if (i == SIM_MJPEG && (now < BURST_FROM || now >= BURST_TO))
+                continue;
+            release(t, now);
+        }
+
+        // each core runs its most important ready task for one tick; equal
+        // priorities take turns, the one that ran longest ago first
+        int done[2] = {-1, -1};
+        for (int core = 0; core < 2; core++)
+        {
+            int run = -1;
+            for (int i = 0; i < SIM_COUNT; i++)
+            {
+                SimTask &t = sim[i];
+                if (t.core != core || t.released.empty())
+                    continue;
+                if (run < 0 || t.priority > sim[run].priority ||
+                    (t.priority == sim[run].priority && t.lastRun < sim[run].lastRun))
+                    run = i;
+            }
+            if (run < 0)
+                continue;
+            SimTask &t = sim[run];
+            t.lastRun = now;
+            t.busy++;
+            coreBusy[core]++;
+            if (--t.left)
+                continue;
+            int response = now + 1 - t.released.front();
+            if (response > t.worst)
+                t.worst = response;
+            t.released.pop_front();
+            t.finished++;
+            if (!t.released.empty())
+                t.left = t.cost;
+            done[core] = run;
+        }
+
+        // what finished releases what follows it, from the next tick on
+        for (int core = 0; core < 2; core++)
+            for (int i = 0; done[core] >= 0 && i < SIM_COUNT; i++)
+                if (sim[i].after == done[core] && sim[done[core]].finished % sim[i].every == 0)
+                    release(sim[i], now + 1);
+    }
+
+    printf("topology %d: PRO_CPU %ld%%, APP_CPU %ld%% busy\n", topology,
+           coreBusy[PRO_CPU] * 100 / DURATION, coreBusy[APP_CPU] * 100 / DURATION);
+    for (int i = 0; i < SIM_COUNT; i++)
+        printf("  %-6s core %d prio %2d: %5d done, %3d overrun, worst %6.1f ms\n", sim[i].name, sim[i].core,
+               sim[i].priority, sim[i].finished, sim[i].overruns, sim[i].worst * TICK_US / 1000.0);
+    long busiest = coreBusy[0] > coreBusy[1] ? coreBusy[0] : coreBusy[1];
+    return busiest * 100 / DURATION;
+}
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_tables(void)
+{
+    // strictly capture over stream over HTTP over background
+    for (int r = 1; r < ROLE_COUNT; r++)
+        TEST_ASSERT_GREATER_THAN(rolePriority[r], rolePriority[r - 1]);
+    for (int t = 0; t < TOPOLOGY_COUNT; t++)
+        for (int r = 0; r < ROLE_COUNT; r++)
+        {
+            int core = topologyCore(t, (task_role_t)r);
+            TEST_ASSERT_TRUE(core == APP_CPU || core == PRO_CPU);
+        }
+    // capture never shares WiFi's core
+    for (int t = 0; t < TOPOLOGY_COUNT; t++)
+        TEST_ASSERT_EQUAL(APP_CPU, topologyCore(t, ROLE_CAPTURE));
+    // a stored setting out of range means the default
+    TEST_ASSERT_EQUAL(topologies[TOPOLOGY_DEFAULT][ROLE_HTTP], topologyCore(TOPOLOGY_COUNT, ROLE_HTTP));
+    TEST_ASSERT_EQUAL(topologies[TOPOLOGY_DEFAULT][ROLE_STREAM], topologyCore(-1, ROLE_STREAM));
+}
+
+void test_capture_and_sending_keep_up_everywhere(void)
+{
+    for (int t = 0; t < TOPOLOGY_COUNT; t++)
+    {
+        simulate(t);
+        TEST_ASSERT_EQUAL(0, sim[SIM_CAM].overruns);
+        TEST_ASSERT_EQUAL(DURATION / FRAME + 1, sim[SIM_CAM].finished);
+        // every frame sent before the next one is there
+        TEST_ASSERT_EQUAL(0, sim[SIM_STREAM].overruns);
+        TEST_ASSERT_LESS_THAN(FRAME, sim[SIM_STREAM].worst);
+        // and every request answered in the end
+        TEST_ASSERT_EQUAL((BURST_TO - BURST_FROM) / sim[SIM_MJPEG].period, sim[SIM_MJPEG].finished);
+    }
+}
+
+void test_default_topology(void)
+{
+    int busiest = simulate(TOPOLOGY_DEFAULT);
+    TEST_ASSERT_LESS_THAN(90, busiest);
+
+    // capture and sending have their core to themselves
+    TEST_ASSERT_LESS_OR_EQUAL(sim[SIM_CAM].cost + sim[SIM_STREAM].cost, sim[SIM_CAM].worst);
+    TEST_ASSERT_LESS_OR_EQUAL(sim[SIM_CAM].cost + sim[SIM_STREAM].cost, sim[SIM_STREAM].worst);
+
+    // the burst is answered promptly, and background work still gets done
+    int http = sim[SIM_MJPEG].worst;
+    TEST_ASSERT_LESS_THAN(MS(20), http);
+    for (int i = SIM_THUMB; i <= SIM_RECORD; i++)
+        TEST_ASSERT_EQUAL(0, sim[i].overruns);
+
+    // with the whole pipeline on one core the requests wait behind it
+    simulate(0);
+    TEST_ASSERT_GREATER_THAN(http, sim[SIM_MJPEG].worst);
+
+    // with capture alone it runs the moment it is due
+    simulate(2);
+    TEST_ASSERT_EQUAL(sim[SIM_CAM].cost, sim[SIM_CAM].worst);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_tables);
+    RUN_TEST(test_capture_and_sending_keep_up_everywhere);
+    RUN_TEST(test_default_topology);
+    return UNITY_END();
+}
@@ -0,0 +1,65 @@
+# Gzips ui/index.html into src/index_html.h, named after its hash, so the
+# settings page can be served compressed and cached for good.
+#
+# Runs before every PlatformIO build (extra_scripts in platformio.ini) and only
+# rewrites the header when the page has changed. Run it by hand after editing
+# the page when building with the Arduino IDE:  python tools/embed_ui.py
+
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    ROOT = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SOURCE = os.path.join(ROOT, "ui", "index.html")
+TARGET = os.path.join(ROOT, "src", "index_html.h")
+
+
+def render(blob, tag):
+    lines = [
+        "// Generated by tools/embed_ui.py from ui/index.html - edit that instead",
+        "#ifndef INDEX_HTML_H_",
+        "#define INDEX_HTML_H_",
+        "",
+        "#include <Arduino.h>",
+        "",
+        "// the page's hash: its ETag, and part of the URL it is cached under",
+        '#define INDEX_HTML_HASH "%s"' % tag,
+        '#define INDEX_HTML_PATH "/control/%s"' % tag,
+        "",
+        "static const uint8_t PROGMEM INDEX_HTML_GZ[] = {",
+    ]
+    for i in range(0, len(blob), 16):
+        lines.append("\t" + ", ".join("0x%02x" % b for b in blob[i:i + 16]) + ",")
+    lines += [
+        "};",
+        "",
+        "#endif //INDEX_HTML_H_",
+        "",
+    ]
+    return "\n".join(lines)
+
+
+def main():
+    with open(SOURCE, "rb") as f:
+        html = f.read()
+
+    # mtime=0 keeps the output, and with it the hash, the same for the same page
+    blob = gzip.compress(html, compresslevel=9, mtime=0)
+    tag = hashlib.sha256(blob).hexdigest()[:16]
+    header = render(blob, tag)
+
+    if os.path.exists(TARGET):
+        with open(TARGET) as f:
+            if f.read() == header:
+                return
+    with open(TARGET, "w") as f:
+        f.write(header)
+    print("embed_ui: %d bytes of html, %d gzipped, hash %s" % (len(html), len(blob), tag))
+
+
+main()